@@ -0,0 +1,238 @@
+//
+//  main.cpp
+//  GlassLab SDK Log Tests
+//
+//  This program checks the recovery paths of the message log (LogMessageStore),
+//  the file backend of the message queue. Each test writes messages, damages or
+//  edits the segment and cursor files the way a crash or a bad disk would, then
+//  opens the log again and checks which messages are left.
+//
+//  Build it with the SDK sources, for example:
+//  g++ -std=c++11 -DMULTITHREADED -DZLIB_COMPRESSION -I../../../headers -I../../../deps/include/libjansson
+//      -I../../../deps/src/CppSQLite-master/src main.cpp ../../../src/*.cpp
+//      ../../../deps/src/CppSQLite-master/src/CppSQLite3.cpp -ljansson -lsqlite3 -levent -lpthread -lz
+//
+//  Copyright (c) 2014 GlassLab. All rights reserved.
+//
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "glasslab_sdk.h"
+#include "glsdk_config.h"
+
+using namespace nsGlasslabSDK;
+
+
+// Core is only used by the log for error reporting
+Core* core;
+string logDir;
+int failures = 0;
+
+
+void check( bool condition, const char* test, const char* what ) {
+    if( !condition ) {
+        printf( "FAILED %s: %s\n", test, what );
+        failures++;
+    }
+}
+
+string basePath( const char* test ) {
+    return logDir + "/" + test;
+}
+
+string segmentPath( const char* test, unsigned int segment ) {
+    char t[32];
+    sprintf( t, ".%08u.log", segment );
+    return basePath( test ) + t;
+}
+
+long fileSize( const string& path ) {
+    FILE* file = fopen( path.c_str(), "rb" );
+    if( file == NULL ) {
+        return -1;
+    }
+    fseek( file, 0, SEEK_END );
+    long size = ftell( file );
+    fclose( file );
+    return size;
+}
+
+void appendMessage( LogMessageStore& store, const char* path, int id = 0 ) {
+    glQueuedMessage message;
+    message.id = id;
+    message.deviceId = "test-device";
+    message.path = path;
+    message.requestType = "POST";
+    message.coreCB = 0;
+    message.postdata = "{\"eventName\":\"test\"}";
+    message.contentType = "application/json";
+    message.status = "ready";
+    store.append( message );
+}
+
+vector<glQueuedMessage> readAll( LogMessageStore& store ) {
+    vector<glQueuedMessage> messages;
+    store.readAfter( 0, 1000, messages );
+    return messages;
+}
+
+
+/**
+ * A record whose payload no longer matches its checksum is dropped. In the last
+ * segment the records after it are skipped and new records start a new segment,
+ * in earlier segments records are checked as they are read.
+ */
+void testChecksum() {
+    const char* test = "checksum";
+    {
+        LogMessageStore store( core, basePath( test ) );
+        store.open();
+        appendMessage( store, "/msg1" );
+        appendMessage( store, "/msg2" );
+        appendMessage( store, "/msg3" );
+    }
+
+    // Flip the last byte of the second record
+    long recordSize = fileSize( segmentPath( test, 1 ) ) / 3;
+    FILE* file = fopen( segmentPath( test, 1 ).c_str(), "r+b" );
+    fseek( file, recordSize * 2 - 1, SEEK_SET );
+    int c = fgetc( file );
+    fseek( file, recordSize * 2 - 1, SEEK_SET );
+    fputc( c ^ 0xff, file );
+    fclose( file );
+
+    LogMessageStore store( core, basePath( test ) );
+    store.open();
+    vector<glQueuedMessage> messages = readAll( store );
+    check( messages.size() == 1, test, "only the record before the damaged one is kept" );
+    check( messages.size() > 0 && messages[ 0 ].path == "/msg1", test, "the first record is intact" );
+
+    appendMessage( store, "/msg4" );
+    check( fileSize( segmentPath( test, 2 ) ) > 0, test, "new records go to the next segment" );
+
+    LogMessageStore reopened( core, basePath( test ) );
+    reopened.open();
+    messages = readAll( reopened );
+    check( messages.size() == 3, test, "only the damaged record is dropped once the segment is not the last" );
+    string paths;
+    for( size_t i = 0; i < messages.size(); i++ ) {
+        paths += messages[ i ].path;
+    }
+    check( paths.find( "/msg2" ) == string::npos && paths.find( "/msg3" ) != string::npos && paths.find( "/msg4" ) != string::npos, test, "the records around it are intact" );
+    check( reopened.getCount() == 3, test, "the damaged record is removed from the count" );
+}
+
+/**
+ * A record cut short by a crash is left behind, the ones before it are kept.
+ */
+void testTornTail() {
+    const char* test = "torn";
+    {
+        LogMessageStore store( core, basePath( test ) );
+        store.open();
+        appendMessage( store, "/msg1" );
+        appendMessage( store, "/msg2" );
+        appendMessage( store, "/msg3" );
+    }
+    check( truncate( segmentPath( test, 1 ).c_str(), fileSize( segmentPath( test, 1 ) ) - 5 ) == 0, test, "truncate the segment" );
+
+    LogMessageStore store( core, basePath( test ) );
+    store.open();
+    vector<glQueuedMessage> messages = readAll( store );
+    check( messages.size() == 2, test, "the torn record is dropped" );
+    check( messages.size() == 2 && messages[ 1 ].path == "/msg2", test, "the records before it are intact" );
+
+    appendMessage( store, "/msg4" );
+    LogMessageStore reopened( core, basePath( test ) );
+    reopened.open();
+    messages = readAll( reopened );
+    check( messages.size() == 3, test, "a record appended after the torn one is kept" );
+    check( messages.size() == 3 && messages[ 2 ].path == "/msg4", test, "the appended record is intact" );
+}
+
+/**
+ * Removed records stay removed after a restart, whether the cursor moved past
+ * them or they were ahead of it, and a leftover temporary cursor is ignored.
+ */
+void testCursor() {
+    const char* test = "cursor";
+    {
+        LogMessageStore store( core, basePath( test ) );
+        store.open();
+        appendMessage( store, "/msg1" );
+        appendMessage( store, "/msg2" );
+        appendMessage( store, "/msg3" );
+        appendMessage( store, "/msg4" );
+
+        // The first moves the cursor, the third is ahead of it
+        store.remove( 1 );
+        store.remove( 3 );
+    }
+
+    // A crash while writing the cursor leaves a partial temporary file
+    FILE* file = fopen( ( basePath( test ) + ".cursor.tmp" ).c_str(), "w" );
+    fputs( "7", file );
+    fclose( file );
+
+    LogMessageStore store( core, basePath( test ) );
+    store.open();
+    vector<glQueuedMessage> messages = readAll( store );
+    check( messages.size() == 2, test, "removed records are not read again" );
+    check( messages.size() == 2 && messages[ 0 ].id == 2 && messages[ 1 ].id == 4, test, "the remaining records keep their ids" );
+
+    appendMessage( store, "/msg5" );
+    check( readAll( store ).back().id == 5, test, "ids are not reused" );
+
+    store.remove( 2 );
+    store.remove( 4 );
+    store.remove( 5 );
+    LogMessageStore reopened( core, basePath( test ) );
+    reopened.open();
+    check( reopened.getCount() == 0, test, "the log is empty once everything is removed" );
+}
+
+/**
+ * A message appended under an id that is already taken keeps the id, and the
+ * message stored under it gets a new one, also after a restart.
+ */
+void testRenumber() {
+    const char* test = "renumber";
+    {
+        LogMessageStore store( core, basePath( test ) );
+        store.open();
+        appendMessage( store, "/msg1" );
+        appendMessage( store, "/msg2" );
+        appendMessage( store, "/msg9", 1 );
+        check( store.getCount() == 3, test, "no message is overwritten" );
+    }
+
+    LogMessageStore store( core, basePath( test ) );
+    store.open();
+    vector<glQueuedMessage> messages = readAll( store );
+    check( messages.size() == 3, test, "all messages are kept" );
+    check( messages.size() == 3 && messages[ 0 ].id == 1 && messages[ 0 ].path == "/msg9", test, "the moved message keeps its id" );
+    check( messages.size() == 3 && messages[ 2 ].id == 3 && messages[ 2 ].path == "/msg1", test, "the stored message is renumbered" );
+}
+
+
+int main( int argc, const char * argv[] )
+{
+    char dir[] = "/tmp/glsdk-log-tests-XXXXXX";
+    if( mkdtemp( dir ) == NULL ) {
+        printf( "Could not create a temporary directory\n" );
+        return 1;
+    }
+    logDir = dir;
+
+    core = new Core( NULL, "TEST", "test-device", DB_MEMORY_PATH, "http://127.0.0.1:1" );
+
+    testChecksum();
+    testTornTail();
+    testCursor();
+    testRenumber();
+
+    printf( failures == 0 ? "All message log tests passed\n" : "%d message log checks failed\n", failures );
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+//
+//  main.cpp
+//  GlassLab SDK Timing
+//
+//  This program times the telemetry path with the database in a file and in
+//  memory (DB_MEMORY_PATH): saveTelemEvent, sendTelemEvents with the write to the
+//  message queue, and flushMsgQ turning the queue into requests. The server
+//  address is not reachable, so a flush covers reading and rewriting the queue
+//  and the failed connection of each request, not a server round trip. It also
+//  times destroying an in-memory Core, which snapshots the queue to a file, and
+//  restoring that snapshot, and fails if the queued batches are not restored.
+//
+//  The SDK logs to stdout, the timings are written to stderr:
+//  ./timing > /dev/null
+//
+//  Build it with the SDK sources, for example:
+//  g++ -std=c++11 -O2 -DMULTITHREADED -DZLIB_COMPRESSION -I../../../headers -I../../../deps/include/libjansson
+//      -I../../../deps/src/CppSQLite-master/src main.cpp ../../../src/*.cpp
+//      ../../../deps/src/CppSQLite-master/src/CppSQLite3.cpp -ljansson -lsqlite3 -levent -lpthread -lz
+//
+//  Copyright (c) 2014 GlassLab. All rights reserved.
+//
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "glasslab_sdk.h"
+#include "glsdk_config.h"
+
+using namespace nsGlasslabSDK;
+
+
+// Events per batch and batches per run
+const int eventsPerBatch = 100;
+const int batches = 50;
+
+const char* connectUri = "http://127.0.0.1:1";
+const char* deviceId = "timing-device";
+const char* playerHandle = "timing";
+
+SystemClock timer;
+
+
+void report( const char* mode, const char* what, int64_t micros, int count ) {
+    fprintf( stderr, "%-8s %-36s %10.3f ms total %10.3f us each (%d)\n", mode, what, micros / 1000.0, (double)micros / count, count );
+}
+
+/**
+ * Captures the events of one batch.
+ */
+void saveBatch( Core* core, int batch ) {
+    for( int i = 0; i < eventsPerBatch; i++ ) {
+        core->addTelemEventValue( "batch", (int32_t)batch );
+        core->addTelemEventValue( "index", (int32_t)i );
+        core->addTelemEventValue( "score", 0.5 * i );
+        core->addTelemEventValue( "item", "timing item" );
+        core->saveTelemEvent( "Timing_event" );
+    }
+}
+
+/**
+ * Times saveTelemEvent and sendTelemEvents on a Core using the given data path.
+ */
+void timeCapture( const char* mode, const char* dataPath ) {
+    Core* core = new Core( NULL, "TIMING", deviceId, dataPath, connectUri );
+    core->setPlayerHandle( playerHandle );
+    core->flushStorageWrites();
+
+    int64_t saveMicros = 0;
+    int64_t sendMicros = 0;
+    int64_t writeMicros = 0;
+    for( int batch = 0; batch < batches; batch++ ) {
+        int64_t start = timer.monotonicMicros();
+        saveBatch( core, batch );
+        int64_t saved = timer.monotonicMicros();
+        core->sendTelemEvents();
+        int64_t sent = timer.monotonicMicros();
+        core->flushStorageWrites();
+        int64_t written = timer.monotonicMicros();
+
+        saveMicros += saved - start;
+        sendMicros += sent - saved;
+        writeMicros += written - saved;
+    }
+
+    report( mode, "saveTelemEvent", saveMicros, batches * eventsPerBatch );
+    report( mode, "sendTelemEvents", sendMicros, batches );
+    report( mode, "sendTelemEvents + flushStorageWrites", writeMicros, batches );
+
+    delete core;
+}
+
+/**
+ * Times flushMsgQ over a queue of telemetry batches. The queue has a DataSync of its
+ * own so the flush does not race the Core's periodic one.
+ */
+void timeFlush( const char* mode, const char* dataPath ) {
+    Core* core = new Core( NULL, "TIMING", deviceId, DB_MEMORY_PATH, connectUri );
+    core->setPlayerHandle( playerHandle );
+    core->setSessionId( "timing-session" );
+    glConfig config = core->config;
+    config.eventsMaxSize = batches;
+    core->setConfig( config );
+    core->flushStorageWrites();
+
+    // One batch rendered the way sendTelemEvents does
+    TelemetrySymbols symbols;
+    TelemetryBuffer buffer;
+    buffer.setSymbols( &symbols );
+    for( int i = 0; i < eventsPerBatch; i++ ) {
+        buffer.addValue( "index", (int64_t)i );
+        buffer.addValue( "item", "timing item" );
+        buffer.commitEvent( "Timing_event", timer.wallMillis(), i + 1, i + 1, 0.0f, "TIMING", "timing-play-session", deviceId, "", "" );
+    }
+    json_t* events = buffer.toJSON( Const::TelemFormat_Legacy );
+    char* postdata = json_dumps( events, JSON_COMPACT );
+    json_decref( events );
+
+    string sessionDeviceId = string( playerHandle ) + "_" + deviceId;
+    DataSync* dataSync = new DataSync( core, dataPath );
+    dataSync->open();
+    for( int batch = 0; batch < batches; batch++ ) {
+        dataSync->addToMsgQ( sessionDeviceId, API_POST_EVENTS, "POST", Const::Callback_SendTelemEvent, postdata, "application/json" );
+    }
+    dataSync->flushWrites();
+    free( postdata );
+
+    int64_t start = timer.monotonicMicros();
+    dataSync->flushMsgQ();
+    dataSync->flushWrites();
+    report( mode, "flushMsgQ", timer.monotonicMicros() - start, batches );
+
+    delete dataSync;
+    delete core;
+}
+
+/**
+ * Times destroying an in-memory Core with a snapshot file, which applies the queued
+ * writes and snapshots the queue, then restoring the snapshot into a new queue.
+ * Returns false if fewer messages come back than batches were sent.
+ */
+bool timeSnapshot( const char* snapshotPath ) {
+    Core* core = new Core( NULL, "TIMING", deviceId, DB_MEMORY_PATH, connectUri );
+    core->setPlayerHandle( playerHandle );
+    core->setDatabaseSnapshot( snapshotPath, 0 );
+    for( int batch = 0; batch < batches; batch++ ) {
+        saveBatch( core, batch );
+        core->sendTelemEvents();
+    }
+
+    // The writes are still queued, the destructor has to apply them before the snapshot
+    int64_t start = timer.monotonicMicros();
+    delete core;
+    report( "memory", "delete Core with snapshot", timer.monotonicMicros() - start, 1 );
+
+    Core* restoreCore = new Core( NULL, "TIMING", deviceId, DB_MEMORY_PATH, connectUri );
+    DataSync* dataSync = new DataSync( restoreCore, DB_MEMORY_PATH );
+    dataSync->open();
+    start = timer.monotonicMicros();
+    dataSync->setSnapshot( snapshotPath, 0 );
+    dataSync->flushWrites();
+    report( "memory", "restore snapshot", timer.monotonicMicros() - start, 1 );
+
+    int restored = dataSync->getMessageTableSize();
+    fprintf( stderr, "memory   %d messages restored from the snapshot for %d batches\n", restored, batches );
+
+    delete dataSync;
+    delete restoreCore;
+    return restored >= batches;
+}
+
+
+int main( int argc, const char * argv[] )
+{
+    char dir[] = "/tmp/glsdk-timing-XXXXXX";
+    if( mkdtemp( dir ) == NULL ) {
+        printf( "Could not create a temporary directory\n" );
+        return 1;
+    }
+    string captureDir = string( dir ) + "/capture";
+    string flushDir = string( dir ) + "/flush";
+    mkdir( captureDir.c_str(), 0700 );
+    mkdir( flushDir.c_str(), 0700 );
+
+    fprintf( stderr, "%d batches of %d events\n", batches, eventsPerBatch );
+    timeCapture( "file", captureDir.c_str() );
+    timeCapture( "memory", DB_MEMORY_PATH );
+    timeFlush( "file", flushDir.c_str() );
+    timeFlush( "memory", DB_MEMORY_PATH );
+    if( !timeSnapshot( ( string( dir ) + "/snapshot.db" ).c_str() ) ) {
+        fprintf( stderr, "The snapshot taken when the Core was destroyed is incomplete\n" );
+        return 1;
+    }
+    return 0;
+}
@@ -68,6 +68,7 @@ either expressed or implied, of the FreeBSD Project.
 #include <vector>
 #include <map>
 #include <queue>
+#include <deque>
 #include <cstdio>
 #include <time.h>
 
@@ -122,6 +123,11 @@ class GlasslabSDK {
 		/* APIIMPORT should be removed when running the lib example */
         GlasslabSDK( const char* clientId, const char* deviceId, const char* dataPath = NULL, const char* uri = NULL );
 
+        // Destroying the SDK waits for the request being sent, applies the queued storage writes,
+        // takes the setDatabaseSnapshot() snapshot and closes the database. Messages still in the
+        // queue are sent by the next instance.
+        ~GlasslabSDK();
+
         // Message stack functions
         nsGlasslabSDK::Const::Status APIIMPORT getLastStatus();
         void APIIMPORT popMessageStack();
@@ -151,7 +157,13 @@ class GlasslabSDK {
         void APIIMPORT updateMatch( int matchId, const char* data, int nextPlayerTurn );
         void APIIMPORT sendTelemEvents();
         void APIIMPORT forceFlushTelemEvents();
+        void APIIMPORT flushStorageWrites();
         void APIIMPORT cancelRequest( const char* key );
+        bool APIIMPORT cancelRequestHandle( int handle );
+        int  APIIMPORT getLastRequestHandle();
+        int  APIIMPORT getClockSkew();
+        void APIIMPORT setResponseCacheTTL( const char* key, int seconds );
+        void APIIMPORT clearResponseCache();
     
         // Telemetry event values
         // One for every data type, need for extern "C" support
@@ -170,6 +182,37 @@ class GlasslabSDK {
         void APIIMPORT clearTelemEventValues();
         void APIIMPORT saveTelemEvent( const char* name );
 
+        // Interned telemetry keys and event names, returns handles for the overloads below
+        int APIIMPORT registerTelemKey( const char* key );
+        int APIIMPORT registerTelemEventName( const char* name );
+        void APIIMPORT addTelemEventValue( int keyHandle, const char* value );
+        void APIIMPORT addTelemEventValue( int keyHandle, int8_t value );
+        void APIIMPORT addTelemEventValue( int keyHandle, int16_t value );
+        void APIIMPORT addTelemEventValue( int keyHandle, int32_t value );
+        void APIIMPORT addTelemEventValue( int keyHandle, uint8_t value );
+        void APIIMPORT addTelemEventValue( int keyHandle, uint16_t value );
+        void APIIMPORT addTelemEventValue( int keyHandle, uint32_t value );
+        void APIIMPORT addTelemEventValue( int keyHandle, float value );
+        void APIIMPORT addTelemEventValue( int keyHandle, double value );
+        void APIIMPORT addTelemEventValue( int keyHandle, bool value );
+        void APIIMPORT saveTelemEvent( int nameHandle );
+
+        // Telemetry events with a priority, lower is more important
+        void APIIMPORT saveTelemEvent( const char* name, int priority );
+        void APIIMPORT saveTelemEvent( int nameHandle, int priority );
+        bool APIIMPORT isTelemPriorityEnabled( int priority );
+
+        // Telemetry aggregated locally and sent as one summary event per window
+        void APIIMPORT incrementTelemCounter( const char* name, int delta );
+        void APIIMPORT setTelemGauge( const char* name, double value );
+        void APIIMPORT defineTelemHistogram( const char* name, const double* bounds, int boundCount );
+        void APIIMPORT recordTelemHistogram( const char* name, double value );
+        void APIIMPORT flushTelemAggregates();
+
+        // Per event name sampling and rate limits, overridden by the server config
+        void APIIMPORT setTelemEventSampleRate( const char* name, float sampleRate );
+        void APIIMPORT setTelemEventRateLimit( const char* name, float ratePerSec, int burst );
+
         // These functions allow for control over the user info data structure
         void APIIMPORT updatePlayerInfoKey( const char* key, const char* value );
         void APIIMPORT updatePlayerInfoKey( const char* key, int8_t value );
@@ -195,6 +238,8 @@ class GlasslabSDK {
         void APIIMPORT removePlayerHandle( const char* handle );
         void APIIMPORT setCookie( const char* cookie );
         void APIIMPORT setAutoSessionManagement( bool state );
+        void APIIMPORT setMessageStore( int type );
+        void APIIMPORT setDatabaseSnapshot( const char* path, int intervalSecs );
 
         // Game timer functions
         void APIIMPORT startGameTimer();
@@ -206,6 +251,15 @@ class GlasslabSDK {
         // Getters
         const char APIIMPORT *getConnectUri();
         int APIIMPORT getUserId();
+        int APIIMPORT getTelemBufferedBytes();
+        int APIIMPORT getTelemBufferedEventCount();
+        int APIIMPORT getTelemDroppedEventCount();
+        int APIIMPORT getTelemFilteredEventCount();
+        int APIIMPORT getTelemSampledOutEventCount();
+        int APIIMPORT getMessageQueueEvictedCount();
+        int APIIMPORT getMessageQueueEvictedBytes();
+        int APIIMPORT getMessageQueueDroppedCount();
+        int APIIMPORT getMessageStore();
         const char APIIMPORT *getCookie();
     const char APIIMPORT *getMatchForId( int matchId );
 
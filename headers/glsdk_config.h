@@ -41,17 +41,47 @@ either expressed or implied, of the FreeBSD Project.
 //
 
 
-#define SDK_VERSION	"1.6.0"
+#define SDK_VERSION	"1.6.3"
 
 #define DB_MESSAGE_CAP 32000
+#define DB_MESSAGE_BYTE_CAP 16 * 1024 * 1024
+#define DB_MESSAGE_COMPRESS_MIN_SIZE 256
+#define DB_MESSAGE_CODEC_DEFLATE "deflate"
+#define DB_LOG_SEGMENT_SIZE 1024 * 1024
+#define DB_MEMORY_PATH ":memory:"
+// Bump when a table schema changes, older databases are migrated on open
+#define DB_SCHEMA_VERSION 3
+
+#define RESPONSE_CACHE_TTL_USER_INFO 60
+#define RESPONSE_CACHE_TTL_PLAYER_INFO 0
+#define RESPONSE_CACHE_TTL_COURSES 60
 
 #define SESSION_TIMEOUT 60 * 10
 
+#define CLOCK_SKEW_SMOOTHING 0.25
+#define CLOCK_SKEW_MAX_RTT_MS 5000
+#define CLOCK_SKEW_RESET_MS 60 * 1000
+
 #define THROTTLE_PRIORITY_DEFAULT 10
+#define TELEM_PRIORITY_DEFAULT 1
 #define THROTTLE_INTERVAL_DEFAULT 30
 #define THROTTLE_MIN_SIZE_DEFAULT 5
 #define THROTTLE_MAX_SIZE_DEFAULT 50
 
+#define TELEM_ARENA_SIZE_DEFAULT 64 * 1024
+#define TELEM_MAX_VALUES_DEFAULT 2048
+#define TELEM_MAX_EVENTS_DEFAULT 512
+#define TELEM_MAX_SYMBOLS_DEFAULT 1024
+#define TELEM_MAX_BUFFER_BYTES_DEFAULT 256 * 1024
+#define TELEM_BATCH_ARENA_SIZE_DEFAULT 1024
+#define TELEM_BATCH_MAX_VALUES_DEFAULT 32
+#define TELEM_AGGREGATE_PERIOD_DEFAULT 60
+#define TELEM_LIMIT_SUMMARY_EVENT "Telemetry_sampled_out"
+
+#define TELEM_BINARY_MAGIC "GLT2"
+#define TELEM_BINARY_MAGIC_V1 "GLT1"
+#define TELEM_BINARY_CONTENT_TYPE "application/x-glasslab-telemetry"
+
 #define API_CONNECT					"/sdk/connect"
 #define API_GET_CONFIG        		"/api/v2/data/config/:gameId"
 #define API_POST_REGISTER			"/api/v2/auth/user/register"
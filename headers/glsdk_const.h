@@ -52,6 +52,12 @@ namespace nsGlasslabSDK {
         int eventsMinSize;
         int eventsMaxSize;
         int eventsDetailLevel;
+        int eventsMaxBufferBytes;
+        int eventsBatchFormat;
+        int eventsAggregatePeriodSecs;
+        int eventsQueuePolicy;
+        int eventsQueueMaxBytes;
+        int eventsSendCompressed;
     } glConfig;
 
     typedef struct _glUserInfo {
@@ -67,6 +73,66 @@ namespace nsGlasslabSDK {
             Status_Ok = 0,
             Status_Error
         };
+
+        // Wire formats for telemetry batches
+        enum TelemFormat {
+            TelemFormat_Legacy = 0,     // array of events, each with its own context fields
+            TelemFormat_Envelope,       // shared fields stored once, events grouped by context
+            TelemFormat_Binary          // varint/dictionary/columnar encoding, see TelemetryBuffer::encodeBinary
+        };
+
+        // What to remove when MSG_QUEUE reaches its row or byte cap. Only telemetry is evicted,
+        // a new row is refused if the telemetry queued is not enough to make room for it
+        enum QueuePolicy {
+            QueuePolicy_DropNewest = 0,         // refuse new rows
+            QueuePolicy_DropOldest,             // same as QueuePolicy_DropOldestTelemetry, kept for server configs
+            QueuePolicy_DropOldestTelemetry     // evict the oldest telemetry
+        };
+
+        // Storage backends for the message queue
+        enum QueueStore {
+            QueueStore_SQLite = 0,              // MSG_QUEUE table in the SQLite database
+            QueueStore_Log                      // append-only segment files next to the database
+        };
+
+        // Core request callbacks, the ids index Core's callback table and are stored
+        // in MSG_QUEUE, so new callbacks are only ever appended before Callback_Count
+        enum CoreCallback {
+            Callback_None = -1,
+            Callback_GetConnect = 0,
+            Callback_GetConfig,
+            Callback_DeviceUpdate,
+            Callback_AuthStatus,
+            Callback_Register,
+            Callback_GetPlayerInfo,
+            Callback_GetUserInfo,
+            Callback_Login,
+            Callback_Logout,
+            Callback_Enroll,
+            Callback_Unenroll,
+            Callback_GetCourses,
+            Callback_StartPlaySession,
+            Callback_StartSession,
+            Callback_EndSession,
+            Callback_SaveGame,
+            Callback_GetSaveGame,
+            Callback_DeleteSaveGame,
+            Callback_SaveAchievement,
+            Callback_SavePlayerInfo,
+            Callback_SendTotalTimePlayed,
+            Callback_CreateMatch,
+            Callback_UpdateMatch,
+            Callback_PollMatches,
+            Callback_SendTelemEvent,
+            Callback_Count
+        };
+
+        // Kinds of locally aggregated telemetry
+        enum TelemAggregate {
+            TelemAggregate_Counter = 0, // sum of increments
+            TelemAggregate_Gauge,       // last, min, max and mean of the values set
+            TelemAggregate_Histogram    // count, sum, min, max and fixed bucket counts
+        };
         
         enum Message {
             Message_None = 0,
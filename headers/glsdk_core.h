@@ -52,6 +52,8 @@ either expressed or implied, of the FreeBSD Project.
 
 using namespace std;
 
+#include <atomic>
+
 #include "glsdk_const.h"
 #include "glsdk_data_sync.h"
 
@@ -66,9 +68,9 @@ namespace nsGlasslabSDK {
     typedef void(*CoreCallback_Func)(p_glSDKInfo);
 
     typedef struct _coreCallbackStructure {
+        const char* name;
         CoreCallback_Func coreCB;
-        bool cancel;
-        string requestType;
+        const char* requestType;
     } coreCallbackStructure;
 
     typedef struct _p_glSDKInfo {
@@ -85,8 +87,17 @@ namespace nsGlasslabSDK {
         struct event_base*          base;
         struct evhttp_connection*   conn;
         struct evhttp_request*      req;
-        string                      coreCBKey;
+        int                         coreCBId;
         int                         msgQRowId;
+        int                         handle;
+        string                      cacheKey;
+        bool                        revalidated;    // sent with the cached copy's validators
+        bool                        retryUncached;  // answered 304 after the cached copy was removed
+        string                      path;
+        string                      requestType;
+        string                      contentType;
+        int*                        pending;    // requests still unanswered on base
+        int64_t                     sentMicros; // Clock::monotonicMicros when sent
     } p_glHttpRequest;
     
     static int DEBUG_NUMBER = 0;
@@ -96,10 +107,276 @@ namespace nsGlasslabSDK {
         int id;
         string path;
         string requestType;
-        string coreCB;
+        int coreCB;
         string postdata;
         string contentType;
         int rowId;
+        int handle;
+        int group;      // jobs of one group are sent concurrently, 0 for none
+    };
+
+    // Startup handshake steps, see s_startupDependencies
+    enum StartupStep {
+        Startup_Connect = 0,
+        Startup_Config,
+        Startup_PlaySession,
+        Startup_AuthStatus,
+        Startup_Count
+    };
+
+    // A request that is queued or being sent, cancelling it ignores the response.
+    // Identical GETs of read-only endpoints are attached as followers of the first one (the leader).
+    typedef struct _glRequestState {
+        int coreCB;
+        bool cancelled;
+        int leader;
+        string flightKey;
+        vector<int> followers;
+    } glRequestState;
+
+
+    // Value types recorded in the telemetry capture arena
+    enum TelemValueType {
+        TelemValue_String = 0,
+        TelemValue_Integer,
+        TelemValue_Real,
+        TelemValue_Boolean,
+        // JSON text stored like a string, rendered as a nested value
+        TelemValue_JSON
+    };
+
+    // Keys and event names are string references: either an offset into the
+    // TelemetryBuffer arena, or an interned symbol handle tagged with this bit.
+    #define TELEM_SYMBOL_FLAG 0x80000000u
+
+    // A single typed key/value pair belonging to a telemetry event. Strings are
+    // stored as offsets into the owning TelemetryBuffer arena.
+    typedef struct _glTelemValue {
+        uint32_t        key;
+        int             type;
+        union {
+            uint32_t    s;
+            int64_t     i;
+            double      r;
+            bool        b;
+        } v;
+    } glTelemValue;
+
+    // The per-event fields that rarely change between events (arena offsets)
+    typedef struct _glTelemContext {
+        uint32_t        gameId;
+        uint32_t        playSessionId;
+        uint32_t        deviceId;
+        uint32_t        clientVersion;
+        uint32_t        gameLevel;
+    } glTelemContext;
+
+    // A captured telemetry event, referencing its context and a range of values
+    typedef struct _glTelemEvent {
+        uint32_t        name;
+        uint32_t        context;
+        int64_t         clientTimeMillis;
+        int             gameSessionEventOrder;
+        int             playSessionEventOrder;
+        float           totalTimePlayed;
+        uint32_t        firstValue;
+        uint32_t        numValues;
+    } glTelemEvent;
+
+    // Interned telemetry keys and event names, shared by every capture buffer of
+    // a Core. Registration takes a lock, lookups are lock-free.
+    class TelemetrySymbols {
+        public:
+            TelemetrySymbols();
+            ~TelemetrySymbols();
+
+            // Intern a key or event name, returning its handle (-1 on failure)
+            int registerSymbol( const char* symbol );
+            bool isSymbol( int handle ) const;
+            const char* getSymbol( int handle ) const;
+
+        private:
+            pthread_mutex_t         m_mutex;
+            map<string, int>        m_handles;
+            char**                  m_symbols;
+            std::atomic<int>        m_count;
+    };
+
+    // Telemetry capture buffer. Events are recorded as typed records into a
+    // preallocated arena and only rendered to a wire format at batch time, so
+    // steady-state capture does not touch the heap.
+    class TelemetryBuffer {
+        public:
+            TelemetryBuffer();
+
+            // Reserve the arena and record storage up front
+            void reserve( size_t arenaBytes, size_t maxValues, size_t maxEvents );
+
+            // Symbol table used to resolve key and event name handles
+            void setSymbols( const TelemetrySymbols* symbols );
+
+            // Values for the event under construction
+            void addValue( const char* key, const char* value );
+            void addValue( const char* key, int64_t value );
+            void addValue( const char* key, double value );
+            void addValue( const char* key, bool value );
+            void addValue( int keyHandle, const char* value );
+            void addValue( int keyHandle, int64_t value );
+            void addValue( int keyHandle, double value );
+            void addValue( int keyHandle, bool value );
+            void addJSONValue( const char* key, const char* json );
+            void discardValues();
+
+            // Close the event under construction using the current values
+            void commitEvent( const char* name, int64_t clientTimeMillis, int gameSessionEventOrder, int playSessionEventOrder, float totalTimePlayed,
+                              const char* gameId, const char* playSessionId, const char* deviceId, const char* clientVersion, const char* gameLevel );
+            void commitEvent( int nameHandle, int64_t clientTimeMillis, int gameSessionEventOrder, int playSessionEventOrder, float totalTimePlayed,
+                              const char* gameId, const char* playSessionId, const char* deviceId, const char* clientVersion, const char* gameLevel );
+
+            // Remove all committed events, keeping the reserved storage and the event under construction
+            void clear();
+
+            // Give back storage grown past the given reserve, only once the buffer is empty
+            void trim( size_t arenaBytes, size_t maxValues, size_t maxEvents );
+
+            // Copy the committed events of another buffer sharing the same symbols
+            void append( const TelemetryBuffer& other );
+
+            // Render all committed events in a Const::TelemFormat (caller owns the reference)
+            json_t* toJSON( int format ) const;
+
+            // Binary format body, the payload header with the gameSessionId is added by wrapBinary
+            void encodeBinary( string& out, int64_t clockSkewMs = 0 ) const;
+            static string wrapBinary( const string& body, const string& gameSessionId );
+            static json_t* decodeBinary( const string& payload );
+            static string toBase64( const string& data );
+            static string fromBase64( const string& text );
+
+            size_t getEventCount() const;
+            size_t getByteSize() const;
+            const char* getString( uint32_t ref ) const;
+
+        private:
+            glTelemValue* mf_pendingValue( const char* key );
+            glTelemValue* mf_pendingValue( int keyHandle );
+            void mf_commitEvent( uint32_t name, int64_t clientTimeMillis, int gameSessionEventOrder, int playSessionEventOrder, float totalTimePlayed,
+                                 const char* gameId, const char* playSessionId, const char* deviceId, const char* clientVersion, const char* gameLevel );
+            uint32_t mf_storeString( const char* value );
+            uint32_t mf_copyString( const TelemetryBuffer& other, uint32_t ref );
+            json_t* mf_eventToJSON( const glTelemEvent& event ) const;
+            static uint32_t mf_dictionaryRef( const char* value, map<string, uint32_t>& dictionary, vector<const char*>& strings );
+            static void mf_writeVarint( string& out, uint64_t value );
+            static void mf_writeSignedVarint( string& out, int64_t value );
+            static void mf_writeFixed( string& out, uint64_t value, int bytes );
+            static uint64_t mf_readVarint( const string& in, size_t& pos, bool& ok );
+            static int64_t mf_readSignedVarint( const string& in, size_t& pos, bool& ok );
+            static uint64_t mf_readFixed( const string& in, size_t& pos, int bytes, bool& ok );
+            static string mf_readString( const string& in, size_t& pos, bool& ok );
+            void mf_contextToJSON( const glTelemContext& context, json_t* target ) const;
+            uint32_t mf_storeContext( const char* gameId, const char* playSessionId, const char* deviceId, const char* clientVersion, const char* gameLevel );
+
+            vector<char>            m_arena;
+            vector<glTelemValue>    m_values;
+            vector<glTelemEvent>    m_events;
+            vector<glTelemContext>  m_contexts;
+
+            const TelemetrySymbols* m_symbols;
+
+            // Index of the first value and first arena byte belonging to the event under construction
+            size_t                  m_pendingValues;
+            size_t                  m_pendingArena;
+    };
+
+    // Streaming writer for request bodies, a JSON object or a form-urlencoded list.
+    // Keys and string values are escaped for the body type.
+    class RequestWriter {
+        public:
+            RequestWriter();
+
+            void beginJSON();
+            void beginForm();
+            void addString( const char* key, const char* value );
+            void addInteger( const char* key, int64_t value );
+            void addReal( const char* key, double value, int decimals );
+            void addBoolean( const char* key, bool value );
+            void addRaw( const char* key, const char* value );
+            const string& finish();
+
+        private:
+            void mf_writeKey( const char* key );
+            void mf_writeEscaped( const char* value );
+
+            string  m_buffer;
+            bool    m_json;
+            bool    m_first;
+    };
+
+    struct TelemetryProducer;
+
+    // A telemetry event captured on one thread, published to the Core as a unit
+    struct TelemetryBatch {
+        TelemetryBuffer             buffer;
+        TelemetryBatch*             next;
+        TelemetryProducer*          owner;
+    };
+
+    // Per-thread telemetry capture state. The batch under construction is only
+    // touched by its thread; drained batches come back through the returned stack.
+    struct TelemetryProducer {
+        TelemetryBatch*                 current;
+        TelemetryBatch*                 freeList;
+        std::atomic<TelemetryBatch*>    returned;
+        std::atomic<bool>               retired;
+        TelemetryProducer*              next;
+    };
+
+    // Locally accumulated telemetry, emitted as one summary event per window.
+    // Histogram buckets count values <= each bound, the last bucket counts the rest.
+    struct TelemetryAggregate {
+        int             type;
+        int64_t         count;
+        double          sum;
+        double          min;
+        double          max;
+        double          last;
+        vector<double>  bounds;
+        vector<int64_t> buckets;
+    };
+
+    // Sampling and token bucket rate limit for one event name. A sample rate of
+    // 1 keeps every event, a rate of 0 events per second disables the limit.
+    struct TelemetryEventLimit {
+        float   sampleRate;
+        float   ratePerSec;
+        float   burst;
+        float   tokens;
+        int64_t lastRefill;     // Clock::monotonicMicros
+        int64_t sampledOut;
+        int64_t rateLimited;
+    };
+
+    // Time source of the SDK. Durations are measured on a monotonic clock that
+    // wall-clock changes do not affect, event timestamps come from the wall clock.
+    // Core::setClock() replaces it, e.g. with a manually advanced clock in tests.
+    class Clock {
+        public:
+            virtual ~Clock() {}
+
+            // Microseconds from an arbitrary fixed origin, never goes backwards
+            virtual int64_t monotonicMicros() = 0;
+            // Milliseconds since the Unix epoch
+            virtual int64_t wallMillis() = 0;
+
+            static double secondsBetween( int64_t fromMicros, int64_t toMicros ) {
+                return ( toMicros - fromMicros ) / 1000000.0;
+            }
+    };
+
+    // The default Clock, backed by std::chrono::steady_clock and system_clock
+    class SystemClock : public Clock {
+        public:
+            int64_t monotonicMicros();
+            int64_t wallMillis();
     };
 
     // used for client connection (get config), login, start/end session
@@ -147,28 +424,43 @@ namespace nsGlasslabSDK {
             void pollMatches();
             void sendTelemEvents();
             void forceFlushTelemEvents();
+            void flushStorageWrites();
             void attemptMessageDispatch();
-            void mf_httpGetRequest( string path, string requestType, string coreCB, string postdata = "", const char* contentType = NULL, int rowId = -1 ); // Synchronous HTTP Get Request
+            void mf_httpGetRequest( string path, string requestType, int coreCB, string postdata = "", const char* contentType = NULL, int rowId = -1, const char* contentEncoding = NULL, int handle = -1, bool useCache = true ); // Synchronous HTTP Get Request
+            void mf_httpGetRequests( std::vector<HTTPThreadData*>& jobs ); // Synchronous, concurrent HTTP requests
         
-            void do_httpGetRequest( string path, string requestType, string coreCB, string postdata = "", string contentType = "", int rowId = -1 ); // Selects whether to do async or not
+            int do_httpGetRequest( string path, string requestType, int coreCB, const string& postdata = "", string contentType = "", int rowId = -1 ); // Selects whether to do async or not, returns the request handle
             // Allow the user to cancel a request from being sent to the server, or ignore the response
             void cancelRequest( const char* requestKey );
-
-            // Callback map functions
-            CoreCallback_Func getCoreCallback( string key );
-            bool getCoreCallbackCancelState( string key );
-            void setCoreCallbackCancelState( string key, bool state );
-            const char* getCoreCallbackRequestType( string key );
+            bool cancelRequestHandle( int handle );
+            int getLastRequestHandle();
+            int getClockSkew();
+            bool isRequestCancelled( int handle );
+            void mf_runCoreCallback( int handle, int coreCB, p_glSDKInfo& sdkInfo );
+
+            // HTTP response cache for GETs, seconds < 0 disables caching for the request key
+            void setResponseCacheTTL( const char* requestKey, int seconds );
+            void clearResponseCache();
+            bool mf_cacheResponse( struct evhttp_request* req, const string& cacheKey, string& data );
+            void mf_sampleClockSkew( struct evhttp_request* req, int64_t sentMicros );
+
+            // Callback table functions
+            CoreCallback_Func getCoreCallback( int id );
+            const char* getCoreCallbackRequestType( int id );
+            int getCoreCallbackId( const char* name );
+            const char* getCoreCallbackName( int id );
 
             // Match map functions
             const char* getMatchForId( int matchId );
             void setMatchForId( int id, const char* data );
 
             // SQLite message queue functions
-            void mf_addMessageToDataQueue( string path, string requestType, string coreCB, string postdata = "", const char* contentType = NULL );
+            void mf_addMessageToDataQueue( string path, string requestType, int coreCB, const string& postdata = "", const char* contentType = NULL );
             void mf_updateMessageStatusInDataQueue( int rowId, string status );
             // SQLite session table functions
             void mf_updateTotalTimePlayedInSessionTable( float totalTimePlayed );
+            bool mf_getSession( string deviceId, glSession& session );
+            void mf_mergeSessions( const map<string, glSession>& sessions );
         
             // Telemetry event values
             void addTelemEventValue( const char* key, const char* value );
@@ -186,6 +478,50 @@ namespace nsGlasslabSDK {
             void clearTelemEventValues();
             void saveTelemEvent( const char* name );
 
+            // Interned telemetry keys and event names
+            int registerTelemKey( const char* key );
+            int registerTelemEventName( const char* name );
+            void addTelemEventValue( int keyHandle, const char* value );
+            void addTelemEventValue( int keyHandle, int8_t value );
+            void addTelemEventValue( int keyHandle, int16_t value );
+            void addTelemEventValue( int keyHandle, int32_t value );
+            void addTelemEventValue( int keyHandle, uint8_t value );
+            void addTelemEventValue( int keyHandle, uint16_t value );
+            void addTelemEventValue( int keyHandle, uint32_t value );
+            void addTelemEventValue( int keyHandle, float value );
+            void addTelemEventValue( int keyHandle, double value );
+            void addTelemEventValue( int keyHandle, bool value );
+            void saveTelemEvent( int nameHandle );
+
+            // Telemetry events with a priority, filtered by config.eventsDetailLevel
+            void saveTelemEvent( const char* name, int priority );
+            void saveTelemEvent( int nameHandle, int priority );
+            bool isTelemPriorityEnabled( int priority );
+
+            // Telemetry held in memory, dropped (none since over-budget events are spilled) and filtered by priority
+            int getTelemBufferedBytes();
+            int getTelemBufferedEventCount();
+            int getTelemDroppedEventCount();
+            int getTelemFilteredEventCount();
+
+            // Telemetry aggregated locally, summarized once per config.eventsAggregatePeriodSecs
+            void incrementTelemCounter( const char* name, int delta );
+            void setTelemGauge( const char* name, double value );
+            void defineTelemHistogram( const char* name, const double* bounds, int boundCount );
+            void recordTelemHistogram( const char* name, double value );
+            void flushTelemAggregates();
+
+            // Per event name sampling and rate limits, the server may override them in getConfig
+            void setTelemEventSampleRate( const char* name, float sampleRate );
+            void setTelemEventRateLimit( const char* name, float ratePerSec, int burst );
+            int getTelemSampledOutEventCount();
+
+            // Message queue rows evicted by the overflow policy and new rows dropped
+            int getMessageQueueEvictedCount();
+            int getMessageQueueEvictedBytes();
+            int getMessageQueueDroppedCount();
+            int getMessageStore();
+
             // These functions allow for control over the user info data structure
             void updatePlayerInfoKey( const char* key, const char* value );
             void updatePlayerInfoKey( const char* key, int8_t value );
@@ -221,14 +557,18 @@ namespace nsGlasslabSDK {
             void setUserId( int userId );
             void setConfig( nsGlasslabSDK::glConfig config );
             void setTime( time_t time );
+            void setClock( Clock* clock );
             void setPlayerHandle( const char* handle );
             void removePlayerHandle( const char* handle );
             void setCookie( const char* cookie );
             void setPlaySessionId( const char* sessionId );
             void setSessionId( const char* sessionId );
             void setAutoSessionManagement( bool state );
+            void setMessageStore( int type );
+            void setDatabaseSnapshot( const char* path, int intervalSecs );
         
             // Getters
+            Clock* getClock();
             const char* getConnectUri();
             int getUserId();
             const char* getId();
@@ -242,8 +582,10 @@ namespace nsGlasslabSDK {
             void setConnectedState( bool state );
             bool getConnectedState();
 
-            // Config object
+            // Config object, written under m_configMutex. Threads other than the game's read
+            // it with mf_getConfig()
             glConfig config;
+            glConfig mf_getConfig();
 
             // User info
             glUserInfo userInfo;
@@ -254,6 +596,16 @@ namespace nsGlasslabSDK {
             void logMessage( const char* message, const char* data = NULL );
             bool mf_checkForJSONErrors( json_t* root );
 
+            // Server config from getConfig, stored for the next start
+            void mf_applyServerConfig( json_t* root );
+            void mf_storeServerConfig( const char* json );
+            bool mf_hasServerConfig();
+
+            // Startup handshake progress, called from the *_Done callbacks
+            void mf_completeStartupStep( int step );
+            void mf_storageReady();
+            bool mf_isStartupStepPending( int step );
+
             // Debug logging pop
             const char* popLogQueue();
 
@@ -267,13 +619,23 @@ namespace nsGlasslabSDK {
             DataSync* m_dataSync;
 
             // State indicates if the user is connected
-            bool m_connected;
+            std::atomic<bool> m_connected;
 
             // State indicates if the SDK will automatically handle sessions
             bool m_autoSessionManagement;
 
             // General members
             string m_connectUri;
+            string m_connectUriResult;
+            string m_bootstrapUri;
+            bool m_serverConfigApplied;
+            void mf_loadServerConfig( string bootstrapUri, string gameId );
+            // Recorded by the constructor, the connect request is made once storage is ready
+            string m_startGameId;
+            string m_startUri;
+            std::atomic<bool> m_connectPending;
+            int mf_setConnectTarget( const char* gameId, const char* uri );
+            void mf_requestConnect();
             string m_cookie;
             string m_gameId;
             string m_gameSecret;
@@ -291,24 +653,109 @@ namespace nsGlasslabSDK {
             // JSON members
             json_error_t m_jsonError;
             json_t* m_userInfo;
-            json_t* m_telemEvents;
-            json_t* m_telemEventValues;
             json_t* m_playerInfo;
 
+            // Telemetry capture arena, holds the events drained from all producer threads
+            TelemetryBuffer m_telemBuffer;
+            TelemetrySymbols m_telemSymbols;
+
+            // Thread-local telemetry capture, published events are pushed onto a lock-free stack
+            pthread_t m_telemOwnerThread;
+            pthread_key_t m_telemProducerKey;
+            pthread_mutex_t m_telemContextMutex;
+            std::atomic<TelemetryProducer*> m_telemProducers;
+            std::atomic<TelemetryBatch*> m_telemPublished;
+            std::atomic<float> m_telemTimePlayed;
+
+            // Telemetry memory accounting, the arena totals mirror m_telemBuffer for other threads
+            std::atomic<size_t> m_telemBufferBytes;
+            std::atomic<size_t> m_telemBufferEvents;
+            std::atomic<size_t> m_telemPublishedBytes;
+            std::atomic<size_t> m_telemPublishedEvents;
+            std::atomic<int> m_telemDroppedEvents;
+            std::atomic<int> m_telemFilteredEvents;
+            std::atomic<bool> m_telemSpillRequested;
+            bool mf_acceptTelemPriority( int priority );
+            void mf_queueTelemEvents();
+            void mf_queueTelemBuffer( const TelemetryBuffer& buffer );
+            TelemetryProducer* mf_getTelemProducer();
+            TelemetryBatch* mf_acquireTelemBatch( TelemetryProducer* producer );
+            void mf_publishTelemBatch( TelemetryProducer* producer );
+            void mf_spillTelemEvents();
+            void mf_drainTelemEvents();
+            void mf_drainTelemEvents( TelemetryBuffer& target );
+            static void mf_retireTelemProducer( void* producer );
+
+            // Aggregated telemetry, summary events are written straight into m_telemBuffer
+            pthread_mutex_t m_telemAggregateMutex;
+            map<string, TelemetryAggregate> m_telemAggregates;
+            int64_t m_telemAggregateLast;
+            std::atomic<bool> m_telemAggregateFlushPending;
+            TelemetryAggregate* mf_getTelemAggregate( const char* name, int type );
+            void mf_emitTelemAggregates( bool force );
+
+            // Per event name limits, m_telemLimitCount lets unlimited events skip the lock
+            pthread_mutex_t m_telemLimitMutex;
+            map<string, TelemetryEventLimit> m_telemEventLimits;
+            std::atomic<int> m_telemLimitCount;
+            std::atomic<int> m_telemSampledOutEvents;
+            uint64_t m_telemSampleState;
+            bool mf_acceptTelemRate( const char* name );
+            double mf_telemSampleRandom();
+            TelemetryEventLimit& mf_getTelemEventLimit( const char* name );
+            void mf_commitTelemLimitSummary( int64_t& t, int windowSecs, bool& started, float& totalTimePlayed );
+
+            // Per-thread request body writer
+            pthread_key_t m_requestWriterKey;
+            RequestWriter& mf_getRequestWriter();
+            static void mf_releaseRequestWriter( void* writer );
+
+            // Clock used by the timers below (Clock::monotonicMicros) and for event timestamps
+            SystemClock m_systemClock;
+            std::atomic<Clock*> m_clock;
+
+            // Smoothed server minus device wall clock in ms, sampled from response Date headers
+            std::atomic<int64_t> m_clockSkewMs;
+            std::atomic<bool> m_clockSkewKnown;
+
             // Timer for delaying telemetry
-            time_t m_telemetryLastTime;
+            int64_t m_telemetryLastTime;
+
+            // Copy of the SESSION table, so reads never wait on the storage writer thread.
+            // m_sessionMutex also guards m_cookie, m_connectUri, m_bootstrapUri and the connection
+            // state restored from storage. m_configMutex guards config and is never held while
+            // taking another lock.
+            pthread_mutex_t m_sessionMutex;
+            pthread_mutex_t m_configMutex;
+            map<string, glSession> m_sessions;
+            std::atomic<bool> m_sessionsLoaded;
+            glSession& mf_session( const string& deviceId );
+            void mf_updatePlayerInfo( float totalTimePlayed );
+            void mf_restoreSessions( const map<string, glSession>& sessions );
+
+            // Total time played of the current device restored from storage, added to the player info on the owner thread
+            std::atomic<bool> m_timePlayedRestored;
+            float m_restoredTimePlayed;
+            void mf_applyRestoredTimePlayed();
+
+            // Set by the game before storage was ready, these win over the stored server config
+            bool m_connectUriSet;
+            bool m_configSet;
 
             // Local variable for event order
-            int m_gameSessionEventOrder;
-            int m_playSessionEventOrder;
+            std::atomic<int> m_gameSessionEventOrder;
+            std::atomic<int> m_playSessionEventOrder;
 
             // Game timer variables used for total time played
-            time_t m_gameTimerLast;
+            int64_t m_gameTimerLast;
             bool m_gameTimerActive;
 
             // Session timer variables used for auto session management
-            time_t m_sessionTimerLast;
+            int64_t m_sessionTimerLast;
             bool m_sessionTimerActive;
+
+            // Helper function for advancing the session timer before an event is saved, returns the event time in ms
+            int64_t mf_beginTelemEvent( float& totalTimePlayed );
         
             // Status members
             Const::Status m_lastStatus;
@@ -317,21 +764,49 @@ namespace nsGlasslabSDK {
             // Debug logging queue
             std::queue<std::string> m_logQueue;
 
-            // Helper function for callback setup
-            void mf_setupCallbacks();
-            // Callback function maps
-            map<string, coreCallbackStructure> m_coreCallbackMap;
-
             // Match maps
             map<int, const char*> m_matchesMap;
         
-            // Async http GET request queue
+            // Async http GET request queue, m_jobTriggerCondition is declared above for DataSync
             pthread_mutex_t m_jobQueueMutex = PTHREAD_MUTEX_INITIALIZER;
-            pthread_cond_t m_jobTriggerCondition = PTHREAD_COND_INITIALIZER;
-            std::queue<HTTPThreadData*> m_httpGetJobs;
+            std::deque<HTTPThreadData*> m_httpGetJobs;
             static void* proc_asyncHTTPGetRequests(void*);
             int mf_startAsyncHTTPRequestThread(); // Starts the async http GET request processor thread. Returns 0 on success.
-            bool threadStarted = false;
+            void mf_stopAsyncHTTPRequestThread(); // Lets the request being sent finish, then joins the thread.
+            std::atomic<bool> threadStarted;
+            bool m_httpThreadStopping; // Guarded by m_jobQueueMutex, no thread is started once it is set
+            pthread_t m_httpThread;
+
+            // Request handles, the requests that are queued or being sent and the GETs they share
+            int mf_newRequestHandle( int coreCB, const string& flightKey, bool apiCall, bool& attached, bool newFlight = false );
+            bool mf_mutationQueuedAfter( const string& flightKey );
+            void mf_endRequest( int handle );
+            bool mf_requestCancelled( int leader );
+            void mf_eraseRequest( int leader );
+            pthread_mutex_t m_requestMutex = PTHREAD_MUTEX_INITIALIZER;
+            map<int, glRequestState> m_activeRequests;
+            map<string, int> m_singleFlights;
+            int m_nextRequestHandle = 1;
+            int m_lastRequestHandle = -1;
+
+            // Response cache lifetimes, indexed by Const::CoreCallback (-1 when not cached)
+            int m_responseCacheTTL[ Const::Callback_Count ];
+
+            // Requests sharing an event base, jobs queued between the group calls on one thread form a group
+            p_glHttpRequest* mf_prepareHttpRequest( struct event_base* base, int* pending, string path, string requestType, int coreCB, string postdata, const char* contentType, int rowId, const char* contentEncoding, int handle, bool useCache = true );
+            void mf_finishHttpRequest( p_glHttpRequest* httpRequest );
+            void mf_beginRequestGroup();
+            void mf_endRequestGroup();
+            pthread_key_t m_requestGroupKey;
+            int m_nextRequestGroup = 1;
+
+            // Startup handshake, each step is issued once the step it depends on has completed
+            void mf_startStartup();
+            void mf_issueStartupStep( int step );
+            void mf_requestConfig();
+            pthread_mutex_t m_startupMutex = PTHREAD_MUTEX_INITIALIZER;
+            bool m_startupIssued[ Startup_Count ];
+            bool m_startupDone[ Startup_Count ];
     };
 };
 #pragma GCC visibility pop
@@ -49,46 +49,235 @@ either expressed or implied, of the FreeBSD Project.
 #define CONFIG_TABLE_NAME "CONFIG"
 #define MSG_QUEUE_TABLE_NAME "MSG_QUEUE"
 #define SESSION_TABLE_NAME "SESSION"
+#define RESPONSE_CACHE_TABLE_NAME "RESPONSE_CACHE"
 
 namespace nsGlasslabSDK {
 
     class Core;
+
+    // A message stored in the queue, postdata holds the raw bytes when codec is set
+    typedef struct _glQueuedMessage {
+        int id;
+        string deviceId;
+        string path;
+        string requestType;
+        int coreCB;
+        string postdata;
+        string contentType;
+        string status;
+        string codec;
+    } glQueuedMessage;
+
+    // A cached GET response and the validators used to revalidate it
+    typedef struct _glCachedResponse {
+        string etag;
+        string lastModified;
+        string body;
+        time_t storedAt;
+    } glCachedResponse;
+
+    // A SESSION row, Core serves these from memory and DataSync writes them on its thread
+    typedef struct _glSession {
+        string cookie;
+        string gameSessionId;
+        int gameSessionEventOrder;
+        float totalTimePlayed;
+        // SessionField bits set in memory before the stored row was read, those win over it
+        int fields;
+    } glSession;
+    enum SessionField {
+        SessionField_Cookie = 1,
+        SessionField_GameSessionId = 2,
+        SessionField_EventOrder = 4
+    };
+
+    /**
+     * Storage backend for the message queue. Messages are read back in id order,
+     * DataSync applies the caps, compression and flushing on top.
+     */
+    class MessageStore {
+    public:
+        virtual ~MessageStore() {}
+
+        virtual bool open() = 0;
+        // Assigns message.id if it is 0, otherwise keeps the given id and gives a message
+        // already stored under it a new one
+        virtual bool append( glQueuedMessage& message ) = 0;
+        virtual bool remove( int id ) = 0;
+        virtual bool setStatus( int id, const string& status ) = 0;
+        // Reads up to limit messages with an id greater than afterId
+        virtual bool readAfter( int afterId, int limit, vector<glQueuedMessage>& messages ) = 0;
+        // Removes the oldest telemetry messages that are not pending to free rows and bytes,
+        // nothing is removed unless enough can be freed
+        virtual int evict( int rows, int64_t bytes, int64_t& evictedBytes ) = 0;
+        virtual void clear() = 0;
+
+        virtual int getCount() = 0;
+        virtual int64_t getBytes() = 0;
+    };
+
+    /**
+     * Message queue kept in the MSG_QUEUE table.
+     */
+    class SQLiteMessageStore : public MessageStore {
+    public:
+        SQLiteMessageStore( Core* core, CppSQLite3DB* db );
+
+        bool open();
+        bool append( glQueuedMessage& message );
+        bool remove( int id );
+        bool setStatus( int id, const string& status );
+        bool readAfter( int afterId, int limit, vector<glQueuedMessage>& messages );
+        int evict( int rows, int64_t bytes, int64_t& evictedBytes );
+        void clear();
+
+        int getCount();
+        int64_t getBytes();
+
+    private:
+        Core* m_core;
+        CppSQLite3DB* m_db;
+
+        // Read by getMessageTableSize() on other threads
+        std::atomic<int> m_count;
+        std::atomic<int64_t> m_bytes;
+    };
+
+    /**
+     * Message queue kept in append-only segment files. Each record is written once
+     * with a length and checksum, removals move a cursor and whole segments are
+     * deleted once the cursor passes them. Messages removed ahead of the cursor get
+     * a tombstone record instead. Statuses live in memory.
+     */
+    class LogMessageStore : public MessageStore {
+    public:
+        LogMessageStore( Core* core, const string& basePath );
+        ~LogMessageStore();
+
+        bool open();
+        bool append( glQueuedMessage& message );
+        bool remove( int id );
+        bool setStatus( int id, const string& status );
+        bool readAfter( int afterId, int limit, vector<glQueuedMessage>& messages );
+        int evict( int rows, int64_t bytes, int64_t& evictedBytes );
+        void clear();
+
+        int getCount();
+        int64_t getBytes();
+
+    private:
+        // Location of a record in the segment files
+        typedef struct _LogEntry {
+            uint32_t segment;
+            uint32_t offset;
+            int64_t bytes;
+            bool telemetry;
+            string status;
+        } LogEntry;
+
+        // Segment and cursor files
+        string segmentName( uint32_t segment );
+        bool segmentExists( uint32_t segment );
+        bool openWriteSegment( size_t recordSize );
+        bool readCursor();
+        bool writeCursor();
+        void advanceCursor();
+        bool writeRecord( const string& payload, uint32_t& segment, uint32_t& offset );
+        void indexEntry( const glQueuedMessage& message, uint32_t segment, uint32_t offset );
+        void eraseEntry( map<int, LogEntry>::iterator it );
+        void removeEntries( const vector<int>& ids );
+        bool renumber( int id );
+
+        // Record encoding
+        bool scanSegment( uint32_t segment, uint32_t offset, bool verify, uint32_t& validEnd );
+        static bool readRecord( FILE* file, bool verify, string& payload );
+        static uint32_t checksum( const string& data );
+        static void encode( const glQueuedMessage& message, string& payload );
+        static bool decode( const string& payload, glQueuedMessage& message );
+
+        Core* m_core;
+        string m_basePath;
+        pthread_mutex_t m_mutex;
+
+        // Unsent messages by id, and their ids by file position
+        map<int, LogEntry> m_entries;
+        map<uint64_t, int> m_positions;
+        int64_t m_bytes;
+        int m_nextId;
+
+        // First record that has not been removed, and the append position
+        uint32_t m_cursorSegment;
+        uint32_t m_cursorOffset;
+        uint32_t m_writeSegment;
+        uint32_t m_writeOffset;
+        FILE* m_writeFile;
+    };
     
     class DataSync {
     public:
         DataSync( Core* core, const char* dbPath = NULL );
         ~DataSync();
+
+        // Opens the database in the background when there is a writer thread
+        void open();
+        bool isStorageReady();
         
         // Message Queue (MSG_QUEUE) table operations
-        void addToMsgQ( string deviceId, string path, string requestType, string coreCB, string postdata, const char* contentType );
+        void addToMsgQ( string deviceId, string path, string requestType, int coreCB, string postdata, const char* contentType );
         void removeFromMsgQ( int rowId );
         void updateMessageStatus( int rowId, string status );
         int getMessageTableSize();
+        int getEvictedMessageCount();
+        int getEvictedMessageBytes();
+        int getDroppedMessageCount();
+        bool readMsgQ( int afterId, int limit, vector<glQueuedMessage>& messages );
+
+        // Switches the message queue storage backend (Const::QueueStore), moving queued messages over
+        void setMessageStore( int type );
+        int getMessageStore();
 
         // Session (SESSION) table operations
         void updateSessionTableWithCookie( string deviceId, string cookie );
         void updateSessionTableWithGameSessionId( string deviceId, string gameSessionId );
         void updateSessionTableWithPlayerHandle( string deviceIdWithHandle );
         void removeSessionWithDeviceId( string deviceId );
-        const char* getCookieFromDeviceId( string deviceId );
         void updatePlayerInfoFromDeviceId( string deviceId, float totalTimePlayed, int gameSessionEventOrder );
-        float getTotalTimePlayedFromDeviceId( string deviceId );
         void updateGameSessionEventOrderWithDeviceId( string deviceId, int gameSessionEventOrder );
-        int getGameSessionEventOrderFromDeviceId( string deviceId );
+        void getSessions( map<string, glSession>& sessions );
+
+        // Last good server config and the URI it came from, per bootstrap URI and gameId (CONFIG table)
+        void storeServerConfig( string bootstrapUri, string gameId, string uri, string config );
+        bool getServerConfig( string bootstrapUri, string gameId, string& uri, string& config );
+
+        // Response cache (RESPONSE_CACHE) table operations
+        bool getCachedResponse( string key, glCachedResponse& response );
+        void storeCachedResponse( string key, string etag, string lastModified, string body );
+        void touchCachedResponse( string key );
+        void clearResponseCache();
 
         // Function flushes MSG_QUEUE, converting all stored API events into HTTP requests on Core
         void doFlushMsgQ();
 #ifdef MULTITHREADED
-        bool queueFlushRequested = false;
+        std::atomic<bool> queueFlushRequested;
 #endif
         void flushMsgQ();
 
         // Function forces a database reset
         void resetDatabase();
 
+        // Function blocks until the storage writer thread has applied all queued writes
+        void flushWrites();
+
+        // In-memory database (dbPath DB_MEMORY_PATH) snapshots to a database file
+        void setSnapshot( const char* path, int intervalSecs );
+        bool snapshotDatabase();
+        void snapshotDatabaseIfDue();
+        bool isInMemory();
+
         
     private:
         // Initialization and validation
+        void initStorage();
         void initDB();
         void validateSDKVersion();
 
@@ -96,10 +285,85 @@ namespace nsGlasslabSDK {
         void createTables();
         void dropTables();
         void migrateTables();
-        void migrateTable( string table, string newSchema );
+        void migrateTable( string table, string columns );
+        int getSchemaVersion();
+        void setSchemaVersion( int version );
+
+        // Message queue backend setMessageStore() last switched to (CONFIG table)
+        void storeMessageStoreType( int type );
+        int getStoredMessageStoreType();
         // Debug display
         void displayTable( string table );
 
+        // Storage writer thread, writes made on other threads are queued and applied in order
+        enum WriteOp {
+            WriteOp_AddMessage = 0,
+            WriteOp_RemoveMessage,
+            WriteOp_MessageStatus,
+            WriteOp_SessionCookie,
+            WriteOp_SessionGameSessionId,
+            WriteOp_SessionPlayerHandle,
+            WriteOp_RemoveSession,
+            WriteOp_PlayerInfo,
+            WriteOp_EventOrder,
+            WriteOp_CacheResponse,
+            WriteOp_CacheTouch,
+            WriteOp_CacheClear,
+            WriteOp_ServerConfig,
+            WriteOp_MessageStore,
+            WriteOp_ResetDatabase,
+            WriteOp_SetSnapshot,
+            // Reads, the caller waits for these with waitForWrite()
+            WriteOp_ReadMessages,
+            WriteOp_ReadSessions,
+            WriteOp_ReadServerConfig,
+            WriteOp_ReadCache,
+            WriteOp_Snapshot
+        };
+        typedef struct _StorageWrite {
+            WriteOp op;
+            string deviceId;
+            string path;
+            string requestType;
+            int coreCB;
+            string postdata;
+            string contentType;
+            string value;
+            string lastModified;
+            string bootstrapUri;
+            string gameId;
+            int rowId;
+            float totalTimePlayed;
+            int gameSessionEventOrder;
+            int number;
+            // Read results, the waiting caller deletes the write once done is set
+            void* out;
+            bool result;
+            bool wait;
+            bool done;
+        } StorageWrite;
+        int startWriterThread();
+        void stopWriterThread();
+        bool deferWrites();
+        StorageWrite* newWrite( WriteOp op, string deviceId );
+        void queueWrite( StorageWrite* write );
+        void waitForWrite( StorageWrite* write );
+        void applyWrite( StorageWrite* write );
+        static void* proc_storageWriter( void* dataSync );
+
+        // Snapshot file of the in-memory database
+        bool restoreSnapshot();
+        void attachSnapshot();
+        void detachSnapshot();
+
+        // MSG_QUEUE overflow policy
+        bool makeRoomInMsgQ( int64_t incomingBytes );
+        bool evictFromMsgQ( int rows, int64_t bytes );
+
+        // MSG_QUEUE postdata compression
+        bool compressPostdata( const string& postdata, string& out );
+        bool decompressPostdata( const unsigned char* data, int size, string& out );
+
         // Helper function for creating a new SESSION entry
         string createNewSessionEntry( string deviceId, string cookie, string gameSessionId );
 
@@ -115,8 +379,33 @@ namespace nsGlasslabSDK {
         string m_sessionTableName;
         string m_hmqTableName;
 
-        // Event counts
-        int m_messageTableSize;
+        // In-memory database and its snapshot file
+        bool m_inMemory;
+        string m_snapshotPath;
+        int m_snapshotInterval;
+        time_t m_lastSnapshot;
+        pthread_mutex_t m_snapshotMutex;
+
+        // Storage writer thread and its queue
+        pthread_t m_writerThread;
+        std::atomic<bool> m_writerStarted;
+        bool m_writerStopping;
+        bool m_writerBusy;
+        std::atomic<bool> m_storageReady;
+        pthread_mutex_t m_writeQueueMutex;
+        pthread_cond_t m_writeQueueCondition;
+        pthread_cond_t m_writeIdleCondition;
+        std::queue<StorageWrite*> m_writeQueue;
+
+        // Message queue storage backend, swapped and read from other threads under m_storeMutex
+        MessageStore* m_store;
+        std::atomic<int> m_storeType;
+        pthread_mutex_t m_storeMutex;
+
+        // Rows removed to stay under the caps and new rows dropped, read from any thread
+        std::atomic<int> m_evictedMessages;
+        std::atomic<int64_t> m_evictedBytes;
+        std::atomic<int> m_droppedMessages;
     };
 };
 
@@ -0,0 +1,32 @@
+using UnityEngine;
+using UnityEditor;
+using UnityEditor.Callbacks;
+#if UNITY_IOS
+using UnityEditor.iOS.Xcode;
+#endif
+
+
+/**
+ * The iOS library is built with ZLIB_COMPRESSION, the Xcode project Unity
+ * generates has to link zlib for it. Place this script in an "Editor" folder.
+ */
+public class GlasslabSDKPostprocessBuild {
+
+	[PostProcessBuild]
+	public static void OnPostprocessBuild( BuildTarget target, string path ) {
+#if UNITY_IOS
+		if( target != BuildTarget.iOS ) {
+			return;
+		}
+
+		string projectPath = PBXProject.GetPBXProjectPath( path );
+		PBXProject project = new PBXProject();
+		project.ReadFromFile( projectPath );
+
+		string targetGuid = project.TargetGuidByName( PBXProject.GetUnityTargetName() );
+		project.AddBuildProperty( targetGuid, "OTHER_LDFLAGS", "-lz" );
+
+		project.WriteToFile( projectPath );
+#endif
+	}
+}
@@ -536,6 +536,32 @@ public class GlasslabSDK {
 	public void CancelRequest(string key) {
 		GlasslabSDK_CancelRequest( mInst, key );
 	}
+	public bool CancelRequestHandle(int handle) {
+		return GlasslabSDK_CancelRequestHandle( mInst, handle );
+	}
+	public int GetLastRequestHandle() {
+		return GlasslabSDK_GetLastRequestHandle( mInst );
+	}
+
+	/**
+	 * Estimated server minus device clock in milliseconds, from the Date header of server
+	 * responses. Add it to a device timestamp to get server time, 0 until the first response.
+	 */
+	public int GetClockSkew() {
+		return GlasslabSDK_GetClockSkew( mInst );
+	}
+	
+	/**
+	 * Config, user info, player info and courses responses are cached with their ETag/Last-Modified
+	 * validators. Within the TTL a request is served from the cache, after it the server is asked
+	 * whether the cached copy is still valid. A negative TTL disables the cache for that request key.
+	 */
+	public void SetResponseCacheTTL(string key, int seconds) {
+		GlasslabSDK_SetResponseCacheTTL( mInst, key, seconds );
+	}
+	public void ClearResponseCache() {
+		GlasslabSDK_ClearResponseCache( mInst );
+	}
 	
 	public void SaveGame( string gameData, ResponseCallback cb = null ) {
 		if (cb != null) {
@@ -644,6 +670,98 @@ public class GlasslabSDK {
 	public void SaveTelemEvent(string name) {
 		GlasslabSDK_SaveTelemEvent (mInst, name);
 	}
+
+	/**
+	 * Keys and event names can be registered once for an integer handle, so that
+	 * per-event calls only marshal integers.
+	 */
+	public int RegisterTelemKey(string key) {
+		return GlasslabSDK_RegisterTelemKey (mInst, key);
+	}
+	public int RegisterTelemEventName(string name) {
+		return GlasslabSDK_RegisterTelemEventName (mInst, name);
+	}
+	public void AddTelemEventValue(int key, string value) {
+		GlasslabSDK_AddTelemEventValueWithHandle_ccp   (mInst, key, value);
+	}
+	public void AddTelemEventValue(int key, sbyte  value) {
+		GlasslabSDK_AddTelemEventValueWithHandle_int8  (mInst, key, value);
+	}
+	public void AddTelemEventValue(int key, short  value) {
+		GlasslabSDK_AddTelemEventValueWithHandle_int16 (mInst, key, value);
+	}
+	public void AddTelemEventValue(int key, int    value) {
+		GlasslabSDK_AddTelemEventValueWithHandle_int32 (mInst, key, value);
+	}
+	public void AddTelemEventValue(int key, byte   value) {
+		GlasslabSDK_AddTelemEventValueWithHandle_uint8 (mInst, key, value);
+	}
+	public void AddTelemEventValue(int key, ushort value) {
+		GlasslabSDK_AddTelemEventValueWithHandle_uint16(mInst, key, value);
+	}
+	public void AddTelemEventValue(int key, uint   value) {
+		GlasslabSDK_AddTelemEventValueWithHandle_uint32(mInst, key, value);
+	}
+	public void AddTelemEventValue(int key, float  value) {
+		GlasslabSDK_AddTelemEventValueWithHandle_float (mInst, key, value);
+	}
+	public void AddTelemEventValue(int key, double value) {
+		GlasslabSDK_AddTelemEventValueWithHandle_double(mInst, key, value);
+	}
+	public void AddTelemEventValue(int key, bool value) {
+		GlasslabSDK_AddTelemEventValueWithHandle_bool(mInst, key, value);
+	}
+	public void SaveTelemEvent(int name) {
+		GlasslabSDK_SaveTelemEventWithHandle (mInst, name);
+	}
+
+	/**
+	 * Events can be saved with a priority, lower is more important. Events with a
+	 * priority above the server's eventsDetailLevel are dropped.
+	 */
+	public void SaveTelemEvent(string name, int priority) {
+		GlasslabSDK_SaveTelemEventWithPriority (mInst, name, priority);
+	}
+	public void SaveTelemEvent(int name, int priority) {
+		GlasslabSDK_SaveTelemEventWithHandleAndPriority (mInst, name, priority);
+	}
+	public bool IsTelemPriorityEnabled(int priority) {
+		return GlasslabSDK_IsTelemPriorityEnabled (mInst, priority);
+	}
+
+	/**
+	 * High-frequency signals can be aggregated locally. Each counter, gauge and
+	 * histogram is sent as one summary event per window instead of an event per sample.
+	 */
+	public void IncrementTelemCounter(string name, int delta = 1) {
+		GlasslabSDK_IncrementTelemCounter (mInst, name, delta);
+	}
+	public void SetTelemGauge(string name, double value) {
+		GlasslabSDK_SetTelemGauge (mInst, name, value);
+	}
+	public void DefineTelemHistogram(string name, double[] bounds) {
+		GlasslabSDK_DefineTelemHistogram (mInst, name, bounds, bounds.Length);
+	}
+	public void RecordTelemHistogram(string name, double value) {
+		GlasslabSDK_RecordTelemHistogram (mInst, name, value);
+	}
+	public void FlushTelemAggregates() {
+		GlasslabSDK_FlushTelemAggregates (mInst);
+	}
+
+	/**
+	 * Noisy events can be sampled or rate limited per name. The server config
+	 * overrides these, dropped events are counted in a Telemetry_sampled_out event.
+	 */
+	public void SetTelemEventSampleRate(string name, float sampleRate) {
+		GlasslabSDK_SetTelemEventSampleRate (mInst, name, sampleRate);
+	}
+	public void SetTelemEventRateLimit(string name, float ratePerSec, int burst) {
+		GlasslabSDK_SetTelemEventRateLimit (mInst, name, ratePerSec, burst);
+	}
+	public void FlushStorageWrites() {
+		GlasslabSDK_FlushStorageWrites( mInst );
+	}
 	public void SaveAchievement( string item, string group, string subGroup ) {
 		GlasslabSDK_SaveAchievement(mInst, item, group, subGroup);
 	}
@@ -684,6 +802,14 @@ public class GlasslabSDK {
 		GlasslabSDK_SetAutoSessionManagement( mInst, state );
 	}
 	
+	public void SetMessageStore(int type) {
+		GlasslabSDK_SetMessageStore( mInst, type );
+	}
+	
+	public void SetDatabaseSnapshot(string path, int intervalSecs) {
+		GlasslabSDK_SetDatabaseSnapshot( mInst, path, intervalSecs );
+	}
+	
 	// ----------------------------
 	/**
 	 * Public functions for getting variables and states in the SDK.
@@ -714,6 +840,42 @@ public class GlasslabSDK {
 		return userId;
 	}
 	
+	public int GetTelemBufferedBytes() {
+		return GlasslabSDK_GetTelemBufferedBytes( mInst );
+	}
+	
+	public int GetTelemBufferedEventCount() {
+		return GlasslabSDK_GetTelemBufferedEventCount( mInst );
+	}
+	
+	public int GetTelemDroppedEventCount() {
+		return GlasslabSDK_GetTelemDroppedEventCount( mInst );
+	}
+	
+	public int GetTelemFilteredEventCount() {
+		return GlasslabSDK_GetTelemFilteredEventCount( mInst );
+	}
+	
+	public int GetTelemSampledOutEventCount() {
+		return GlasslabSDK_GetTelemSampledOutEventCount( mInst );
+	}
+	
+	public int GetMessageQueueEvictedCount() {
+		return GlasslabSDK_GetMessageQueueEvictedCount( mInst );
+	}
+	
+	public int GetMessageQueueEvictedBytes() {
+		return GlasslabSDK_GetMessageQueueEvictedBytes( mInst );
+	}
+	
+	public int GetMessageQueueDroppedCount() {
+		return GlasslabSDK_GetMessageQueueDroppedCount( mInst );
+	}
+	
+	public int GetMessageStore() {
+		return GlasslabSDK_GetMessageStore( mInst );
+	}
+	
 	public string GetCookie( bool fullCookie = false ) {
 		// Get the entire cookie string
 		IntPtr cookiePtr = GlasslabSDK_GetCookie( mInst );
@@ -933,17 +1095,47 @@ public class GlasslabSDK {
 	#endif
 	
 	/**
-	 * Helper functions allows a request by key to be cancelled. This is useful for requests that
-	 * are mid-stream but have not yet returned to fire a callback. It ensures that the callback
-	 * will not be fired.
+	 * Helper functions allows a request by key or by handle to be cancelled. Requests still waiting
+	 * in the queue are dropped before anything is sent, and requests that are mid-stream will not
+	 * fire their callback. GetLastRequestHandle returns the handle of the last request started.
 	 */
 	#if UNITY_IPHONE
 	[DllImport ("__Internal")]
 	private static extern void GlasslabSDK_CancelRequest(System.IntPtr inst, string key);
+
+	[DllImport ("__Internal")]
+	private static extern bool GlasslabSDK_CancelRequestHandle(System.IntPtr inst, int handle);
+
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_GetLastRequestHandle(System.IntPtr inst);
+
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_GetClockSkew(System.IntPtr inst);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_SetResponseCacheTTL(System.IntPtr inst, string key, int seconds);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_ClearResponseCache(System.IntPtr inst);
 	#endif
 	#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
 	[DllImport ("GlassLabSDK")]
 	private static extern void GlasslabSDK_CancelRequest(System.IntPtr inst, string key);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern bool GlasslabSDK_CancelRequestHandle(System.IntPtr inst, int handle);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_GetLastRequestHandle(System.IntPtr inst);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_GetClockSkew(System.IntPtr inst);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_SetResponseCacheTTL(System.IntPtr inst, string key, int seconds);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_ClearResponseCache(System.IntPtr inst);
 	#endif
 	
 	/**
@@ -986,6 +1178,75 @@ public class GlasslabSDK {
 
 	[DllImport ("__Internal")]
 	private static extern void GlasslabSDK_SaveTelemEvent(System.IntPtr inst, string name);
+
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_RegisterTelemKey(System.IntPtr inst, string key);
+
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_RegisterTelemEventName(System.IntPtr inst, string name);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_ccp   (System.IntPtr inst, int key, string value);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_int8  (System.IntPtr inst, int key, sbyte value);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_int16 (System.IntPtr inst, int key, short value);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_int32 (System.IntPtr inst, int key, int value);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_uint8 (System.IntPtr inst, int key, byte value);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_uint16(System.IntPtr inst, int key, ushort value);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_uint32(System.IntPtr inst, int key, uint value);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_float (System.IntPtr inst, int key, float value);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_double(System.IntPtr inst, int key, double value);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_bool  (System.IntPtr inst, int key, bool value);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_SaveTelemEventWithHandle(System.IntPtr inst, int name);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_SaveTelemEventWithPriority(System.IntPtr inst, string name, int priority);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_SaveTelemEventWithHandleAndPriority(System.IntPtr inst, int name, int priority);
+
+	[DllImport ("__Internal")]
+	private static extern bool GlasslabSDK_IsTelemPriorityEnabled(System.IntPtr inst, int priority);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_IncrementTelemCounter(System.IntPtr inst, string name, int delta);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_SetTelemGauge(System.IntPtr inst, string name, double value);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_DefineTelemHistogram(System.IntPtr inst, string name, double[] bounds, int boundCount);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_RecordTelemHistogram(System.IntPtr inst, string name, double value);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_FlushTelemAggregates(System.IntPtr inst);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_SetTelemEventSampleRate(System.IntPtr inst, string name, float sampleRate);
+
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_SetTelemEventRateLimit(System.IntPtr inst, string name, float ratePerSec, int burst);
 	#endif
 	#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
 	[DllImport ("GlassLabSDK")]
@@ -1023,6 +1284,75 @@ public class GlasslabSDK {
 	
 	[DllImport ("GlassLabSDK")]
 	private static extern void GlasslabSDK_SaveTelemEvent(System.IntPtr inst, string name);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_RegisterTelemKey(System.IntPtr inst, string key);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_RegisterTelemEventName(System.IntPtr inst, string name);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_ccp   (System.IntPtr inst, int key, string value);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_int8  (System.IntPtr inst, int key, sbyte value);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_int16 (System.IntPtr inst, int key, short value);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_int32 (System.IntPtr inst, int key, int value);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_uint8 (System.IntPtr inst, int key, byte value);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_uint16(System.IntPtr inst, int key, ushort value);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_uint32(System.IntPtr inst, int key, uint value);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_float (System.IntPtr inst, int key, float value);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_double(System.IntPtr inst, int key, double value);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_AddTelemEventValueWithHandle_bool  (System.IntPtr inst, int key, bool value);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_SaveTelemEventWithHandle(System.IntPtr inst, int name);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_SaveTelemEventWithPriority(System.IntPtr inst, string name, int priority);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_SaveTelemEventWithHandleAndPriority(System.IntPtr inst, int name, int priority);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern bool GlasslabSDK_IsTelemPriorityEnabled(System.IntPtr inst, int priority);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_IncrementTelemCounter(System.IntPtr inst, string name, int delta);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_SetTelemGauge(System.IntPtr inst, string name, double value);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_DefineTelemHistogram(System.IntPtr inst, string name, double[] bounds, int boundCount);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_RecordTelemHistogram(System.IntPtr inst, string name, double value);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_FlushTelemAggregates(System.IntPtr inst);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_SetTelemEventSampleRate(System.IntPtr inst, string name, float sampleRate);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_SetTelemEventRateLimit(System.IntPtr inst, string name, float ratePerSec, int burst);
 	#endif
 	
 	/**
@@ -1032,6 +1362,9 @@ public class GlasslabSDK {
 	[DllImport ("__Internal")]
 	private static extern void GlasslabSDK_SendTelemEvents(System.IntPtr inst);
 
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_FlushStorageWrites(System.IntPtr inst);
+
 	[DllImport ("__Internal")]
 	private static extern void GlasslabSDK_SaveAchievement(System.IntPtr inst, string item, string group, string subGroup);
 	#endif
@@ -1039,6 +1372,9 @@ public class GlasslabSDK {
 	[DllImport ("GlassLabSDK")]
 	private static extern void GlasslabSDK_SendTelemEvents(System.IntPtr inst);
 	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_FlushStorageWrites(System.IntPtr inst);
+	
 	[DllImport ("GlassLabSDK")]
 	private static extern void GlasslabSDK_SaveAchievement(System.IntPtr inst, string item, string group, string subGroup);
 	#endif
@@ -1083,6 +1419,33 @@ public class GlasslabSDK {
 	[DllImport ("__Internal")]
 	private static extern int GlasslabSDK_GetUserId(System.IntPtr inst);
 
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_GetTelemBufferedBytes(System.IntPtr inst);
+
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_GetTelemBufferedEventCount(System.IntPtr inst);
+
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_GetTelemDroppedEventCount(System.IntPtr inst);
+
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_GetTelemFilteredEventCount(System.IntPtr inst);
+
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_GetTelemSampledOutEventCount(System.IntPtr inst);
+
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_GetMessageQueueEvictedCount(System.IntPtr inst);
+
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_GetMessageQueueEvictedBytes(System.IntPtr inst);
+
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_GetMessageQueueDroppedCount(System.IntPtr inst);
+
+	[DllImport ("__Internal")]
+	private static extern int GlasslabSDK_GetMessageStore(System.IntPtr inst);
+
 	[DllImport ("__Internal")]
 	private static extern IntPtr GlasslabSDK_GetCookie(System.IntPtr inst);
 	#endif
@@ -1093,6 +1456,33 @@ public class GlasslabSDK {
 	[DllImport ("GlassLabSDK")]
 	private static extern int GlasslabSDK_GetUserId(System.IntPtr inst);
 	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_GetTelemBufferedBytes(System.IntPtr inst);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_GetTelemBufferedEventCount(System.IntPtr inst);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_GetTelemDroppedEventCount(System.IntPtr inst);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_GetTelemFilteredEventCount(System.IntPtr inst);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_GetTelemSampledOutEventCount(System.IntPtr inst);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_GetMessageQueueEvictedCount(System.IntPtr inst);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_GetMessageQueueEvictedBytes(System.IntPtr inst);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_GetMessageQueueDroppedCount(System.IntPtr inst);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern int GlasslabSDK_GetMessageStore(System.IntPtr inst);
+	
 	[DllImport ("GlassLabSDK")]
 	private static extern IntPtr GlasslabSDK_GetCookie(System.IntPtr inst);
 	#endif
@@ -1130,6 +1520,12 @@ public class GlasslabSDK {
 	
 	[DllImport ("__Internal")]
 	private static extern void GlasslabSDK_SetAutoSessionManagement(System.IntPtr inst, bool state);
+	
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_SetMessageStore(System.IntPtr inst, int type);
+	
+	[DllImport ("__Internal")]
+	private static extern void GlasslabSDK_SetDatabaseSnapshot(System.IntPtr inst, string path, int intervalSecs);
 	#endif
 	#if UNITY_EDITOR_WIN || UNITY_STANDALONE_WIN
 	[DllImport ("GlassLabSDK")]
@@ -1158,5 +1554,11 @@ public class GlasslabSDK {
 	
 	[DllImport ("GlassLabSDK")]
 	private static extern void GlasslabSDK_SetAutoSessionManagement(System.IntPtr inst, bool state);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_SetMessageStore(System.IntPtr inst, int type);
+	
+	[DllImport ("GlassLabSDK")]
+	private static extern void GlasslabSDK_SetDatabaseSnapshot(System.IntPtr inst, string path, int intervalSecs);
 	#endif
 }
\ No newline at end of file
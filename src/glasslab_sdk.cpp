@@ -48,6 +48,11 @@ GlasslabSDK::GlasslabSDK( const char* clientId, const char* deviceId, const char
     m_core = new nsGlasslabSDK::Core( this, clientId, deviceId, dataPath, uri );
 }
 
+GlasslabSDK::~GlasslabSDK() {
+    delete m_core;
+    m_core = NULL;
+}
+
 
 nsGlasslabSDK::Const::Status GlasslabSDK::getLastStatus() {
     if( m_core != NULL ) return m_core->getLastStatus();
@@ -161,10 +166,49 @@ void GlasslabSDK::forceFlushTelemEvents() {
     if( m_core != NULL ) m_core->forceFlushTelemEvents();
 }
 
+void GlasslabSDK::flushStorageWrites() {
+    if( m_core != NULL ) m_core->flushStorageWrites();
+}
+
 void GlasslabSDK::cancelRequest( const char* key ) {
     if( m_core != NULL ) m_core->cancelRequest( key );
 }
 
+bool GlasslabSDK::cancelRequestHandle( int handle ) {
+    if( m_core != NULL ) {
+        return m_core->cancelRequestHandle( handle );
+    }
+    else {
+        return false;
+    }
+}
+
+int GlasslabSDK::getLastRequestHandle() {
+    if( m_core != NULL ) {
+        return m_core->getLastRequestHandle();
+    }
+    else {
+        return -1;
+    }
+}
+
+int GlasslabSDK::getClockSkew() {
+    if( m_core != NULL ) {
+        return m_core->getClockSkew();
+    }
+    else {
+        return 0;
+    }
+}
+
+void GlasslabSDK::setResponseCacheTTL( const char* key, int seconds ) {
+    if( m_core != NULL ) m_core->setResponseCacheTTL( key, seconds );
+}
+
+void GlasslabSDK::clearResponseCache() {
+    if( m_core != NULL ) m_core->clearResponseCache();
+}
+
 
 void GlasslabSDK::addTelemEventValue( const char* key, const char* value ) { if( m_core != NULL ) m_core->addTelemEventValue( key, value ); }
 void GlasslabSDK::addTelemEventValue( const char* key, int8_t value )      { if( m_core != NULL ) m_core->addTelemEventValue( key, value ); }
@@ -185,6 +229,84 @@ void GlasslabSDK::saveTelemEvent( const char* name ) {
     if( m_core != NULL ) m_core->saveTelemEvent( name );
 }
 
+int GlasslabSDK::registerTelemKey( const char* key ) {
+    if( m_core != NULL ) {
+        return m_core->registerTelemKey( key );
+    }
+    else {
+        return -1;
+    }
+}
+
+int GlasslabSDK::registerTelemEventName( const char* name ) {
+    if( m_core != NULL ) {
+        return m_core->registerTelemEventName( name );
+    }
+    else {
+        return -1;
+    }
+}
+
+void GlasslabSDK::addTelemEventValue( int keyHandle, const char* value ) { if( m_core != NULL ) m_core->addTelemEventValue( keyHandle, value ); }
+void GlasslabSDK::addTelemEventValue( int keyHandle, int8_t value )      { if( m_core != NULL ) m_core->addTelemEventValue( keyHandle, value ); }
+void GlasslabSDK::addTelemEventValue( int keyHandle, int16_t value )     { if( m_core != NULL ) m_core->addTelemEventValue( keyHandle, value ); }
+void GlasslabSDK::addTelemEventValue( int keyHandle, int32_t value )     { if( m_core != NULL ) m_core->addTelemEventValue( keyHandle, value ); }
+void GlasslabSDK::addTelemEventValue( int keyHandle, uint8_t value )     { if( m_core != NULL ) m_core->addTelemEventValue( keyHandle, value ); }
+void GlasslabSDK::addTelemEventValue( int keyHandle, uint16_t value )    { if( m_core != NULL ) m_core->addTelemEventValue( keyHandle, value ); }
+void GlasslabSDK::addTelemEventValue( int keyHandle, uint32_t value )    { if( m_core != NULL ) m_core->addTelemEventValue( keyHandle, value ); }
+void GlasslabSDK::addTelemEventValue( int keyHandle, float value )       { if( m_core != NULL ) m_core->addTelemEventValue( keyHandle, value ); }
+void GlasslabSDK::addTelemEventValue( int keyHandle, double value )      { if( m_core != NULL ) m_core->addTelemEventValue( keyHandle, value ); }
+void GlasslabSDK::addTelemEventValue( int keyHandle, bool value )        { if( m_core != NULL ) m_core->addTelemEventValue( keyHandle, value ); }
+
+void GlasslabSDK::saveTelemEvent( int nameHandle ) {
+    if( m_core != NULL ) m_core->saveTelemEvent( nameHandle );
+}
+
+void GlasslabSDK::saveTelemEvent( const char* name, int priority ) {
+    if( m_core != NULL ) m_core->saveTelemEvent( name, priority );
+}
+
+void GlasslabSDK::saveTelemEvent( int nameHandle, int priority ) {
+    if( m_core != NULL ) m_core->saveTelemEvent( nameHandle, priority );
+}
+
+bool GlasslabSDK::isTelemPriorityEnabled( int priority ) {
+    if( m_core != NULL ) {
+        return m_core->isTelemPriorityEnabled( priority );
+    }
+    else {
+        return false;
+    }
+}
+
+void GlasslabSDK::incrementTelemCounter( const char* name, int delta ) {
+    if( m_core != NULL ) m_core->incrementTelemCounter( name, delta );
+}
+
+void GlasslabSDK::setTelemGauge( const char* name, double value ) {
+    if( m_core != NULL ) m_core->setTelemGauge( name, value );
+}
+
+void GlasslabSDK::defineTelemHistogram( const char* name, const double* bounds, int boundCount ) {
+    if( m_core != NULL ) m_core->defineTelemHistogram( name, bounds, boundCount );
+}
+
+void GlasslabSDK::recordTelemHistogram( const char* name, double value ) {
+    if( m_core != NULL ) m_core->recordTelemHistogram( name, value );
+}
+
+void GlasslabSDK::flushTelemAggregates() {
+    if( m_core != NULL ) m_core->flushTelemAggregates();
+}
+
+void GlasslabSDK::setTelemEventSampleRate( const char* name, float sampleRate ) {
+    if( m_core != NULL ) m_core->setTelemEventSampleRate( name, sampleRate );
+}
+
+void GlasslabSDK::setTelemEventRateLimit( const char* name, float ratePerSec, int burst ) {
+    if( m_core != NULL ) m_core->setTelemEventRateLimit( name, ratePerSec, burst );
+}
+
 
 void GlasslabSDK::updatePlayerInfoKey( const char* key, const char* value ) { if( m_core != NULL ) m_core->updatePlayerInfoKey( key, value ); }
 void GlasslabSDK::updatePlayerInfoKey( const char* key, int8_t value )      { if( m_core != NULL ) m_core->updatePlayerInfoKey( key, value ); }
@@ -243,6 +365,14 @@ void GlasslabSDK::setAutoSessionManagement( bool state ) {
     if( m_core != NULL ) m_core->setAutoSessionManagement( state );
 }
 
+void GlasslabSDK::setMessageStore( int type ) {
+    if( m_core != NULL ) m_core->setMessageStore( type );
+}
+
+void GlasslabSDK::setDatabaseSnapshot( const char* path, int intervalSecs ) {
+    if( m_core != NULL ) m_core->setDatabaseSnapshot( path, intervalSecs );
+}
+
 
 void GlasslabSDK::startGameTimer() {
     if( m_core != NULL ) m_core->startGameTimer();
@@ -275,6 +405,87 @@ int GlasslabSDK::getUserId() {
     }
 }
 
+int GlasslabSDK::getTelemBufferedBytes() {
+    if( m_core != NULL ) {
+        return m_core->getTelemBufferedBytes();
+    }
+    else {
+        return 0;
+    }
+}
+
+int GlasslabSDK::getTelemBufferedEventCount() {
+    if( m_core != NULL ) {
+        return m_core->getTelemBufferedEventCount();
+    }
+    else {
+        return 0;
+    }
+}
+
+int GlasslabSDK::getTelemDroppedEventCount() {
+    if( m_core != NULL ) {
+        return m_core->getTelemDroppedEventCount();
+    }
+    else {
+        return 0;
+    }
+}
+
+int GlasslabSDK::getTelemFilteredEventCount() {
+    if( m_core != NULL ) {
+        return m_core->getTelemFilteredEventCount();
+    }
+    else {
+        return 0;
+    }
+}
+
+int GlasslabSDK::getTelemSampledOutEventCount() {
+    if( m_core != NULL ) {
+        return m_core->getTelemSampledOutEventCount();
+    }
+    else {
+        return 0;
+    }
+}
+
+int GlasslabSDK::getMessageQueueEvictedCount() {
+    if( m_core != NULL ) {
+        return m_core->getMessageQueueEvictedCount();
+    }
+    else {
+        return 0;
+    }
+}
+
+int GlasslabSDK::getMessageQueueEvictedBytes() {
+    if( m_core != NULL ) {
+        return m_core->getMessageQueueEvictedBytes();
+    }
+    else {
+        return 0;
+    }
+}
+
+int GlasslabSDK::getMessageQueueDroppedCount() {
+    if( m_core != NULL ) {
+        return m_core->getMessageQueueDroppedCount();
+    }
+    else {
+        return 0;
+    }
+}
+
+int GlasslabSDK::getMessageStore() {
+    if( m_core != NULL ) {
+        return m_core->getMessageStore();
+    }
+    else {
+        return 0;
+    }
+}
+
 const char* GlasslabSDK::getCookie() {
     if( m_core != NULL ) {
         return m_core->getCookie();
@@ -217,12 +217,51 @@ extern "C"
         }
     }
 
+    APIEXPORT void GlasslabSDK_FlushStorageWrites( void* inst ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->flushStorageWrites();
+        }
+    }
+
     APIEXPORT void GlasslabSDK_CancelRequest( void* inst, const char* key ) {
         if( inst != NULL ) {
             static_cast<GlasslabSDK *>( inst )->cancelRequest( key );
         }
     }
 
+    APIEXPORT bool GlasslabSDK_CancelRequestHandle( void* inst, int handle ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->cancelRequestHandle( handle );
+        }
+        return false;
+    }
+
+    APIEXPORT int GlasslabSDK_GetLastRequestHandle( void* inst ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->getLastRequestHandle();
+        }
+        return -1;
+    }
+
+    APIEXPORT int GlasslabSDK_GetClockSkew( void* inst ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->getClockSkew();
+        }
+        return 0;
+    }
+
+    APIEXPORT void GlasslabSDK_SetResponseCacheTTL( void* inst, const char* key, int seconds ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->setResponseCacheTTL( key, seconds );
+        }
+    }
+
+    APIEXPORT void GlasslabSDK_ClearResponseCache( void* inst ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->clearResponseCache();
+        }
+    }
+
     
     APIEXPORT void GlasslabSDK_AddTelemEventValue_ccp   ( void* inst, const char* key, const char* value )    { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->addTelemEventValue( key, value ); }
     APIEXPORT void GlasslabSDK_AddTelemEventValue_int8  ( void* inst, const char* key, int8_t value )         { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->addTelemEventValue( key, value ); }
@@ -247,6 +286,101 @@ extern "C"
         }
     }
 
+    APIEXPORT int GlasslabSDK_RegisterTelemKey( void* inst, const char* key ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->registerTelemKey( key );
+        } else {
+            return -1;
+        }
+    }
+
+    APIEXPORT int GlasslabSDK_RegisterTelemEventName( void* inst, const char* name ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->registerTelemEventName( name );
+        } else {
+            return -1;
+        }
+    }
+
+    APIEXPORT void GlasslabSDK_AddTelemEventValueWithHandle_ccp   ( void* inst, int keyHandle, const char* value )    { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->addTelemEventValue( keyHandle, value ); }
+    APIEXPORT void GlasslabSDK_AddTelemEventValueWithHandle_int8  ( void* inst, int keyHandle, int8_t value )         { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->addTelemEventValue( keyHandle, value ); }
+    APIEXPORT void GlasslabSDK_AddTelemEventValueWithHandle_int16 ( void* inst, int keyHandle, int16_t value )        { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->addTelemEventValue( keyHandle, value ); }
+    APIEXPORT void GlasslabSDK_AddTelemEventValueWithHandle_int32 ( void* inst, int keyHandle, int32_t value )        { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->addTelemEventValue( keyHandle, value ); }
+    APIEXPORT void GlasslabSDK_AddTelemEventValueWithHandle_uint8 ( void* inst, int keyHandle, uint8_t value )        { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->addTelemEventValue( keyHandle, value ); }
+    APIEXPORT void GlasslabSDK_AddTelemEventValueWithHandle_uint16( void* inst, int keyHandle, uint16_t value )       { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->addTelemEventValue( keyHandle, value ); }
+    APIEXPORT void GlasslabSDK_AddTelemEventValueWithHandle_uint32( void* inst, int keyHandle, uint32_t value )       { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->addTelemEventValue( keyHandle, value ); }
+    APIEXPORT void GlasslabSDK_AddTelemEventValueWithHandle_float ( void* inst, int keyHandle, float value )          { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->addTelemEventValue( keyHandle, value ); }
+    APIEXPORT void GlasslabSDK_AddTelemEventValueWithHandle_double( void* inst, int keyHandle, double value )         { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->addTelemEventValue( keyHandle, value ); }
+    APIEXPORT void GlasslabSDK_AddTelemEventValueWithHandle_bool  ( void* inst, int keyHandle, bool value )           { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->addTelemEventValue( keyHandle, value ); }
+
+    APIEXPORT void GlasslabSDK_SaveTelemEventWithHandle( void* inst, int nameHandle ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->saveTelemEvent( nameHandle );
+        }
+    }
+
+    APIEXPORT void GlasslabSDK_SaveTelemEventWithPriority( void* inst, const char* name, int priority ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->saveTelemEvent( name, priority );
+        }
+    }
+
+    APIEXPORT void GlasslabSDK_SaveTelemEventWithHandleAndPriority( void* inst, int nameHandle, int priority ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->saveTelemEvent( nameHandle, priority );
+        }
+    }
+
+    APIEXPORT bool GlasslabSDK_IsTelemPriorityEnabled( void* inst, int priority ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->isTelemPriorityEnabled( priority );
+        } else {
+            return false;
+        }
+    }
+
+    APIEXPORT void GlasslabSDK_IncrementTelemCounter( void* inst, const char* name, int delta ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->incrementTelemCounter( name, delta );
+        }
+    }
+
+    APIEXPORT void GlasslabSDK_SetTelemGauge( void* inst, const char* name, double value ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->setTelemGauge( name, value );
+        }
+    }
+
+    APIEXPORT void GlasslabSDK_DefineTelemHistogram( void* inst, const char* name, const double* bounds, int boundCount ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->defineTelemHistogram( name, bounds, boundCount );
+        }
+    }
+
+    APIEXPORT void GlasslabSDK_RecordTelemHistogram( void* inst, const char* name, double value ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->recordTelemHistogram( name, value );
+        }
+    }
+
+    APIEXPORT void GlasslabSDK_FlushTelemAggregates( void* inst ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->flushTelemAggregates();
+        }
+    }
+
+    APIEXPORT void GlasslabSDK_SetTelemEventSampleRate( void* inst, const char* name, float sampleRate ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->setTelemEventSampleRate( name, sampleRate );
+        }
+    }
+
+    APIEXPORT void GlasslabSDK_SetTelemEventRateLimit( void* inst, const char* name, float ratePerSec, int burst ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->setTelemEventRateLimit( name, ratePerSec, burst );
+        }
+    }
+
 
     APIEXPORT void GlasslabSDK_UpdatePlayerInfoKey_ccp   ( void* inst, const char* key, const char* value )    { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->updatePlayerInfoKey( key, value ); }
     APIEXPORT void GlasslabSDK_UpdatePlayerInfoKey_int8  ( void* inst, const char* key, int8_t value )         { if( inst != NULL ) static_cast<GlasslabSDK *>( inst )->updatePlayerInfoKey( key, value ); }
@@ -315,6 +449,18 @@ extern "C"
         }
     }
 
+    APIEXPORT void GlasslabSDK_SetMessageStore( void* inst, int type ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->setMessageStore( type );
+        }
+    }
+
+    APIEXPORT void GlasslabSDK_SetDatabaseSnapshot( void* inst, const char* path, int intervalSecs ) {
+        if( inst != NULL ) {
+            static_cast<GlasslabSDK *>( inst )->setDatabaseSnapshot( path, intervalSecs );
+        }
+    }
+
 
     APIEXPORT void GlasslabSDK_StartGameTimer( void* inst ) {
         if( inst != NULL ) {
@@ -352,6 +498,78 @@ extern "C"
             return -1;
         }
     }
+
+    APIEXPORT int GlasslabSDK_GetTelemBufferedBytes( void* inst ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->getTelemBufferedBytes();
+        } else {
+            return 0;
+        }
+    }
+
+    APIEXPORT int GlasslabSDK_GetTelemBufferedEventCount( void* inst ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->getTelemBufferedEventCount();
+        } else {
+            return 0;
+        }
+    }
+
+    APIEXPORT int GlasslabSDK_GetTelemDroppedEventCount( void* inst ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->getTelemDroppedEventCount();
+        } else {
+            return 0;
+        }
+    }
+
+    APIEXPORT int GlasslabSDK_GetTelemFilteredEventCount( void* inst ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->getTelemFilteredEventCount();
+        } else {
+            return 0;
+        }
+    }
+
+    APIEXPORT int GlasslabSDK_GetTelemSampledOutEventCount( void* inst ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->getTelemSampledOutEventCount();
+        } else {
+            return 0;
+        }
+    }
+
+    APIEXPORT int GlasslabSDK_GetMessageQueueEvictedCount( void* inst ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->getMessageQueueEvictedCount();
+        } else {
+            return 0;
+        }
+    }
+
+    APIEXPORT int GlasslabSDK_GetMessageQueueEvictedBytes( void* inst ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->getMessageQueueEvictedBytes();
+        } else {
+            return 0;
+        }
+    }
+
+    APIEXPORT int GlasslabSDK_GetMessageQueueDroppedCount( void* inst ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->getMessageQueueDroppedCount();
+        } else {
+            return 0;
+        }
+    }
+
+    APIEXPORT int GlasslabSDK_GetMessageStore( void* inst ) {
+        if( inst != NULL ) {
+            return static_cast<GlasslabSDK *>( inst )->getMessageStore();
+        } else {
+            return 0;
+        }
+    }
     
 
     APIEXPORT  const char* GlasslabSDK_GetCookie( void* inst ) {
@@ -48,15 +48,72 @@ either expressed or implied, of the FreeBSD Project.
 #include <pthread.h>
 #endif
 
+#include <algorithm>
+#include <chrono>
+
 
 namespace nsGlasslabSDK {
 
+    /**
+     * SystemClock reads std::chrono, steady_clock for durations and system_clock for timestamps.
+     */
+    int64_t SystemClock::monotonicMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+    int64_t SystemClock::wallMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
     /**
      * Core constructor to setup the SDK and perform an initial connection to the server.
      */
     Core::Core( GlasslabSDK* sdk, const char* gameId, const char* deviceId, const char* dataPath, const char* uri ) {
         logMessage( "Initializing the SDK" );
 
+        // Telemetry capture state is set up first, the destructor relies on it
+        m_clock = &m_systemClock;
+        m_clockSkewMs = 0;
+        m_clockSkewKnown = false;
+        threadStarted = false;
+        m_httpThreadStopping = false;
+        m_telemOwnerThread = pthread_self();
+        pthread_key_create( &m_telemProducerKey, &Core::mf_retireTelemProducer );
+        pthread_mutex_init( &m_telemContextMutex, NULL );
+        pthread_mutex_init( &m_sessionMutex, NULL );
+        pthread_mutex_init( &m_configMutex, NULL );
+        m_sessionsLoaded = false;
+        m_timePlayedRestored = false;
+        m_restoredTimePlayed = 0;
+        m_connectUriSet = false;
+        m_configSet = false;
+        m_connectPending = false;
+        m_telemProducers = NULL;
+        m_telemPublished = NULL;
+        m_telemTimePlayed = -1;
+        pthread_key_create( &m_requestWriterKey, &Core::mf_releaseRequestWriter );
+        pthread_key_create( &m_requestGroupKey, NULL );
+        pthread_mutex_init( &m_telemAggregateMutex, NULL );
+        pthread_mutex_init( &m_telemLimitMutex, NULL );
+        m_telemLimitCount = 0;
+        m_telemSampledOutEvents = 0;
+        m_telemSampleState = (uint64_t)getClock()->monotonicMicros() ^ (uint64_t)(uintptr_t)this;
+        if( m_telemSampleState == 0 ) {
+            m_telemSampleState = 1;
+        }
+        m_telemAggregateLast = getClock()->monotonicMicros();
+        m_telemAggregateFlushPending = false;
+        m_telemBufferBytes = 0;
+        m_telemBufferEvents = 0;
+        m_telemPublishedBytes = 0;
+        m_telemPublishedEvents = 0;
+        m_telemDroppedEvents = 0;
+        m_telemFilteredEvents = 0;
+        m_telemSpillRequested = false;
+
         // set device ID only if not null and contains a string of length 0
         if( ( deviceId != NULL ) && strlen( deviceId ) > 0 ) {
            m_deviceId = deviceId;
@@ -73,6 +130,8 @@ namespace nsGlasslabSDK {
 
         // Set the default information
         m_connectUri    = "http://127.0.0.1:8000";
+        m_bootstrapUri  = m_connectUri;
+        m_serverConfigApplied = false;
         m_gameSecret    = "";
         m_clientName    = "";
         m_clientVersion = "";
@@ -85,15 +144,22 @@ namespace nsGlasslabSDK {
         m_userInfo      = NULL;
         m_playerInfo    = json_object();
         m_autoSessionManagement = true;
+
+        // Only these GETs are served from the response cache by default. The server config is
+        // not, the copy stored with the connection already covers it
+        for( int i = 0; i < Const::Callback_Count; i++ ) {
+            m_responseCacheTTL[ i ] = -1;
+        }
+        m_responseCacheTTL[ Const::Callback_GetUserInfo ]   = RESPONSE_CACHE_TTL_USER_INFO;
+        m_responseCacheTTL[ Const::Callback_GetPlayerInfo ] = RESPONSE_CACHE_TTL_PLAYER_INFO;
+        m_responseCacheTTL[ Const::Callback_GetCourses ]    = RESPONSE_CACHE_TTL_COURSES;
         
-        // Set JSON telemetry objects
-        m_telemEvents       = json_array();
-        m_telemEventValues  = json_object();
+        // Reserve the telemetry capture arena
+        m_telemBuffer.setSymbols( &m_telemSymbols );
+        m_telemBuffer.reserve( TELEM_ARENA_SIZE_DEFAULT, TELEM_MAX_VALUES_DEFAULT, TELEM_MAX_EVENTS_DEFAULT );
         // Clear telemetry
         clearTelemEventValues();
 
-        // Store core function callbacks in the hash
-        mf_setupCallbacks();
         if(dataPath) {
             // Create the SQLite data sync object
             //printf( "Data path set: %s\n", dataPath );
@@ -101,14 +167,17 @@ namespace nsGlasslabSDK {
         }
         m_dataSync = new DataSync( this, dataPath );
 
-        // Reset the player info
-        resetPlayerInfo();
-
         // Set default throttle variables
         config.eventsDetailLevel = THROTTLE_PRIORITY_DEFAULT;
         config.eventsPeriodSecs = THROTTLE_INTERVAL_DEFAULT;
         config.eventsMinSize = THROTTLE_MIN_SIZE_DEFAULT;
         config.eventsMaxSize = THROTTLE_MAX_SIZE_DEFAULT;
+        config.eventsMaxBufferBytes = TELEM_MAX_BUFFER_BYTES_DEFAULT;
+        config.eventsBatchFormat = Const::TelemFormat_Legacy;
+        config.eventsAggregatePeriodSecs = TELEM_AGGREGATE_PERIOD_DEFAULT;
+        config.eventsQueuePolicy = Const::QueuePolicy_DropOldestTelemetry;
+        config.eventsQueueMaxBytes = DB_MESSAGE_BYTE_CAP;
+        config.eventsSendCompressed = 0;
 
         // Set default user info variables
         userInfo.username = "";
@@ -117,9 +186,9 @@ namespace nsGlasslabSDK {
         userInfo.email = "";
 
         // Set the last time since telemetry was fired
-        m_telemetryLastTime = time( NULL );
-        // Get the game session event order to update
-        m_gameSessionEventOrder = m_dataSync->getGameSessionEventOrderFromDeviceId( m_deviceId );
+        m_telemetryLastTime = getClock()->monotonicMicros();
+        // The stored game session event order is read once storage is ready
+        m_gameSessionEventOrder = 1;
         m_playSessionEventOrder = 1;
 
         // Stop the timers, initially
@@ -127,20 +196,160 @@ namespace nsGlasslabSDK {
         stopSessionTimer();
 
 
-        // Set the initial player handle and cookie
+        // Connect once storage is ready, starting from the stored config if there is one
+        for( int i = 0; i < Startup_Count; i++ ) {
+            m_startupIssued[ i ] = false;
+            m_startupDone[ i ] = false;
+        }
+        m_connected = false;
+        m_startGameId = gameId != NULL ? gameId : "";
+        m_startUri = uri != NULL ? uri : "";
+        m_connectPending = mf_setConnectTarget( gameId, uri ) == 0;
+
+        // Open the database, in the background with MULTITHREADED, mf_storageReady() picks up from there
+        m_dataSync->open();
+
+        // Set the initial player handle and cookie, the stored session is merged in once it is read
         setPlayerHandle( "" );
         setCookie( "" );
+    }
 
+    /**
+     * Function is called by DataSync once the database is open and migrated, on the storage
+     * writer thread with MULTITHREADED. It reads the stored session state and server config,
+     * publishes them under m_sessionMutex and makes the connect request recorded by the
+     * constructor. Values the game set in the meantime win over the stored ones.
+     */
+    void Core::mf_storageReady() {
+        map<string, glSession> sessions;
+        m_dataSync->getSessions( sessions );
+        mf_restoreSessions( sessions );
+
+        // Attempt a connection now that the SDK is created, starting from the stored config if there is one
+        mf_loadServerConfig( m_startUri, m_startGameId );
+        if( m_connectPending.exchange( false ) ) {
+            mf_requestConnect();
+        }
+    }
 
-        // Attempt a connection now that the SDK is created
-        m_connected = false;
-        connect( gameId, uri );
+    /**
+     * Function merges the sessions read from the SESSION table into the ones kept in
+     * memory. Fields the game set win, the time played and events counted since the
+     * SDK was created are added to the stored totals.
+     */
+    void Core::mf_restoreSessions( const map<string, glSession>& sessions ) {
+        pthread_mutex_lock( &m_sessionMutex );
+        for( map<string, glSession>::const_iterator it = sessions.begin(); it != sessions.end(); ++it ) {
+            const glSession& stored = it->second;
+            map<string, glSession>::iterator current = m_sessions.find( it->first );
+            if( current == m_sessions.end() ) {
+                m_sessions.insert( *it );
+                continue;
+            }
+
+            glSession& session = current->second;
+            if( !( session.fields & SessionField_Cookie ) ) {
+                session.cookie = stored.cookie;
+            }
+            if( !( session.fields & SessionField_GameSessionId ) ) {
+                session.gameSessionId = stored.gameSessionId;
+            }
+            if( !( session.fields & SessionField_EventOrder ) ) {
+                session.gameSessionEventOrder += stored.gameSessionEventOrder - 1;
+            }
+            session.totalTimePlayed += stored.totalTimePlayed;
+
+            // The current device's counters are live, publish the stored part to them
+            if( it->first == m_deviceId ) {
+                if( !( session.fields & SessionField_Cookie ) ) {
+                    m_cookie = session.cookie;
+                }
+                if( !( session.fields & SessionField_EventOrder ) ) {
+                    m_gameSessionEventOrder += stored.gameSessionEventOrder - 1;
+                }
+                m_restoredTimePlayed = stored.totalTimePlayed;
+                m_timePlayedRestored = true;
+            }
+        }
+        for( map<string, glSession>::iterator it = m_sessions.begin(); it != m_sessions.end(); ++it ) {
+            it->second.fields = 0;
+        }
+        m_sessionsLoaded = true;
+        pthread_mutex_unlock( &m_sessionMutex );
+    }
+
+    /**
+     * Function adds the total time played restored by mf_restoreSessions() to the player
+     * info, on the thread that created the SDK.
+     */
+    void Core::mf_applyRestoredTimePlayed() {
+        if( !m_timePlayedRestored || !pthread_equal( pthread_self(), m_telemOwnerThread ) ) {
+            return;
+        }
+
+        pthread_mutex_lock( &m_sessionMutex );
+        float restored = m_timePlayedRestored ? m_restoredTimePlayed : 0;
+        m_timePlayedRestored = false;
+        m_restoredTimePlayed = 0;
+        pthread_mutex_unlock( &m_sessionMutex );
+
+        json_t* totalTimePlayed = json_object_get( m_playerInfo, "$totalTimePlayed$" );
+        float current = totalTimePlayed && json_is_real( totalTimePlayed ) ? (float)json_real_value( totalTimePlayed ) : 0;
+        updatePlayerInfoKey( "$totalTimePlayed$", current + restored );
     }
 
     /**
      * Core deconstructor.
+     *
+     * Stops the request thread first, since it uses the DataSync, then lets the DataSync
+     * apply the queued storage writes and close the database.
      */
     Core::~Core() {
+        mf_stopAsyncHTTPRequestThread();
+        delete m_dataSync;
+        m_dataSync = NULL;
+
+        // Jobs queued after the thread stopped are not sent
+        while( m_httpGetJobs.size() > 0 ) {
+            delete m_httpGetJobs.front();
+            m_httpGetJobs.pop_front();
+        }
+
+        // No producer thread may capture telemetry past this point
+        pthread_key_delete( m_telemProducerKey );
+
+        // The key destructor does not run for the calling thread
+        delete (RequestWriter*)pthread_getspecific( m_requestWriterKey );
+        pthread_key_delete( m_requestWriterKey );
+        pthread_key_delete( m_requestGroupKey );
+        pthread_mutex_destroy( &m_telemAggregateMutex );
+        pthread_mutex_destroy( &m_telemLimitMutex );
+        pthread_mutex_destroy( &m_telemContextMutex );
+        pthread_mutex_destroy( &m_sessionMutex );
+        pthread_mutex_destroy( &m_configMutex );
+
+        TelemetryBatch* batch = m_telemPublished.exchange( NULL );
+        while( batch != NULL ) {
+            TelemetryBatch* next = batch->next;
+            delete batch;
+            batch = next;
+        }
+
+        TelemetryProducer* producer = m_telemProducers.exchange( NULL );
+        while( producer != NULL ) {
+            TelemetryProducer* next = producer->next;
+            delete producer->current;
+            for( int list = 0; list < 2; list++ ) {
+                batch = ( list == 0 ) ? producer->freeList : producer->returned.exchange( NULL );
+                while( batch != NULL ) {
+                    TelemetryBatch* nextBatch = batch->next;
+                    delete batch;
+                    batch = nextBatch;
+                }
+            }
+            delete producer;
+            producer = next;
+        }
     }
 
 
@@ -219,50 +428,197 @@ namespace nsGlasslabSDK {
         sdkInfo.core->logMessage( "getConnect_Done", uri );
         sdkInfo.core->logMessage( "---------------------------" );
 
-        // Call getConfig next
-        if( sdkInfo.success ) {
-            sdkInfo.core->getConfig( uri );
+        // Record the server URI
+        if( sdkInfo.success && strcmp( uri, "" ) != 0 ) {
+            sdkInfo.core->setConnectUri( uri );
+            sdkInfo.core->logMessage( "connectUri set from CONFIG:", uri );
         }
         else {
-            sdkInfo.core->getConfig( "" );
+            sdkInfo.core->displayError( "getConnect_Done", "Valid URI was not specified when trying to retrieve config." );
+        }
+
+        // The requests waiting on the URI (config, play session, auth status) go out together
+        sdkInfo.core->mf_completeStartupStep( Startup_Connect );
+    }
+
+    /**
+     * The startup handshake as a dependency graph, the step each step waits for (-1 for none).
+     * Steps that become ready together are queued as one group and sent concurrently.
+     */
+    static const int s_startupDependencies[ Startup_Count ] = {
+        -1,                     // Startup_Connect
+        Startup_Connect,        // Startup_Config
+        Startup_Connect,        // Startup_PlaySession
+        Startup_Connect         // Startup_AuthStatus, validates a cookie set before the URI is known
+    };
+
+    /**
+     * Function resets the startup handshake, connect() is its first step.
+     */
+    void Core::mf_startStartup() {
+        pthread_mutex_lock( &m_startupMutex );
+        for( int i = 0; i < Startup_Count; i++ ) {
+            m_startupIssued[ i ] = false;
+            m_startupDone[ i ] = false;
+        }
+        m_startupIssued[ Startup_Connect ] = true;
+        pthread_mutex_unlock( &m_startupMutex );
+    }
+
+    /**
+     * Function marks a startup step as completed and issues the steps that were waiting on it.
+     * Steps that are not part of a running startup are ignored.
+     */
+    void Core::mf_completeStartupStep( int step ) {
+        std::vector<int> ready;
+
+        pthread_mutex_lock( &m_startupMutex );
+        if( step >= 0 && step < Startup_Count && m_startupIssued[ step ] && !m_startupDone[ step ] ) {
+            m_startupDone[ step ] = true;
+            for( int i = 0; i < Startup_Count; i++ ) {
+                int dependency = s_startupDependencies[ i ];
+                if( !m_startupIssued[ i ] && dependency >= 0 && m_startupDone[ dependency ] ) {
+                    m_startupIssued[ i ] = true;
+                    ready.push_back( i );
+                }
+            }
+        }
+        pthread_mutex_unlock( &m_startupMutex );
+
+        if( ready.size() > 0 ) {
+            mf_beginRequestGroup();
+            for( size_t i = 0; i < ready.size(); i++ ) {
+                mf_issueStartupStep( ready[ i ] );
+            }
+            mf_endRequestGroup();
+        }
+    }
+
+    /**
+     * Function returns true if the startup step was issued and has not completed yet.
+     */
+    bool Core::mf_isStartupStepPending( int step ) {
+        pthread_mutex_lock( &m_startupMutex );
+        bool pending = m_startupIssued[ step ] && !m_startupDone[ step ];
+        pthread_mutex_unlock( &m_startupMutex );
+        return pending;
+    }
+
+    /**
+     * Function makes the request for a startup step. Steps with nothing to do complete immediately.
+     */
+    void Core::mf_issueStartupStep( int step ) {
+        bool hasCookie;
+        switch( step ) {
+            case Startup_Config:
+                mf_requestConfig();
+                break;
+            case Startup_PlaySession:
+                if( strcmp( getPlaySessionId(), "" ) == 0 ) {
+                    startPlaySession();
+                }
+                else {
+                    mf_completeStartupStep( step );
+                }
+                break;
+            case Startup_AuthStatus:
+                pthread_mutex_lock( &m_sessionMutex );
+                hasCookie = m_cookie.length() > 0;
+                pthread_mutex_unlock( &m_sessionMutex );
+                if( hasCookie ) {
+                    authStatus();
+                }
+                else {
+                    mf_completeStartupStep( step );
+                }
+                break;
         }
     }
 
+    /**
+     * Functions mark the requests queued by this thread in between as one group.
+     */
+    void Core::mf_beginRequestGroup() {
+        pthread_mutex_lock( &m_requestMutex );
+        int group = m_nextRequestGroup++;
+        pthread_mutex_unlock( &m_requestMutex );
+        pthread_setspecific( m_requestGroupKey, (void*)(intptr_t)group );
+    }
+    void Core::mf_endRequestGroup() {
+        pthread_setspecific( m_requestGroupKey, NULL );
+    }
+
     /**
      * Function is triggered when the user first connects to the server. Called
      * automatically when the SDK object is created. Continues only if the gameId
      * and URI are valid strings.
      */
     int Core::connect( const char* gameId, const char* uri ) {
-        // If the URI was set properly, record it
+        if( mf_setConnectTarget( gameId, uri ) != 0 ) {
+            return 1;
+        }
+
+        // The constructor's request is no longer needed
+        m_connectPending = false;
+        mf_requestConnect();
+
+        // Success
+        return 0;
+    }
+
+    /**
+     * Function records the gameId and URI connect() uses. Returns 1 if either is invalid.
+     */
+    int Core::mf_setConnectTarget( const char* gameId, const char* uri ) {
+        pthread_mutex_lock( &m_sessionMutex );
+
+        // If the URI was set properly, record it. The connect request always goes to this URI,
+        // a stored server URI stays in use until getConnect_Done resolves a new one
         if( ( uri != NULL ) && strcmp( uri, "" ) != 0 ) {
-            m_connectUri = uri;
-            logMessage( "connectUri set:", m_connectUri.c_str() );
+            // A stored config belongs to the server and game it was retrieved for
+            if( m_serverConfigApplied && ( m_bootstrapUri != uri || gameId == NULL || m_gameId != gameId ) ) {
+                m_serverConfigApplied = false;
+                setConnectedState( false );
+            }
+            m_bootstrapUri = uri;
+            if( !m_serverConfigApplied ) {
+                m_connectUri = uri;
+            }
+            logMessage( "connectUri set:", uri );
         }
         // URI was not set properly
         else {
+            pthread_mutex_unlock( &m_sessionMutex );
             displayError( "Core::connect()", "Valid URI was not specified when trying to connect." );
             return 1;
         }
         
         // If the gameId was set properly, record it
         if( ( gameId != NULL ) && strcmp( gameId, "" ) != 0 ) {
+            pthread_mutex_lock( &m_telemContextMutex );
             m_gameId = gameId;
-            logMessage( "gameId set:", m_gameId.c_str() );
+            pthread_mutex_unlock( &m_telemContextMutex );
+            logMessage( "gameId set:", gameId );
         }
         // gameId was not set properly
         else {
+            pthread_mutex_unlock( &m_sessionMutex );
             displayError( "Core::connect()", "The gameId was not set or is invalid." );
             return 1;
         }
-        
-        // Make the request
-        do_httpGetRequest( API_CONNECT, "GET", "getConnect_Done", "", "text/plain; charset=utf-8" );
-        
-        // Success
+
+        pthread_mutex_unlock( &m_sessionMutex );
         return 0;
     }
 
+    /**
+     * Function makes the connect request, the rest of the startup handshake follows from getConnect_Done.
+     */
+    void Core::mf_requestConnect() {
+        mf_startStartup();
+        do_httpGetRequest( API_CONNECT, "GET", Const::Callback_GetConnect, "", "text/plain; charset=utf-8" );
+    }
+
 
     //--------------------------------------
     //--------------------------------------
@@ -294,30 +650,24 @@ namespace nsGlasslabSDK {
             // First, check for errors
             if( sdkInfo.core->mf_checkForJSONErrors( root ) ) {
                 returnMessage = Const::Message_ConnectFail;
+
+                // The server rejected us, the stored config no longer applies. A transport
+                // failure reported by the SDK says nothing about it, so keep using it then.
+                if( sdkInfo.success ) {
+                    sdkInfo.core->setConnectedState( false );
+                    sdkInfo.core->mf_storeServerConfig( "" );
+                }
+                else if( !sdkInfo.core->mf_hasServerConfig() ) {
+                    sdkInfo.core->setConnectedState( false );
+                }
             }
             else {
                 // Set the connected state
                 sdkInfo.core->setConnectedState( true );
 
-                json_t* eventsDetailLevel = json_object_get( root, "eventsDetailLevel" );
-                if( eventsDetailLevel && json_is_integer( eventsDetailLevel ) ) {
-                    sdkInfo.core->config.eventsDetailLevel = (int)json_integer_value( eventsDetailLevel );
-                }
-                
-                json_t* eventsPeriodSecs = json_object_get( root, "eventsPeriodSecs" );
-                if( eventsPeriodSecs && json_is_integer( eventsPeriodSecs ) ) {
-                    sdkInfo.core->config.eventsPeriodSecs = (int)json_integer_value( eventsPeriodSecs );
-                }
-                
-                json_t* eventsMinSize = json_object_get( root, "eventsMinSize" );
-                if( eventsMinSize && json_is_integer( eventsMinSize ) ) {
-                    sdkInfo.core->config.eventsMinSize = (int)json_integer_value( eventsMinSize );
-                }
-                
-                json_t* eventsMaxSize = json_object_get( root, "eventsMaxSize" );
-                if( eventsMaxSize && json_is_integer( eventsMaxSize ) ) {
-                    sdkInfo.core->config.eventsMaxSize = (int)json_integer_value( eventsMaxSize );
-                }
+                // Apply the settings and keep them for the next start
+                sdkInfo.core->mf_applyServerConfig( root );
+                sdkInfo.core->mf_storeServerConfig( json );
             }
         }
         json_decref( root );
@@ -331,10 +681,12 @@ namespace nsGlasslabSDK {
         // Push Connect message
         sdkInfo.core->pushMessageStack( returnMessage, json );
 
-        // If this request was successful, start the play session
-        if( sdkInfo.success && strcmp( sdkInfo.core->getPlaySessionId(), "" ) == 0 ) {
+        // If this request was successful, start the play session, unless the startup handshake already did
+        if( sdkInfo.success && strcmp( sdkInfo.core->getPlaySessionId(), "" ) == 0 && !sdkInfo.core->mf_isStartupStepPending( Startup_PlaySession ) ) {
             sdkInfo.core->startPlaySession();
         }
+
+        sdkInfo.core->mf_completeStartupStep( Startup_Config );
     }
 
     /**
@@ -343,19 +695,166 @@ namespace nsGlasslabSDK {
     void Core::getConfig( const char* uri ) {
         // If the URI was set properly, record it
         if( ( uri != NULL ) && strcmp( uri, "" ) != 0 ) {
+            pthread_mutex_lock( &m_sessionMutex );
             m_connectUri = uri;
-            logMessage( "connectUri set from CONFIG:", m_connectUri.c_str() );
+            pthread_mutex_unlock( &m_sessionMutex );
+            logMessage( "connectUri set from CONFIG:", uri );
         }
         // URI was not set properly
         else {
             displayError( "getConnect_Done", "Valid URI was not specified when trying to retrieve config." );
         }
 
-        // Reset the connected state
-        setConnectedState( false );
+        mf_requestConfig();
+    }
+
+    /**
+     * Function requests the config from the server at the current URI.
+     */
+    void Core::mf_requestConfig() {
+        // Reset the connected state, unless the stored config keeps us connected while this refreshes it
+        if( !m_serverConfigApplied ) {
+            setConnectedState( false );
+        }
         
         // Make the request
-        do_httpGetRequest( API_GET_CONFIG, "GET", "getConfig_Done" );
+        do_httpGetRequest( API_GET_CONFIG, "GET", Const::Callback_GetConfig );
+    }
+
+    /**
+     * Function applies the telemetry settings from a server config object. Called from
+     * the HTTP and storage writer threads.
+     */
+    void Core::mf_applyServerConfig( json_t* root ) {
+        pthread_mutex_lock( &m_configMutex );
+        json_t* eventsDetailLevel = json_object_get( root, "eventsDetailLevel" );
+        if( eventsDetailLevel && json_is_integer( eventsDetailLevel ) ) {
+            config.eventsDetailLevel = (int)json_integer_value( eventsDetailLevel );
+        }
+        
+        json_t* eventsPeriodSecs = json_object_get( root, "eventsPeriodSecs" );
+        if( eventsPeriodSecs && json_is_integer( eventsPeriodSecs ) ) {
+            config.eventsPeriodSecs = (int)json_integer_value( eventsPeriodSecs );
+        }
+        
+        json_t* eventsMinSize = json_object_get( root, "eventsMinSize" );
+        if( eventsMinSize && json_is_integer( eventsMinSize ) ) {
+            config.eventsMinSize = (int)json_integer_value( eventsMinSize );
+        }
+        
+        json_t* eventsMaxSize = json_object_get( root, "eventsMaxSize" );
+        if( eventsMaxSize && json_is_integer( eventsMaxSize ) ) {
+            config.eventsMaxSize = (int)json_integer_value( eventsMaxSize );
+        }
+
+        // The server opts in to the envelope telemetry format
+        json_t* eventsBatchFormat = json_object_get( root, "eventsBatchFormat" );
+        if( eventsBatchFormat && json_is_integer( eventsBatchFormat ) ) {
+            config.eventsBatchFormat = (int)json_integer_value( eventsBatchFormat );
+        }
+
+        json_t* eventsAggregatePeriodSecs = json_object_get( root, "eventsAggregatePeriodSecs" );
+        if( eventsAggregatePeriodSecs && json_is_integer( eventsAggregatePeriodSecs ) ) {
+            config.eventsAggregatePeriodSecs = (int)json_integer_value( eventsAggregatePeriodSecs );
+        }
+
+        json_t* eventsQueuePolicy = json_object_get( root, "eventsQueuePolicy" );
+        if( eventsQueuePolicy && json_is_integer( eventsQueuePolicy ) ) {
+            config.eventsQueuePolicy = (int)json_integer_value( eventsQueuePolicy );
+        }
+
+        json_t* eventsQueueMaxBytes = json_object_get( root, "eventsQueueMaxBytes" );
+        if( eventsQueueMaxBytes && json_is_integer( eventsQueueMaxBytes ) ) {
+            config.eventsQueueMaxBytes = (int)json_integer_value( eventsQueueMaxBytes );
+        }
+
+        // The server accepts deflate request bodies, compressed queue entries are sent compressed
+        json_t* eventsSendCompressed = json_object_get( root, "eventsSendCompressed" );
+        if( eventsSendCompressed && json_is_boolean( eventsSendCompressed ) ) {
+            config.eventsSendCompressed = json_is_true( eventsSendCompressed ) ? 1 : 0;
+        }
+        pthread_mutex_unlock( &m_configMutex );
+
+        // Per event name limits override the ones set locally, ie. { "name": { "sampleRate": 0.1, "ratePerSec": 2, "burst": 10 } }
+        json_t* eventsLimits = json_object_get( root, "eventsLimits" );
+        if( eventsLimits && json_is_object( eventsLimits ) ) {
+            const char* name;
+            json_t* limit;
+            json_object_foreach( eventsLimits, name, limit ) {
+                json_t* sampleRate = json_object_get( limit, "sampleRate" );
+                if( sampleRate && json_is_number( sampleRate ) ) {
+                    setTelemEventSampleRate( name, (float)json_number_value( sampleRate ) );
+                }
+
+                json_t* ratePerSec = json_object_get( limit, "ratePerSec" );
+                json_t* burst = json_object_get( limit, "burst" );
+                if( ratePerSec && json_is_number( ratePerSec ) ) {
+                    int burstSize = burst && json_is_integer( burst ) ? (int)json_integer_value( burst ) : 1;
+                    setTelemEventRateLimit( name, (float)json_number_value( ratePerSec ), burstSize );
+                }
+            }
+        }
+    }
+
+    /**
+     * Function stores the config JSON with the URI it came from, keyed by the bootstrap URI
+     * and gameId of the current connection. An empty string forgets it.
+     */
+    void Core::mf_storeServerConfig( const char* json ) {
+        pthread_mutex_lock( &m_sessionMutex );
+        string bootstrapUri = m_bootstrapUri;
+        string gameId = m_gameId;
+        string connectUri = m_connectUri;
+        pthread_mutex_unlock( &m_sessionMutex );
+
+        if( m_dataSync != NULL ) {
+            m_dataSync->storeServerConfig( bootstrapUri, gameId, connectUri, json );
+        }
+        m_serverConfigApplied = strlen( json ) > 0;
+    }
+
+    /**
+     * Function returns true if a server config, stored or fresh, is in use.
+     */
+    bool Core::mf_hasServerConfig() {
+        return m_serverConfigApplied;
+    }
+
+    /**
+     * Function applies the config and URI stored by the last successful getConfig for this
+     * bootstrap URI and gameId, so the SDK is connected and can flush queued telemetry
+     * before the connect handshake finishes.
+     */
+    void Core::mf_loadServerConfig( string bootstrapUri, string gameId ) {
+        string uri, json;
+        if( m_dataSync == NULL || !m_dataSync->getServerConfig( bootstrapUri, gameId, uri, json ) ) {
+            return;
+        }
+
+        json_error_t error;
+        json_t* root = json_loads( json.c_str(), 0, &error );
+        if( root && json_is_object( root ) ) {
+            // It only applies while the game still connects to the same server and game,
+            // and the URI or config the game set in the meantime are kept
+            pthread_mutex_lock( &m_sessionMutex );
+            bool applied = !m_serverConfigApplied && m_bootstrapUri == bootstrapUri && m_gameId == gameId;
+            if( applied ) {
+                if( !m_connectUriSet ) {
+                    m_connectUri = uri;
+                }
+                if( !m_configSet ) {
+                    mf_applyServerConfig( root );
+                }
+                m_serverConfigApplied = true;
+            }
+            pthread_mutex_unlock( &m_sessionMutex );
+
+            if( applied ) {
+                setConnectedState( true );
+                logMessage( "Applied the stored server config for:", uri.c_str() );
+            }
+        }
+        json_decref( root );
     }
 
 
@@ -402,13 +901,13 @@ namespace nsGlasslabSDK {
      */
     void Core::deviceUpdate() {
         // Setup the data
-        string data = "deviceId=";
-        data += m_deviceId;
-        data += "&gameId=";
-        data += m_gameId;
+        RequestWriter& data = mf_getRequestWriter();
+        data.beginForm();
+        data.addString( "deviceId", m_deviceId.c_str() );
+        data.addString( "gameId", m_gameId.c_str() );
 
         // Make the request
-        do_httpGetRequest( API_POST_DEVICE_UPDATE, "POST", "deviceUpdate_Done", data );
+        do_httpGetRequest( API_POST_DEVICE_UPDATE, "POST", Const::Callback_DeviceUpdate, data.finish() );
     }
 
     //--------------------------------------
@@ -447,6 +946,8 @@ namespace nsGlasslabSDK {
 
         // Get the player info
         sdkInfo.core->getPlayerInfo();
+
+        sdkInfo.core->mf_completeStartupStep( Startup_AuthStatus );
     }
 
     /**
@@ -455,7 +956,7 @@ namespace nsGlasslabSDK {
      */
     void Core::authStatus() {
         // Make the request
-        do_httpGetRequest( API_GET_AUTH_STATUS, "GET", "authStatus_Done", "" );
+        do_httpGetRequest( API_GET_AUTH_STATUS, "GET", Const::Callback_AuthStatus, "" );
     }
 
 
@@ -511,18 +1012,16 @@ namespace nsGlasslabSDK {
      */
     void Core::registerStudent( const char* username, const char* password, const char* firstName, const char* lastInitial ) {
         // Setup the data
-        string data = "systemRole=student";
-        data += "&username=";
-        data += username;
-        data += "&firstName=";
-        data += firstName;
-        data += "&lastName=";
-        data += lastInitial;
-        data += "&password=";
-        data += password;
+        RequestWriter& data = mf_getRequestWriter();
+        data.beginForm();
+        data.addString( "systemRole", "student" );
+        data.addString( "username", username );
+        data.addString( "firstName", firstName );
+        data.addString( "lastName", lastInitial );
+        data.addString( "password", password );
         
         // Make the request
-        do_httpGetRequest( API_POST_REGISTER, "POST", "register_Done", data );
+        do_httpGetRequest( API_POST_REGISTER, "POST", Const::Callback_Register, data.finish() );
     }
 
     /**
@@ -535,20 +1034,17 @@ namespace nsGlasslabSDK {
         string lastName = fullName.substr( strchr( name, ' ' ) - name + 1 );
 
         // Setup the data
-        string data = "systemRole=instructor";
-        data += "&email=";
-        data += email;
-        data += "&firstName=";
-        data += firstName.c_str();
-        data += "&lastName=";
-        data += lastName.c_str();
-        data += "&password=";
-        data += password;
-        data += "&newsletter=";
-        data += newsletter;
+        RequestWriter& data = mf_getRequestWriter();
+        data.beginForm();
+        data.addString( "systemRole", "instructor" );
+        data.addString( "email", email );
+        data.addString( "firstName", firstName.c_str() );
+        data.addString( "lastName", lastName.c_str() );
+        data.addString( "password", password );
+        data.addBoolean( "newsletter", newsletter );
         
         // Make the request
-        do_httpGetRequest( API_POST_REGISTER, "POST", "register_Done", data );
+        do_httpGetRequest( API_POST_REGISTER, "POST", Const::Callback_Register, data.finish() );
     }
 
 
@@ -622,7 +1118,7 @@ namespace nsGlasslabSDK {
      */
     void Core::getPlayerInfo() {
         // Make the request
-        do_httpGetRequest( API_GET_PLAYERINFO, "GET", "getPlayerInfo_Done" );
+        do_httpGetRequest( API_GET_PLAYERINFO, "GET", Const::Callback_GetPlayerInfo );
     }
 
 
@@ -697,7 +1193,7 @@ namespace nsGlasslabSDK {
      */
     void Core::getUserInfo() {
         // Make the request
-        do_httpGetRequest( API_GET_USER_PROFILE, "GET", "getUserInfo_Done" );
+        do_httpGetRequest( API_GET_USER_PROFILE, "GET", Const::Callback_GetUserInfo );
     }
 
     /**
@@ -787,14 +1283,18 @@ namespace nsGlasslabSDK {
     void Core::login( const char* username, const char* password, const char* type ) {
         // Allow for null types and "glasslab"
         if( type == NULL || strncmp( type, "glasslab", 8 ) ) {
+            // Cached profile responses belong to the previous user
+            clearResponseCache();
+
+
             // Set the username and password in the postdata
-            string data = "username=";
-            data += username;
-            data += "&password=";
-            data += password;
+            RequestWriter& data = mf_getRequestWriter();
+            data.beginForm();
+            data.addString( "username", username );
+            data.addString( "password", password );
             
             // Make the request
-            do_httpGetRequest( API_POST_LOGIN, "POST", "login_Done", data );
+            do_httpGetRequest( API_POST_LOGIN, "POST", Const::Callback_Login, data.finish() );
         }
         // Type is unrecognized
         else {
@@ -845,11 +1345,12 @@ namespace nsGlasslabSDK {
      */
     void Core::enroll( const char* courseCode ) {
         // Setup the data
-        string data = "courseCode=";
-        data += courseCode;
+        RequestWriter& data = mf_getRequestWriter();
+        data.beginForm();
+        data.addString( "courseCode", courseCode );
         
         // Make the request
-        do_httpGetRequest( API_POST_ENROLL, "POST", "enroll_Done", data );
+        do_httpGetRequest( API_POST_ENROLL, "POST", Const::Callback_Enroll, data.finish() );
     }
     
     /**
@@ -892,11 +1393,12 @@ namespace nsGlasslabSDK {
      */
     void Core::unenroll( const char* courseId ) {
         // Setup the data
-        string data = "courseId=";
-        data += courseId;
+        RequestWriter& data = mf_getRequestWriter();
+        data.beginForm();
+        data.addString( "courseId", courseId );
 
         // Make the request
-        do_httpGetRequest( API_POST_UNENROLL, "POST", "unenroll_Done", data );
+        do_httpGetRequest( API_POST_UNENROLL, "POST", Const::Callback_Unenroll, data.finish() );
     }
 
 
@@ -943,7 +1445,7 @@ namespace nsGlasslabSDK {
      */
     void Core::getCourses() {
         // Make the request
-        do_httpGetRequest( API_GET_COURSES, "GET", "getCourses_Done" );
+        do_httpGetRequest( API_GET_COURSES, "GET", Const::Callback_GetCourses );
     }
     
 
@@ -989,11 +1491,14 @@ namespace nsGlasslabSDK {
      * Logout function communicates with the server to log the current user out.
      */
     void Core::logout() {
+        // Cached profile responses belong to this user
+        clearResponseCache();
+
         // Setup the data
         string data = " ";
 
         // Make the request
-        do_httpGetRequest( API_POST_LOGOUT, "POST", "logout_Done", data );
+        do_httpGetRequest( API_POST_LOGOUT, "POST", Const::Callback_Logout, data );
     }
 
 
@@ -1049,6 +1554,8 @@ namespace nsGlasslabSDK {
         
         // Decrease the reference count, this way Jansson can release "root" resources
         json_decref( root );
+
+        sdkInfo.core->mf_completeStartupStep( Startup_PlaySession );
     }
 
     /**
@@ -1059,7 +1566,7 @@ namespace nsGlasslabSDK {
         startSessionTimer();
 
         // Add this message to the message queue
-        do_httpGetRequest( API_GET_PLAY_SESSION_START, "GET", "startPlaySession_Done" );
+        do_httpGetRequest( API_GET_PLAY_SESSION_START, "GET", Const::Callback_StartPlaySession );
     }
 
 
@@ -1136,13 +1643,12 @@ namespace nsGlasslabSDK {
      */
     void Core::startSession() {
         // Set initial parameters to set in the API call
-        string courseOut = "";
-        string dataOut = "";
+        RequestWriter& dataOut = mf_getRequestWriter();
+        dataOut.beginForm();
         
         // Check for the deviceId and append it to the postdata
         if( m_deviceId.length() > 0 ) {
-            dataOut += "deviceId=";
-            dataOut += m_deviceId;
+            dataOut.addString( "deviceId", m_deviceId.c_str() );
         }
         // The deviceId is invalid
         else {
@@ -1153,26 +1659,28 @@ namespace nsGlasslabSDK {
 
         // Reset the gameSessionEventOrder in the SQLite database
         m_gameSessionEventOrder = 1;
+        pthread_mutex_lock( &m_sessionMutex );
+        map<string, glSession>::iterator session = m_sessions.find( m_deviceId );
+        if( session != m_sessions.end() ) {
+            session->second.gameSessionEventOrder = m_gameSessionEventOrder;
+            session->second.fields |= SessionField_EventOrder;
+        }
+        pthread_mutex_unlock( &m_sessionMutex );
         m_dataSync->updateGameSessionEventOrderWithDeviceId( m_deviceId, m_gameSessionEventOrder );
 
         // Append gameLevel info to the postdata if it exists
         if(m_gameLevel.length() > 0){
-            dataOut += "&gameLevel=";
-            dataOut += m_gameLevel;
+            dataOut.addString( "gameLevel", m_gameLevel.c_str() );
         }
 
         // Append the gameId
-        dataOut += "&gameId=";
-        dataOut += m_gameId;
+        dataOut.addString( "gameId", m_gameId.c_str() );
 
         // Append timestamp info to the postdata
-        char t[21];
-        sprintf(t, "%d", (int)time(NULL));
-        dataOut += "&timestamp=";
-        dataOut += t;
+        dataOut.addInteger( "timestamp", (int)( getClock()->wallMillis() / 1000 ) );
 
         // Add this message to the message queue
-        mf_addMessageToDataQueue( API_POST_SESSION_START, "POST", "startSession_Done", dataOut, "application/x-www-form-urlencoded" );
+        mf_addMessageToDataQueue( API_POST_SESSION_START, "POST", Const::Callback_StartSession, dataOut.finish(), "application/x-www-form-urlencoded" );
 
         // Record an "start session" telemetry event
         saveTelemEvent( "Game_start_unit_of_analysis" );
@@ -1230,23 +1738,24 @@ namespace nsGlasslabSDK {
      * during the message queue flushing.
      */
     void Core::endSession() {
+        // Summarize the aggregates gathered in this session before it ends
+        flushTelemAggregates();
+
         // Record an "end session" telemetry event
         saveTelemEvent( "Game_end_unit_of_analysis" );
 
         // Send all events before end session
         sendTelemEvents();
 
-        // Append the gameSessionId to the postdata
-        string dataOut = "";
-        dataOut += "gameSessionId=$gameSessionId$";
+        // Append the gameSessionId placeholder to the postdata, it is replaced during the flush
+        RequestWriter& dataOut = mf_getRequestWriter();
+        dataOut.beginForm();
+        dataOut.addRaw( "gameSessionId", "$gameSessionId$" );
         // Append the timestamp to the postdata
-        char t[21];
-        sprintf(t, "%d", (int)time(NULL));
-        dataOut += "&timestamp=";
-        dataOut += t;
+        dataOut.addInteger( "timestamp", (int)( getClock()->wallMillis() / 1000 ) );
 
         // Add this message to the message queue
-        mf_addMessageToDataQueue( API_POST_SESSION_END, "POST", "endSession_Done", dataOut, "application/x-www-form-urlencoded" );
+        mf_addMessageToDataQueue( API_POST_SESSION_END, "POST", Const::Callback_EndSession, dataOut.finish(), "application/x-www-form-urlencoded" );
     }
     
     
@@ -1291,7 +1800,7 @@ namespace nsGlasslabSDK {
     void Core::saveGame( const char* gameData ) {
         // Add this message to the message queue
         //mf_addMessageToDataQueue( url, "saveGame_Done", cb, gameData, "application/json" );
-        do_httpGetRequest( API_POST_SAVEGAME, "POST", "saveGame_Done", gameData, "application/json" );
+        do_httpGetRequest( API_POST_SAVEGAME, "POST", Const::Callback_SaveGame, gameData, "application/json" );
     }
 
     /**
@@ -1332,7 +1841,7 @@ namespace nsGlasslabSDK {
     void Core::getSaveGame() {
         // Add this message to the message queue
         //mf_addMessageToDataQueue( url, "getSaveGame_Done", cb );
-        do_httpGetRequest( API_GET_SAVEGAME, "GET", "getSaveGame_Done" );
+        do_httpGetRequest( API_GET_SAVEGAME, "GET", Const::Callback_GetSaveGame );
     }
 
 
@@ -1374,7 +1883,7 @@ namespace nsGlasslabSDK {
     void Core::deleteSaveGame() {
         // Add this message to the message queue
         //mf_addMessageToDataQueue( url, "deleteSaveGame_Done", cb );
-        do_httpGetRequest( API_DELETE_SAVEGAME, "DELETE", "deleteSaveGame_Done" );
+        do_httpGetRequest( API_DELETE_SAVEGAME, "DELETE", Const::Callback_DeleteSaveGame );
     }
 
 
@@ -1428,16 +1937,14 @@ namespace nsGlasslabSDK {
         saveTelemEvent( "Achievement" );
 
         // Append the parameter information to the postdata
-        string dataOut = "{\"item\":\"";
-        dataOut += item;
-        dataOut += "\",\"group\":\"";
-        dataOut += group;
-        dataOut += "\",\"subGroup\":\"";
-        dataOut += subGroup;
-        dataOut += "\"}";
+        RequestWriter& dataOut = mf_getRequestWriter();
+        dataOut.beginJSON();
+        dataOut.addString( "item", item );
+        dataOut.addString( "group", group );
+        dataOut.addString( "subGroup", subGroup );
         
         // Add this message to the message queue
-        mf_addMessageToDataQueue( API_POST_ACHIEVEMENT, "POST", "saveAchievement_Done", dataOut, "application/json" );
+        mf_addMessageToDataQueue( API_POST_ACHIEVEMENT, "POST", Const::Callback_SaveAchievement, dataOut.finish(), "application/json" );
     }
 
 
@@ -1541,16 +2048,12 @@ namespace nsGlasslabSDK {
      */
     void Core::sendTotalTimePlayed() {
         // Append the totalTimePlayed to the postdata
-        string dataOut = "";
-        dataOut += "{\"setTime\":";
-        // Append the timestamp to the postdata
-        char t[21];
-        sprintf(t, "%.2f", getTotalTimePlayed());
-        dataOut += t;
-        dataOut += "}";
+        RequestWriter& dataOut = mf_getRequestWriter();
+        dataOut.beginJSON();
+        dataOut.addReal( "setTime", getTotalTimePlayed(), 2 );
 
         // Add this message to the queue
-        mf_addMessageToDataQueue( API_POST_TOTAL_TIME_PLAYED, "POST", "sendTotalTimePlayed_Done", dataOut, "application/json" );
+        mf_addMessageToDataQueue( API_POST_TOTAL_TIME_PLAYED, "POST", Const::Callback_SendTotalTimePlayed, dataOut.finish(), "application/json" );
     }
 
 
@@ -1626,12 +2129,12 @@ namespace nsGlasslabSDK {
         apiPath += t;
 
         // Append the parameter information to the postdata
-        string dataOut = "{\"invitedUsers\":";
-        dataOut += opponentId;
-        dataOut += "}";
+        RequestWriter& dataOut = mf_getRequestWriter();
+        dataOut.beginJSON();
+        dataOut.addInteger( "invitedUsers", opponentId );
 
         // Make this request
-        do_httpGetRequest( API_POST_CREATE_MATCH, "POST", "createMatch_Done", dataOut, "application/json" );
+        do_httpGetRequest( API_POST_CREATE_MATCH, "POST", Const::Callback_CreateMatch, dataOut.finish(), "application/json" );
     }
 
 
@@ -1674,17 +2177,20 @@ namespace nsGlasslabSDK {
      * UpdateMatch function attempts to update/append to existing match data.
      */
     void Core::updateMatch( int matchId, const char* data, int nextPlayerTurn ) {
-        // Append the parameter information to the postdata
-        string dataOut = "{\"matchId\":\"";
-        dataOut += matchId;
-        dataOut += "\",\"turnData\":\"";
-        dataOut += data;
-        dataOut += "\",\"nextPlayer\":\"";
-        dataOut += nextPlayerTurn;
-        dataOut += "\"}";
+        // Append the parameter information to the postdata, the ids are sent as strings
+        char matchIdString[ 21 ];
+        char nextPlayerString[ 21 ];
+        sprintf( matchIdString, "%d", matchId );
+        sprintf( nextPlayerString, "%d", nextPlayerTurn );
+
+        RequestWriter& dataOut = mf_getRequestWriter();
+        dataOut.beginJSON();
+        dataOut.addString( "matchId", matchIdString );
+        dataOut.addString( "turnData", data );
+        dataOut.addString( "nextPlayer", nextPlayerString );
         
         // Make this request
-        do_httpGetRequest( API_POST_SUBMIT_MATCH, "POST", "updateMatch_Done", dataOut, "application/json" );
+        do_httpGetRequest( API_POST_SUBMIT_MATCH, "POST", Const::Callback_UpdateMatch, dataOut.finish(), "application/json" );
     }
 
 
@@ -1728,7 +2234,7 @@ namespace nsGlasslabSDK {
      */
     void Core::pollMatches() {
         // Make this request
-        do_httpGetRequest( API_GET_POLL_MATCHES, "GET", "pollMatches_Done" );
+        do_httpGetRequest( API_GET_POLL_MATCHES, "GET", Const::Callback_PollMatches );
     }
 
 
@@ -1781,46 +2287,36 @@ namespace nsGlasslabSDK {
      * events exist, it will call the callbacks normally.
      */
     void Core::sendTelemEvents() {
+        // Collect the events published by every capturing thread, which also covers a pending spill
+        m_telemSpillRequested = false;
+        mf_drainTelemEvents();
+
         // Get the current total time played for updating and setting in the internal database
         float newTime = getTotalTimePlayed();
 
         // First, increment the game timer if it is active
         if( m_gameTimerActive ) {
             // Get the current time
-            time_t currentTime = time( NULL );
+            int64_t currentTime = getClock()->monotonicMicros();
             
             // Measure the time between last game time and current (in seconds)
-            float delta = difftime( currentTime, m_gameTimerLast );
+            float delta = (float)Clock::secondsBetween( m_gameTimerLast, currentTime );
             m_gameTimerLast = currentTime;
 
             // Increment the total time played and set it
             newTime += delta;
             updatePlayerInfoKey( "$totalTimePlayed$", newTime );
         }
+        m_telemTimePlayed = newTime;
+
+        // Summarize the aggregated telemetry once per window
+        mf_emitTelemAggregates( false );
         
 
         //printf( "send telem event\n%s\n%s", clientCB.c_str(), coreCB.c_str() );
-        // Set the initial JSON postdata string
-        string jsonOut = "";
-        
         // Continue with the request if there is telemetry to send
-        if( json_array_size( m_telemEvents ) > 0 ) {
-            // Get the telemetry JSON
-            char* rootJSON = json_dumps( m_telemEvents, JSON_ENCODE_ANY | JSON_INDENT(3) | JSON_SORT_KEYS );
-            jsonOut = rootJSON;
-            free( rootJSON );
-         
-            printf( "\n---------------------------\n" );
-            printf( "sendTelemEvents Num of Events being sent: %lu\n", json_array_size(m_telemEvents) );
-            printf( "sendTelemEvents: %s\n", jsonOut.c_str() );
-            printf( "\n---------------------------\n" );
-         
-            // Add this message to the queue
-            mf_addMessageToDataQueue( API_POST_EVENTS, "POST", "sendTelemEvent_Done", jsonOut.c_str(), "application/json" );
-            
-            // Reset all memebers in event list
-            clearTelemEventValues();
-            //printf( "sendTelemEvents Events after clear: %lu\n", json_array_size(m_telemEvents) );
+        if( m_telemBuffer.getEventCount() > 0 ) {
+            mf_queueTelemEvents();
         }
         // No telemetry exists, perform callbacks normally
         else {
@@ -1838,12 +2334,85 @@ namespace nsGlasslabSDK {
         }
 
         // Update the totalTimePlayed in the SQLite database
-        m_dataSync->updatePlayerInfoFromDeviceId( m_deviceId, newTime, m_gameSessionEventOrder );
+        mf_updatePlayerInfo( newTime );
 
         // Attempt to dispatch the message queue
         attemptMessageDispatch();
     }
     
+    /**
+     * Function writes the events in the capture arena to the message queue as a
+     * single request and clears the arena.
+     */
+    void Core::mf_queueTelemEvents() {
+        mf_queueTelemBuffer( m_telemBuffer );
+
+        // Reset all memebers in event list
+        clearTelemEventValues();
+    }
+
+    /**
+     * Function writes the events of a buffer to the message queue as a single
+     * request. Also called on the flush thread for a spill, so the device id is
+     * read under the context lock.
+     */
+    void Core::mf_queueTelemBuffer( const TelemetryBuffer& buffer ) {
+        string postdata;
+        const char* contentType;
+
+        // Stamp the clock skew known now, so the server can correct the client timestamps however late the batch is sent
+        bool clockSkewKnown = m_clockSkewKnown;
+        int64_t clockSkewMs = clockSkewKnown ? (int64_t)m_clockSkewMs : 0;
+
+        // The binary format is stored base64 encoded, its header is added when the queue is flushed
+        if( mf_getConfig().eventsBatchFormat == Const::TelemFormat_Binary ) {
+            string body;
+            buffer.encodeBinary( body, clockSkewMs );
+
+            printf( "\n---------------------------\n" );
+            printf( "sendTelemEvents Num of Events being sent: %lu (%lu bytes binary)\n", buffer.getEventCount(), body.size() );
+            printf( "\n---------------------------\n" );
+
+            postdata = TelemetryBuffer::toBase64( body );
+            contentType = TELEM_BINARY_CONTENT_TYPE;
+        }
+        else {
+            // Render the captured events as JSON, this is the only point telemetry touches jansson
+            json_t* telemEvents = buffer.toJSON( mf_getConfig().eventsBatchFormat );
+            if( clockSkewKnown ) {
+                // The legacy format has no envelope, each event carries the value
+                if( json_is_array( telemEvents ) ) {
+                    for( size_t i = 0; i < json_array_size( telemEvents ); i++ ) {
+                        json_object_set_new( json_array_get( telemEvents, i ), "clockSkewMs", json_integer( (json_int_t)clockSkewMs ) );
+                    }
+                }
+                else {
+                    json_object_set_new( telemEvents, "clockSkewMs", json_integer( (json_int_t)clockSkewMs ) );
+                }
+            }
+            char* rootJSON = json_dumps( telemEvents, JSON_ENCODE_ANY | JSON_INDENT(3) | JSON_SORT_KEYS );
+            postdata = rootJSON;
+            free( rootJSON );
+            json_decref( telemEvents );
+
+            printf( "\n---------------------------\n" );
+            printf( "sendTelemEvents Num of Events being sent: %lu\n", buffer.getEventCount() );
+            printf( "sendTelemEvents: %s\n", postdata.c_str() );
+            printf( "\n---------------------------\n" );
+
+            contentType = "application/json";
+        }
+
+        pthread_mutex_lock( &m_telemContextMutex );
+        string deviceId = m_deviceId;
+        pthread_mutex_unlock( &m_telemContextMutex );
+
+        // Add this message to the queue
+        if( m_dataSync != NULL ) {
+            m_dataSync->addToMsgQ( deviceId, API_POST_EVENTS, "POST", Const::Callback_SendTelemEvent, postdata, contentType );
+        }
+    }
+
     /**
      * This function will force a call to flushMsgQ to ensure all requests are made to the server.
      * This is a useful function for games that store the database in memory, making it a temporary
@@ -1857,6 +2426,22 @@ namespace nsGlasslabSDK {
         if( getConnectedState() ) {
             m_dataSync->doFlushMsgQ();
         }
+
+        // Keep a copy of what is left in an in-memory database
+        if( m_dataSync != NULL ) {
+            m_dataSync->snapshotDatabase();
+        }
+    }
+
+    /**
+     * Database writes are applied on the storage writer thread when the SDK is built
+     * with MULTITHREADED. This function blocks until the writes made so far are in the
+     * database, e.g. before the application is suspended.
+     */
+    void Core::flushStorageWrites() {
+        if( m_dataSync != NULL ) {
+            m_dataSync->flushWrites();
+        }
     }
 
     /**
@@ -1865,18 +2450,19 @@ namespace nsGlasslabSDK {
      */
     void Core::attemptMessageDispatch() {
         // Get the current time
-        time_t currentTime = time( NULL );
+        int64_t currentTime = getClock()->monotonicMicros();
         // Measure the time between last and current (in seconds)
-        float secondsElapsed = difftime( currentTime, m_telemetryLastTime );
+        float secondsElapsed = (float)Clock::secondsBetween( m_telemetryLastTime, currentTime );
         //printf( "Current elapsed: %f\n", secondsElapsed );
+        glConfig current = mf_getConfig();
 
         // If the seconds elapsed exceeds our interval, reset the current telemetry clock and
         // flush the message queue
-        if( secondsElapsed > config.eventsPeriodSecs ) {
+        if( secondsElapsed > current.eventsPeriodSecs ) {
 
             //printf( "secondsElapsed: %f,  getMessageTableSize: %d, config.eventsMinSize: %d\n", secondsElapsed, m_dataSync->getMessageTableSize(), config.eventsMinSize);
             // Check that we exceed the minimum number of events to send data
-            if( m_dataSync->getMessageTableSize() > config.eventsMinSize ) {
+            if( m_dataSync->getMessageTableSize() > current.eventsMinSize ) {
                 // In addition to flushing the message queue, do a POST on the totalTimePlayed
                 sendTotalTimePlayed();
 
@@ -1931,24 +2517,26 @@ namespace nsGlasslabSDK {
                     request->core->setCookie( setCookie );
                 }
 
+                // Compare the server clock to ours
+                request->core->mf_sampleClockSkew( req, request->sentMicros );
+
                 // Mark the status of the event as success to remove it from the table
                 request->core->mf_updateMessageStatusInDataQueue( request->msgQRowId, "success" );
 
                 
-                // If the core callback exists, run it
-                if( request->coreCBKey != "" ) {
-                    if( request->core->getCoreCallbackCancelState( request->coreCBKey ) ) {
-                        request->core->setCoreCallbackCancelState( request->coreCBKey, false );
-                        request->core->logMessage( "\n\t\t request ignored because it was cancelled" );
-                    }
-                    else {
-                        p_glSDKInfo sdkInfo;
-                        sdkInfo.sdk = request->sdk;
-                        sdkInfo.core = request->core;
-                        sdkInfo.data = inbuffer;
-                        sdkInfo.success = true;
-                        request->core->getCoreCallback( request->coreCBKey )( sdkInfo );
-                    }
+                // If the core callback exists, run it for every request waiting on the response
+                p_glSDKInfo sdkInfo;
+                sdkInfo.sdk = request->sdk;
+                sdkInfo.core = request->core;
+                sdkInfo.data = inbuffer;
+                sdkInfo.success = true;
+                // A 304 is answered with the cached body, a fresh body is stored with its validators.
+                // If the cached copy was removed meanwhile, the request is sent again without them
+                if( request->cacheKey.length() > 0 && !request->core->mf_cacheResponse( req, request->cacheKey, sdkInfo.data ) && request->revalidated ) {
+                    request->retryUncached = true;
+                }
+                else {
+                    request->core->mf_runCoreCallback( request->handle, request->coreCBId, sdkInfo );
                 }
 
                 // Delete the info buffer
@@ -1960,8 +2548,10 @@ namespace nsGlasslabSDK {
             }
 
             if(request) {
-                // Terminate event_base_dispatch()
-                event_base_loopbreak( request->base );
+                // Terminate event_base_dispatch() once every request on the base is answered
+                if( --( *request->pending ) == 0 ) {
+                    event_base_loopbreak( request->base );
+                }
                 
                 //evhttp_connection_free(request->conn);
                 //event_base_free(request->base);
@@ -1978,25 +2568,19 @@ namespace nsGlasslabSDK {
                 request->core->mf_updateMessageStatusInDataQueue( request->msgQRowId, "failed" );
 
                 string errorMessage = "{\"status\":\"error\",\"error\":\"request timed out\"}";
-                // If the core callback exists, run it
-                if( request->coreCBKey != "" ) {
-                    if( request->core->getCoreCallbackCancelState( request->coreCBKey ) ) {
-                        request->core->setCoreCallbackCancelState( request->coreCBKey, false );
-                        request->core->logMessage( "\n\t\t request ignored because it was cancelled" );
-                    }
-                    else {
-                        p_glSDKInfo sdkInfo;
-                        sdkInfo.sdk = request->sdk;
-                        sdkInfo.core = request->core;
-                        sdkInfo.data = errorMessage.c_str();
-                        sdkInfo.success = false;
-                        request->core->getCoreCallback( request->coreCBKey )( sdkInfo );
-                    }
-                }
+                // If the core callback exists, run it for every request waiting on the response
+                p_glSDKInfo sdkInfo;
+                sdkInfo.sdk = request->sdk;
+                sdkInfo.core = request->core;
+                sdkInfo.data = errorMessage.c_str();
+                sdkInfo.success = false;
+                request->core->mf_runCoreCallback( request->handle, request->coreCBId, sdkInfo );
 
                 if(request) {
-                    // Terminate event_base_dispatch()
-                    event_base_loopbreak( request->base );
+                    // Terminate event_base_dispatch() once every request on the base is answered
+                    if( --( *request->pending ) == 0 ) {
+                        event_base_loopbreak( request->base );
+                    }
                     
                     //evhttp_connection_free(request->conn);
                     //event_base_free(request->base);
@@ -2013,24 +2597,45 @@ namespace nsGlasslabSDK {
      * If multithreaded processing is enabled, it creates a job and starts the job processor thread. If it fails at making
      * the thread for whatever reason, it performs a synchronous request.
      * If multithreaded processing is disabled, it simply performs a synchronous request.
+     * A GET of a read-only endpoint identical to one that is queued or in flight is attached to it instead
+     * of being sent again, and the response is fanned out to every waiter.
+     * Returns the handle of the request, which can be passed to cancelRequestHandle().
      */
-    void Core::do_httpGetRequest( string path, string requestType, string coreCB, string postdata, string contentType, int rowId )
+    int Core::do_httpGetRequest( string path, string requestType, int coreCB, const string& postdata, string contentType, int rowId )
     {
+        // Only idempotent GETs outside the message queue are shared, and only for endpoints whose
+        // response is the same for every caller
+        string flightKey = "";
+        bool sharedEndpoint = coreCB == Const::Callback_GetUserInfo || coreCB == Const::Callback_AuthStatus ||
+                              coreCB == Const::Callback_GetCourses || coreCB == Const::Callback_PollMatches;
+        if( sharedEndpoint && requestType == "GET" && postdata.length() == 0 && rowId == -1 ) {
+            char coreCBStr[ 16 ];
+            sprintf( coreCBStr, "%i", coreCB );
+            flightKey = path + "|" + contentType + "|" + coreCBStr;
+        }
+
+        int handle;
+        bool attached = false;
 #ifdef MULTITHREADED
-        // Check if thread has been started.
+        // Check if thread has been started. API calls and the storage writer thread can get here
+        // at the same time, only one of them starts it
         if (!threadStarted)
         {
             // Attempt thread start.
-            if (mf_startAsyncHTTPRequestThread() != 0)
+            if (mf_startAsyncHTTPRequestThread() == 2)
             {
                 // Async failed!
                 logMessage("Couldn't start http async get request thread, proceeding synchronously...");
                 
-                // Do synchronous request
-                mf_httpGetRequest(path, requestType, coreCB, postdata, contentType.c_str(), rowId);
+                // Do synchronous request, unless another thread is already sending it
+                handle = mf_newRequestHandle(coreCB, flightKey, true, attached);
+                if (!attached)
+                {
+                    mf_httpGetRequest(path, requestType, coreCB, postdata, contentType.c_str(), rowId, NULL, handle);
+                }
                 
                 // Exit
-                return;
+                return handle;
             }
         }
         
@@ -2044,14 +2649,28 @@ namespace nsGlasslabSDK {
         jobData->postdata = postdata;
         jobData->contentType = contentType;
         jobData->rowId = rowId;
+        jobData->group = (int)(intptr_t)pthread_getspecific(m_requestGroupKey);
         
         // Lock job queue, add job to queue, then unlock
         pthread_mutex_lock(&m_jobQueueMutex);
+        
+        // The handle is taken under the queue lock, so a cancel sees the job either queued or attached.
+        // A request queued behind a change would answer with the state before it, start a new flight then
+        bool newFlight = flightKey.length() > 0 && mf_mutationQueuedAfter(flightKey);
+        handle = mf_newRequestHandle(coreCB, flightKey, true, attached, newFlight);
+        if (attached)
+        {
+            pthread_mutex_unlock(&m_jobQueueMutex);
+            delete jobData;
+            return handle;
+        }
+        jobData->handle = handle;
+        
         bool shouldTriggerRequestThread = m_httpGetJobs.size() == 0;
 #ifdef VERBOSE
-        printf("QUEUE %i - %s - %s - %s - %s - %s\n", jobData->id, jobData->path.c_str(), jobData->requestType.c_str(), jobData->coreCB.c_str(), jobData->postdata.c_str(), jobData ->contentType.c_str());
+        printf("QUEUE %i - %s - %s - %s - %s - %s\n", jobData->id, jobData->path.c_str(), jobData->requestType.c_str(), getCoreCallbackName( jobData->coreCB ), jobData->postdata.c_str(), jobData ->contentType.c_str());
 #endif
-        m_httpGetJobs.push(jobData);
+        m_httpGetJobs.push_back(jobData);
         pthread_mutex_unlock(&m_jobQueueMutex);
         
         // If we had no jobs before, the processor thread needs to know. Broadcast it.
@@ -2061,8 +2680,12 @@ namespace nsGlasslabSDK {
         }
 #else
         // Perform synchronous call
-        mf_httpGetRequest(path, requestType, coreCB, postdata, contentType == "" ? NULL : contentType.c_str(), rowId);
+        handle = mf_newRequestHandle( coreCB, flightKey, true, attached );
+        if( !attached ) {
+            mf_httpGetRequest(path, requestType, coreCB, postdata, contentType == "" ? NULL : contentType.c_str(), rowId, NULL, handle);
+        }
 #endif
+        return handle;
     }
     
     /**
@@ -2074,40 +2697,59 @@ namespace nsGlasslabSDK {
      */
     int Core::mf_startAsyncHTTPRequestThread()
     {
-        // Check if thread is already started
-        if (threadStarted)
+        // The thread is created under the job queue lock, so mf_stopAsyncHTTPRequestThread sees it
+        // either started or never started
+        pthread_mutex_lock(&m_jobQueueMutex);
+        
+        // Check if thread is already started, and mark it as started otherwise. Once the SDK is
+        // shutting down, jobs stay queued
+        bool started = false;
+        if (m_httpThreadStopping || !threadStarted.compare_exchange_strong(started, true))
         {
             // If thread has already started, return error
-            logMessage("Tried to start async thread when it was already started!");
+            pthread_mutex_unlock(&m_jobQueueMutex);
             return 1;
         }
         
-        // Mark thread as started
-        threadStarted = true;
-        
-        // Initialize thread variables
-        pthread_t thread;
-        pthread_mutex_init(&m_jobQueueMutex, NULL);
-        
         // Attempt thread creation
         int pthreadError;
-        if ((pthreadError = pthread_create(&thread, NULL, proc_asyncHTTPGetRequests, (void*) this)) != 0)
+        if ((pthreadError = pthread_create(&m_httpThread, NULL, proc_asyncHTTPGetRequests, (void*) this)) != 0)
         {
+            threadStarted = false;
+            pthread_mutex_unlock(&m_jobQueueMutex);
+            
             // If thread creation returned code that wasn't 0, it failed. Exit immediately!
             char errorStr[256];
             
             sprintf(errorStr, "ERROR: Could not create pthread in startAsyncHTTPRequestThread - Error code: %i", pthreadError);
             logMessage(errorStr);
             
-            pthread_mutex_destroy(&m_jobQueueMutex);
-            
             return 2;
         }
+        pthread_mutex_unlock(&m_jobQueueMutex);
         
         // Return success
         return 0;
     }
     
+    /**
+     * mf_stopAsyncHTTPRequestThread - stops the thread processing m_httpGetJobs. The request being
+     * sent is finished, the jobs still queued are left in m_httpGetJobs.
+     */
+    void Core::mf_stopAsyncHTTPRequestThread()
+    {
+        pthread_mutex_lock(&m_jobQueueMutex);
+        m_httpThreadStopping = true;
+        bool started = threadStarted;
+        pthread_cond_broadcast(&m_jobTriggerCondition);
+        pthread_mutex_unlock(&m_jobQueueMutex);
+        
+        if (started)
+        {
+            pthread_join(m_httpThread, NULL);
+        }
+    }
+    
     /**
      * proc_asyncHTTPGetRequests is a THREADED STATIC function that takes in a Core instance.
      * The function then loops through all of the http request jobs queued up, doing a request one-by-one
@@ -2125,7 +2767,7 @@ namespace nsGlasslabSDK {
             
             // Wait if there are no jobs.
             // NOTE: This is necessary or the m_jobQueueMutex is essentially perma-locked if we do nothing else.
-            if (pCore->m_httpGetJobs.size() == 0)
+            if (pCore->m_httpGetJobs.size() == 0 && !pCore->m_dataSync->queueFlushRequested && !pCore->m_telemSpillRequested && !pCore->m_httpThreadStopping)
             {
                 int waitReturnCode = pthread_cond_wait(&pCore->m_jobTriggerCondition, &pCore->m_jobQueueMutex);
                 if (waitReturnCode != 0)
@@ -2137,6 +2779,20 @@ namespace nsGlasslabSDK {
                 }
             }
             
+            // The SDK is being destroyed
+            if (pCore->m_httpThreadStopping)
+            {
+                pthread_mutex_unlock(&pCore->m_jobQueueMutex);
+                break;
+            }
+            
+            if (pCore->m_telemSpillRequested)
+            {
+                pthread_mutex_unlock(&pCore->m_jobQueueMutex);
+                pCore->mf_spillTelemEvents();
+                continue;
+            }
+            
             if (pCore->m_dataSync->queueFlushRequested)
             {
                 pthread_mutex_unlock(&pCore->m_jobQueueMutex);
@@ -2144,26 +2800,56 @@ namespace nsGlasslabSDK {
                 continue;
             }
             
+            // The jobs may have been cancelled before we woke up
+            if (pCore->m_httpGetJobs.size() == 0)
+            {
+                pthread_mutex_unlock(&pCore->m_jobQueueMutex);
+                continue;
+            }
+            
             // Get the job at the front of the queue and remove it from the queue
             HTTPThreadData* jobData = pCore->m_httpGetJobs.front();
 #ifdef VERBOSE
-            printf("\nREMOVE %i - %s - %s - %s - %s - %s\n", jobData->id, jobData->path.c_str(), jobData->requestType.c_str(), jobData->coreCB.c_str(), jobData->postdata.c_str(), jobData ->contentType.c_str());
+            printf("\nREMOVE %i - %s - %s - %s - %s - %s\n", jobData->id, jobData->path.c_str(), jobData->requestType.c_str(), pCore->getCoreCallbackName( jobData->coreCB ), jobData->postdata.c_str(), jobData ->contentType.c_str());
 #endif
-            pCore->m_httpGetJobs.pop();
+            pCore->m_httpGetJobs.pop_front();
 #ifdef VERBOSE
-            printf("\nPOPPED %i - %s - %s - %s - %s - %s\n", jobData->id, jobData->path.c_str(), jobData->requestType.c_str(), jobData->coreCB.c_str(), jobData->postdata.c_str(), jobData ->contentType.c_str());
+            printf("\nPOPPED %i - %s - %s - %s - %s - %s\n", jobData->id, jobData->path.c_str(), jobData->requestType.c_str(), pCore->getCoreCallbackName( jobData->coreCB ), jobData->postdata.c_str(), jobData ->contentType.c_str());
 #endif
             
+            // Jobs queued as a group are independent of each other, take the rest of the group along
+            std::vector<HTTPThreadData*> group;
+            group.push_back(jobData);
+            while (jobData->group != 0 && pCore->m_httpGetJobs.size() > 0 && pCore->m_httpGetJobs.front()->group == jobData->group)
+            {
+                group.push_back(pCore->m_httpGetJobs.front());
+                pCore->m_httpGetJobs.pop_front();
+            }
+            
             // Release our lock on the job queue
             pthread_mutex_unlock(&pCore->m_jobQueueMutex);
             
 #ifdef VERBOSE
             // Make synchronous request for the job
-            printf("\nREQUEST %i - %s - %s - %s - %s - %s\n", jobData->id, jobData->path.c_str(), jobData->requestType.c_str(), jobData->coreCB.c_str(), jobData->postdata.c_str(), jobData ->contentType.c_str());
+            for (size_t i = 0; i < group.size(); i++)
+            {
+                printf("\nREQUEST %i - %s - %s - %s - %s - %s\n", group[i]->id, group[i]->path.c_str(), group[i]->requestType.c_str(), pCore->getCoreCallbackName( group[i]->coreCB ), group[i]->postdata.c_str(), group[i]->contentType.c_str());
+            }
 #endif
-            pCore->mf_httpGetRequest(jobData->path, jobData->requestType, jobData->coreCB, jobData->postdata, jobData->contentType == "" ? NULL : jobData->contentType.c_str(), jobData->rowId);
+            if (group.size() == 1)
+            {
+                pCore->mf_httpGetRequest(jobData->path, jobData->requestType, jobData->coreCB, jobData->postdata, jobData->contentType == "" ? NULL : jobData->contentType.c_str(), jobData->rowId, NULL, jobData->handle);
+            }
+            else
+            {
+                pCore->mf_httpGetRequests(group);
+            }
+            
             // Delete the job data
-            delete jobData;
+            for (size_t i = 0; i < group.size(); i++)
+            {
+                delete group[i];
+            }
         }
         
         // Exit
@@ -2175,13 +2861,84 @@ namespace nsGlasslabSDK {
      * HttpGetRequest function performs a GET/POST request to the server for
      * a single event extracted from the SQLite database.
      */
-    void Core::mf_httpGetRequest( string path, string requestType, string coreCB, string postdata, const char* contentType, int rowId ) {
+    void Core::mf_httpGetRequest( string path, string requestType, int coreCB, string postdata, const char* contentType, int rowId, const char* contentEncoding, int handle, bool useCache ) {
+        struct event_base* base = event_base_new();
+        int pending = 0;
+
+        p_glHttpRequest* httpRequest = mf_prepareHttpRequest( base, &pending, path, requestType, coreCB, postdata, contentType, rowId, contentEncoding, handle, useCache );
+        if( httpRequest != NULL ) {
+            event_base_dispatch( base );
+            mf_finishHttpRequest( httpRequest );
+        }
+
+        event_base_free( base );
+    }
+
+    /**
+     * Function sends a group of independent requests concurrently on one event base, returning
+     * once every response (or timeout) has been handled.
+     */
+    void Core::mf_httpGetRequests( std::vector<HTTPThreadData*>& jobs ) {
+        struct event_base* base = event_base_new();
+        int pending = 0;
+
+        std::vector<p_glHttpRequest*> requests;
+        for( size_t i = 0; i < jobs.size(); i++ ) {
+            HTTPThreadData* job = jobs[ i ];
+            p_glHttpRequest* httpRequest = mf_prepareHttpRequest( base, &pending, job->path, job->requestType, job->coreCB, job->postdata,
+                job->contentType == "" ? NULL : job->contentType.c_str(), job->rowId, NULL, job->handle );
+            if( httpRequest != NULL ) {
+                requests.push_back( httpRequest );
+            }
+        }
+
+        if( requests.size() > 0 ) {
+            event_base_dispatch( base );
+        }
+        for( size_t i = 0; i < requests.size(); i++ ) {
+            mf_finishHttpRequest( requests[ i ] );
+        }
+
+        event_base_free( base );
+    }
+
+    /**
+     * Function frees a request made by mf_prepareHttpRequest() once its base is done dispatching.
+     * A 304 that found no cached copy is sent again under the same handle, bypassing the cache.
+     */
+    void Core::mf_finishHttpRequest( p_glHttpRequest* httpRequest ) {
+        evhttp_connection_free( httpRequest->conn );
+        if( httpRequest->retryUncached ) {
+            logMessage( "\n\t\t cached response missing for a 304, sending the request again:", httpRequest->path.c_str() );
+            mf_httpGetRequest( httpRequest->path, httpRequest->requestType, httpRequest->coreCBId, "",
+                httpRequest->contentType.length() > 0 ? httpRequest->contentType.c_str() : NULL, -1, NULL, httpRequest->handle, false );
+        }
+        else {
+            mf_endRequest( httpRequest->handle );
+        }
+        delete httpRequest;
+    }
+
+    /**
+     * Function builds a request on the event base and makes it, counting it in pending. Returns
+     * NULL if nothing was sent: the request was answered from the response cache, cancelled or
+     * could not be made. Without useCache the cached copy is neither used nor revalidated, the
+     * response is still stored.
+     */
+    p_glHttpRequest* Core::mf_prepareHttpRequest( struct event_base* base, int* pending, string path, string requestType, int coreCB, string postdata, const char* contentType, int rowId, const char* contentEncoding, int handle, bool useCache ) {
+        // Requests from the message queue get their handle here, so cancelRequest() still reaches them
+        if( handle == -1 ) {
+            bool attached;
+            handle = mf_newRequestHandle( coreCB, "", false, attached );
+        }
+
         // Set initial information to send to the server
         struct evhttp_uri* uri;
         int port;
         const char* host;
         string url, requestMethod;
         struct evbuffer* postdata_buffer = NULL;
+        bool sent = false;
 
 		#ifdef _WIN32
 		WSADATA WSAData;
@@ -2189,7 +2946,9 @@ namespace nsGlasslabSDK {
 		#endif
 
         // Set the URI, host, and port information
-        url = m_connectUri;
+        pthread_mutex_lock( &m_sessionMutex );
+        url = coreCB == Const::Callback_GetConnect ? m_bootstrapUri : m_connectUri;
+        pthread_mutex_unlock( &m_sessionMutex );
         
         // Need to decode the URL in case there are escape characters
         // This is needed for SimCityEDU addresses passed through URL
@@ -2198,16 +2957,15 @@ namespace nsGlasslabSDK {
 
         // If the parsed URL is null, there's something wrong
         if( !uri ) {
-            if( coreCB.c_str() ) {
-                string errorMessage = "{\"status\":\"error\",\"error\":\"URL is invalid\"}";
-                p_glSDKInfo sdkInfo;
-                sdkInfo.sdk = m_sdk;
-                sdkInfo.core = this;
-                sdkInfo.data = errorMessage.c_str();
-                sdkInfo.success = false;
-                getCoreCallback( coreCB )( sdkInfo );
-            }
-            return;
+            string errorMessage = "{\"status\":\"error\",\"error\":\"URL is invalid\"}";
+            p_glSDKInfo sdkInfo;
+            sdkInfo.sdk = m_sdk;
+            sdkInfo.core = this;
+            sdkInfo.data = errorMessage.c_str();
+            sdkInfo.success = false;
+            mf_runCoreCallback( handle, coreCB, sdkInfo );
+            mf_endRequest( handle );
+            return NULL;
         }
 
         port = evhttp_uri_get_port( uri );
@@ -2219,18 +2977,21 @@ namespace nsGlasslabSDK {
         
         // If the parsed URL is null, there's something wrong
         if( !host ) {
-            if( coreCB.c_str() ) {
-                string errorMessage = "{\"status\":\"error\",\"error\":\"host is invalid\"}";
-                p_glSDKInfo sdkInfo;
-                sdkInfo.sdk = m_sdk;
-                sdkInfo.core = this;
-                sdkInfo.data = errorMessage.c_str();
-                sdkInfo.success = false;
-                getCoreCallback( coreCB )( sdkInfo );
-            }
-            return;
+            string errorMessage = "{\"status\":\"error\",\"error\":\"host is invalid\"}";
+            p_glSDKInfo sdkInfo;
+            sdkInfo.sdk = m_sdk;
+            sdkInfo.core = this;
+            sdkInfo.data = errorMessage.c_str();
+            sdkInfo.success = false;
+            mf_runCoreCallback( handle, coreCB, sdkInfo );
+            evhttp_uri_free( uri );
+            mf_endRequest( handle );
+            return NULL;
         }
 
+        // Kept to send the request again
+        string requestPath = path;
+
         //req.api = req.api.split( ":gameId" ).join( m_clientId );
         // Update the path to remove all ":gameId" occurrences, replacing them with the actual gameId
         string gameIdTag = ":gameId";
@@ -2240,25 +3001,67 @@ namespace nsGlasslabSDK {
             n += m_gameId.size();
         }
 
-        // Reset the cancel state of the callback
-        setCoreCallbackCancelState( coreCB, false );
+        // Cached GETs are answered locally within their TTL, and revalidated with the server after it
+        string cacheKey = "";
+        glCachedResponse cached;
+        bool revalidate = false;
+        int ttl = coreCB >= 0 && coreCB < Const::Callback_Count ? m_responseCacheTTL[ coreCB ] : -1;
+        if( ttl >= 0 && requestType == "GET" && postdata.length() == 0 && m_dataSync != NULL ) {
+            pthread_mutex_lock( &m_telemContextMutex );
+            cacheKey = m_deviceId + "|" + path;
+            pthread_mutex_unlock( &m_telemContextMutex );
+
+            if( useCache && m_dataSync->getCachedResponse( cacheKey, cached ) ) {
+                if( difftime( time( NULL ), cached.storedAt ) < ttl ) {
+                    p_glSDKInfo sdkInfo;
+                    sdkInfo.sdk = m_sdk;
+                    sdkInfo.core = this;
+                    sdkInfo.data = cached.body;
+                    sdkInfo.success = true;
+                    mf_runCoreCallback( handle, coreCB, sdkInfo );
+                    evhttp_uri_free( uri );
+                    mf_endRequest( handle );
+                    return NULL;
+                }
+                revalidate = true;
+            }
+        }
 
         // Create the HTTP request object and set appropriate information
         p_glHttpRequest *httpRequest = new p_glHttpRequest();
         httpRequest->sdk        = m_sdk;
         httpRequest->core       = this;
-        httpRequest->coreCBKey  = coreCB;
+        httpRequest->coreCBId   = coreCB;
         httpRequest->msgQRowId  = rowId;
+        httpRequest->handle     = handle;
+        httpRequest->cacheKey   = cacheKey;
+        httpRequest->revalidated = revalidate;
+        httpRequest->retryUncached = false;
+        httpRequest->path       = requestPath;
+        httpRequest->requestType = requestType;
+        httpRequest->contentType = contentType != NULL ? contentType : "";
+        httpRequest->pending    = pending;
+        httpRequest->sentMicros = getClock()->monotonicMicros();
         // Set additional information in the HTTP request
-        httpRequest->base       = event_base_new();
+        httpRequest->base       = base;
         httpRequest->conn       = evhttp_connection_base_new( httpRequest->base, NULL, host, port );
         httpRequest->req        = evhttp_request_new( httpGetRequest_Done, (void *)httpRequest );
 
-        // Only proceed if the HTTP request is valid
-        if( httpRequest->req != NULL ) {
+        // Only proceed if the HTTP request is valid and was not cancelled while it was set up
+        if( httpRequest->req != NULL && isRequestCancelled( handle ) ) {
+            logMessage( "\n\t\t request dropped because it was cancelled" );
+            // Cancelling only drops the callback, a queued message goes back to the queue to be sent later
+            mf_updateMessageStatusInDataQueue( rowId, "ready" );
+            evhttp_request_free( httpRequest->req );
+            httpRequest->req = NULL;
+        }
+        else if( httpRequest->req != NULL ) {
             // If the cookie already exists, pass it along
-            if( m_cookie != "" ) {
-                evhttp_add_header( httpRequest->req->output_headers, "cookie", m_cookie.c_str() );
+            pthread_mutex_lock( &m_sessionMutex );
+            string cookie = m_cookie;
+            pthread_mutex_unlock( &m_sessionMutex );
+            if( cookie != "" ) {
+                evhttp_add_header( httpRequest->req->output_headers, "cookie", cookie.c_str() );
             }
             
             // Set the request type to GET by default
@@ -2272,12 +3075,17 @@ namespace nsGlasslabSDK {
             // If postdata exists in this request, ensure it has the correct information
             if( postdata.length() > 0 ) {
                 postdata_buffer = evbuffer_new();
-                evbuffer_add_printf( postdata_buffer, "%s", postdata.c_str() );
+                evbuffer_add( postdata_buffer, postdata.data(), postdata.size() );
 
                 // add default contentType
                 if( contentType == NULL || strlen(contentType) == 0 ) {
                     evhttp_add_header( httpRequest->req->output_headers, "Content-type", "application/x-www-form-urlencoded" );
                 }
+
+                // add the encoding of a compressed body
+                if( contentEncoding != NULL ) {
+                    evhttp_add_header( httpRequest->req->output_headers, "Content-Encoding", contentEncoding );
+                }
                 
                 // add content length if post
                 char t[255];
@@ -2303,6 +3111,16 @@ namespace nsGlasslabSDK {
             evhttp_add_header( httpRequest->req->output_headers, "Accept", "*/*" );
             evhttp_add_header( httpRequest->req->output_headers, "Game-Secret", m_gameSecret.c_str() );
 
+            // Ask the server to answer 304 if the cached copy is still valid
+            if( revalidate ) {
+                if( cached.etag.length() > 0 ) {
+                    evhttp_add_header( httpRequest->req->output_headers, "If-None-Match", cached.etag.c_str() );
+                }
+                if( cached.lastModified.length() > 0 ) {
+                    evhttp_add_header( httpRequest->req->output_headers, "If-Modified-Since", cached.lastModified.c_str() );
+                }
+            }
+
 
             // Update the request type based on the parameter, if it exists
             if( strstr( requestType.c_str(), "NULL" ) ) {
@@ -2323,21 +3141,15 @@ namespace nsGlasslabSDK {
             
             // Print the results
 #ifdef VERBOSE
-            printf("Connection Request -\n\turl: %s\n\tmethod: %s\n\thost: %s\n\tport:%d\n\tpath: %s\n\tcookie: %s\n\tpostdata: %s\n", url.c_str(), requestMethod.c_str(), host, port, path.c_str(), m_cookie.c_str(), postdata.c_str());
+            printf("Connection Request -\n\turl: %s\n\tmethod: %s\n\thost: %s\n\tport:%d\n\tpath: %s\n\tcookie: %s\n\tpostdata: %s\n", url.c_str(), requestMethod.c_str(), host, port, path.c_str(), cookie.c_str(), postdata.c_str());
 #endif
 
-            // Dispatch the request
+            // Make the request, the caller dispatches the base
             evhttp_connection_set_timeout( httpRequest->conn, 10 );
-            evhttp_make_request( httpRequest->conn, httpRequest->req, requestCmd, path.c_str() );
-            event_base_dispatch( httpRequest->base );
-            
-#ifdef VERBOSE
-            printf("Connection Complete -\n\turl: %s\n\tmethod: %s\n\thost: %s\n\tport:%d\n\tpath: %s\n\tcookie: %s\n", url.c_str(), requestMethod.c_str(), host, port, path.c_str(), m_cookie.c_str());
-#endif
-            
-            // Free the connection
-            evhttp_connection_free(httpRequest->conn);
-            event_base_free(httpRequest->base);
+            if( evhttp_make_request( httpRequest->conn, httpRequest->req, requestCmd, path.c_str() ) == 0 ) {
+                ( *pending )++;
+                sent = true;
+            }
         }
         
         // Finished with the URI object, free it
@@ -2347,407 +3159,2463 @@ namespace nsGlasslabSDK {
         if( postdata_buffer != NULL ) {
             evbuffer_free( postdata_buffer );
         }
-    }
 
+        if( !sent ) {
+            mf_finishHttpRequest( httpRequest );
+            return NULL;
+        }
+        return httpRequest;
+    }
     /**
-     * Function cancels a request based on key.
+     * Function cancels every queued or in flight request for the callback key ("login_Done").
+     * Queued requests are dropped, in flight requests have their response ignored.
      */
     void Core::cancelRequest( const char* requestKey ) {
         //printf( "\n\t\t cancelling request: %s\n", requestKey );
-        setCoreCallbackCancelState( requestKey, true );
-    }
-
+        int coreCB = getCoreCallbackId( requestKey );
+        if( coreCB == Const::Callback_None ) {
+            return;
+        }
 
-    //--------------------------------------
-    //--------------------------------------
-    //--------------------------------------
-    /**
-     * Store all callback functions in a map so the SQLite database has a reference.
-     * TODO: include client callback functions
-     */
-    void Core::mf_setupCallbacks() {
-        coreCallbackStructure getConnect_Structure;
-        getConnect_Structure.coreCB = getConnect_Done;
-        getConnect_Structure.cancel = false;
-        getConnect_Structure.requestType = "GET";
-        m_coreCallbackMap[ "getConnect_Done" ] = getConnect_Structure;
-
-        coreCallbackStructure getConfig_Structure;
-        getConfig_Structure.coreCB = getConfig_Done;
-        getConfig_Structure.cancel = false;
-        getConfig_Structure.requestType = "GET";
-        m_coreCallbackMap[ "getConfig_Done" ] = getConfig_Structure;
-
-        coreCallbackStructure deviceUpdate_Structure;
-        deviceUpdate_Structure.coreCB = deviceUpdate_Done;
-        deviceUpdate_Structure.cancel = false;
-        deviceUpdate_Structure.requestType = "POST";
-        m_coreCallbackMap[ "deviceUpdate_Done" ] = deviceUpdate_Structure;
-
-        coreCallbackStructure authStatus_Structure;
-        authStatus_Structure.coreCB = authStatus_Done;
-        authStatus_Structure.cancel = false;
-        authStatus_Structure.requestType = "GET";
-        m_coreCallbackMap[ "authStatus_Done" ] = authStatus_Structure;
-
-        coreCallbackStructure register_Structure;
-        register_Structure.coreCB = register_Done;
-        register_Structure.cancel = false;
-        register_Structure.requestType = "POST";
-        m_coreCallbackMap[ "register_Done" ] = register_Structure;
-
-        coreCallbackStructure getPlayerInfo_Structure;
-        getPlayerInfo_Structure.coreCB = getPlayerInfo_Done;
-        getPlayerInfo_Structure.cancel = false;
-        getPlayerInfo_Structure.requestType = "GET";
-        m_coreCallbackMap[ "getPlayerInfo_Done" ] = getPlayerInfo_Structure;
-
-        coreCallbackStructure getUserInfo_Structure;
-        getUserInfo_Structure.coreCB = getUserInfo_Done;
-        getUserInfo_Structure.cancel = false;
-        getUserInfo_Structure.requestType = "GET";
-        m_coreCallbackMap[ "getUserInfo_Done" ] = getUserInfo_Structure;
-
-        coreCallbackStructure login_Structure;
-        login_Structure.coreCB = login_Done;
-        login_Structure.cancel = false;
-        login_Structure.requestType = "POST";
-        m_coreCallbackMap[ "login_Done" ] = login_Structure;
-
-        coreCallbackStructure logout_Structure;
-        logout_Structure.coreCB = logout_Done;
-        logout_Structure.cancel = false;
-        logout_Structure.requestType = "POST";
-        m_coreCallbackMap[ "logout_Done" ] = logout_Structure;
-
-        coreCallbackStructure enroll_Structure;
-        enroll_Structure.coreCB = enroll_Done;
-        enroll_Structure.cancel = false;
-        enroll_Structure.requestType = "POST";
-        m_coreCallbackMap[ "enroll_Done" ] = enroll_Structure;
-
-        coreCallbackStructure unenroll_Structure;
-        unenroll_Structure.coreCB = unenroll_Done;
-        unenroll_Structure.cancel = false;
-        unenroll_Structure.requestType = "POST";
-        m_coreCallbackMap[ "unenroll_Done" ] = unenroll_Structure;
-
-        coreCallbackStructure getCourses_Structure;
-        getCourses_Structure.coreCB = getCourses_Done;
-        getCourses_Structure.cancel = false;
-        getCourses_Structure.requestType = "GET";
-        m_coreCallbackMap[ "getCourses_Done" ] = getCourses_Structure;
-
-        coreCallbackStructure startPlaySession_Structure;
-        startPlaySession_Structure.coreCB = startPlaySession_Done;
-        startPlaySession_Structure.cancel = false;
-        startPlaySession_Structure.requestType = "GET";
-        m_coreCallbackMap[ "startPlaySession_Done" ] = startPlaySession_Structure;
-
-        coreCallbackStructure startSession_Structure;
-        startSession_Structure.coreCB = startSession_Done;
-        startSession_Structure.cancel = false;
-        startSession_Structure.requestType = "POST";
-        m_coreCallbackMap[ "startSession_Done" ] = startSession_Structure;
-
-        coreCallbackStructure endSession_Structure;
-        endSession_Structure.coreCB = endSession_Done;
-        endSession_Structure.cancel = false;
-        endSession_Structure.requestType = "POST";
-        m_coreCallbackMap[ "endSession_Done" ] = endSession_Structure;
-        
-        coreCallbackStructure saveGame_Structure;
-        saveGame_Structure.coreCB = saveGame_Done;
-        saveGame_Structure.cancel = false;
-        saveGame_Structure.requestType = "POST";
-        m_coreCallbackMap[ "saveGame_Done" ] = saveGame_Structure;
-
-        coreCallbackStructure getSaveGame_Structure;
-        getSaveGame_Structure.coreCB = getSaveGame_Done;
-        getSaveGame_Structure.cancel = false;
-        getSaveGame_Structure.requestType = "GET";
-        m_coreCallbackMap[ "getSaveGame_Done" ] = getSaveGame_Structure;
-
-        coreCallbackStructure deleteSaveGame_Structure;
-        deleteSaveGame_Structure.coreCB = deleteSaveGame_Done;
-        deleteSaveGame_Structure.cancel = false;
-        deleteSaveGame_Structure.requestType = "DELETE";
-        m_coreCallbackMap[ "deleteSaveGame_Done" ] = deleteSaveGame_Structure;
-
-        coreCallbackStructure saveAchievement_Structure;
-        saveAchievement_Structure.coreCB = saveAchievement_Done;
-        saveAchievement_Structure.cancel = false;
-        saveAchievement_Structure.requestType = "POST";
-        m_coreCallbackMap[ "saveAchievement_Done" ] = saveAchievement_Structure;
-
-        coreCallbackStructure savePlayerInfo_Structure;
-        savePlayerInfo_Structure.coreCB = savePlayerInfo_Done;
-        savePlayerInfo_Structure.cancel = false;
-        savePlayerInfo_Structure.requestType = "POST";
-        m_coreCallbackMap[ "savePlayerInfo_Done" ] = savePlayerInfo_Structure;
-
-        coreCallbackStructure sendTotalTimePlayed_Structure;
-        sendTotalTimePlayed_Structure.coreCB = sendTotalTimePlayed_Done;
-        sendTotalTimePlayed_Structure.cancel = false;
-        sendTotalTimePlayed_Structure.requestType = "POST";
-        m_coreCallbackMap[ "sendTotalTimePlayed_Done" ] = sendTotalTimePlayed_Structure;
-
-        coreCallbackStructure createMatch_Structure;
-        createMatch_Structure.coreCB = createMatch_Done;
-        createMatch_Structure.cancel = false;
-        createMatch_Structure.requestType = "POST";
-        m_coreCallbackMap[ "createMatch_Done" ] = createMatch_Structure;
-
-        coreCallbackStructure updateMatch_Structure;
-        updateMatch_Structure.coreCB = updateMatch_Done;
-        updateMatch_Structure.cancel = false;
-        updateMatch_Structure.requestType = "POST";
-        m_coreCallbackMap[ "updateMatch_Done" ] = updateMatch_Structure;
-
-        coreCallbackStructure pollMatches_Structure;
-        pollMatches_Structure.coreCB = pollMatches_Done;
-        pollMatches_Structure.cancel = false;
-        pollMatches_Structure.requestType = "GET";
-        m_coreCallbackMap[ "pollMatches_Done" ] = pollMatches_Structure;
-
-        coreCallbackStructure sendTelemEvent_Structure;
-        sendTelemEvent_Structure.coreCB = sendTelemEvent_Done;
-        sendTelemEvent_Structure.cancel = false;
-        sendTelemEvent_Structure.requestType = "POST";
-        m_coreCallbackMap[ "sendTelemEvent_Done" ] = sendTelemEvent_Structure;
-    }
-
-    /**
-     * Function returns a Core Callback function from the map using the key parameter.
-     */
-    CoreCallback_Func Core::getCoreCallback( string key ) {
-        // Callback function does not exist
-        if( m_coreCallbackMap.find( key ) == m_coreCallbackMap.end() ) {
-            return NULL;
+        pthread_mutex_lock( &m_jobQueueMutex );
+        pthread_mutex_lock( &m_requestMutex );
+        for( map<int, glRequestState>::iterator it = m_activeRequests.begin(); it != m_activeRequests.end(); ++it ) {
+            if( it->second.coreCB == coreCB ) {
+                it->second.cancelled = true;
+            }
         }
-        // Callback function exists
-        else {
-            return m_coreCallbackMap[ key ].coreCB;
+        for( std::deque<HTTPThreadData*>::iterator it = m_httpGetJobs.begin(); it != m_httpGetJobs.end(); ) {
+            if( (*it)->coreCB == coreCB ) {
+                mf_eraseRequest( (*it)->handle );
+                delete *it;
+                it = m_httpGetJobs.erase( it );
+            }
+            else {
+                ++it;
+            }
         }
+        pthread_mutex_unlock( &m_requestMutex );
+        pthread_mutex_unlock( &m_jobQueueMutex );
     }
+
     /**
-     * Function returns the cancel state of the Core Callback function requested.
+     * Function cancels the request with the handle returned by do_httpGetRequest(). Its callback
+     * will not run, and a queued request is removed before anything is sent once no attached
+     * request is still waiting on it.
+     * Returns false if the request already finished or the handle is unknown.
      */
-    bool Core::getCoreCallbackCancelState( string key ) {
-        // Callback function does not exist
-        if( m_coreCallbackMap.find( key ) == m_coreCallbackMap.end() ) {
-            return true;
-        }
-        // Callback function exists
-        else {
-            return m_coreCallbackMap[ key ].cancel;
+    bool Core::cancelRequestHandle( int handle ) {
+        pthread_mutex_lock( &m_jobQueueMutex );
+        pthread_mutex_lock( &m_requestMutex );
+
+        map<int, glRequestState>::iterator it = m_activeRequests.find( handle );
+        bool cancelled = it != m_activeRequests.end();
+        if( cancelled ) {
+            it->second.cancelled = true;
+
+            int leader = it->second.leader;
+            if( mf_requestCancelled( leader ) ) {
+                for( std::deque<HTTPThreadData*>::iterator job = m_httpGetJobs.begin(); job != m_httpGetJobs.end(); ++job ) {
+                    if( (*job)->handle == leader ) {
+                        mf_eraseRequest( leader );
+                        delete *job;
+                        m_httpGetJobs.erase( job );
+                        break;
+                    }
+                }
+            }
         }
+
+        pthread_mutex_unlock( &m_requestMutex );
+        pthread_mutex_unlock( &m_jobQueueMutex );
+
+        return cancelled;
     }
+
     /**
-     * Function sets the cancel state of a core callback function.
+     * Function sets how long responses for the callback key ("getUserInfo_Done") are served
+     * from the cache before they are revalidated. 0 always revalidates, a negative value
+     * stops caching the request. Only GET requests can be cached.
      */
-    void Core::setCoreCallbackCancelState( string key, bool state ) {
-        // Callback function does not exist
-        if( m_coreCallbackMap.find( key ) != m_coreCallbackMap.end() ) {
-            m_coreCallbackMap[ key ].cancel = state;
+    void Core::setResponseCacheTTL( const char* requestKey, int seconds ) {
+        int coreCB = getCoreCallbackId( requestKey );
+        if( coreCB == Const::Callback_None || strcmp( getCoreCallbackRequestType( coreCB ), "GET" ) != 0 ) {
+            displayWarning( "Core::setResponseCacheTTL()", "Only GET requests can be cached." );
+            return;
         }
+        m_responseCacheTTL[ coreCB ] = seconds < 0 ? -1 : seconds;
     }
+
     /**
-     * Function returns the request type of the Core Callback function requested.
+     * Function removes every cached response.
      */
-    const char* Core::getCoreCallbackRequestType( string key ) {
-        // Callback function does not exist
-        if( m_coreCallbackMap.find( key ) == m_coreCallbackMap.end() ) {
-            return "GET";
-        }
-        // Callback function exists
-        else {
-            return m_coreCallbackMap[ key ].requestType.c_str();
+    void Core::clearResponseCache() {
+        if( m_dataSync != NULL ) {
+            m_dataSync->clearResponseCache();
         }
     }
 
     /**
-     * Function returns the match for the match Id.
+     * Function updates the response cache from a response. A 304 Not Modified is replaced by
+     * the cached body, which is marked fresh again, and a 200 OK body is stored with its
+     * ETag and Last-Modified validators. Returns false for a 304 with no cached body, such
+     * as after clearResponseCache().
      */
-    const char* Core::getMatchForId( int matchId ) {
-        // Match does not exist
-        if( m_matchesMap.find( matchId ) == m_matchesMap.end() ) {
-            return "{ \"error\": \"match does not exist\" }";
+    bool Core::mf_cacheResponse( struct evhttp_request* req, const string& cacheKey, string& data ) {
+        if( m_dataSync == NULL ) {
+            return true;
         }
-        // Callback function exists
-        else {
-            return m_matchesMap[ matchId ];
+
+        if( req->response_code == HTTP_NOTMODIFIED ) {
+            glCachedResponse cached;
+            if( !m_dataSync->getCachedResponse( cacheKey, cached ) ) {
+                return false;
+            }
+            data = cached.body;
+            m_dataSync->touchCachedResponse( cacheKey );
+        }
+        else if( req->response_code == HTTP_OK ) {
+            const char* etag = evhttp_find_header( req->input_headers, "ETag" );
+            const char* lastModified = evhttp_find_header( req->input_headers, "Last-Modified" );
+            m_dataSync->storeCachedResponse( cacheKey, etag != NULL ? etag : "", lastModified != NULL ? lastModified : "", data );
         }
+        return true;
     }
 
-    void Core::setMatchForId( int id, const char* data ) {
-        m_matchesMap[ id ] = data;
+    /**
+     * Function returns the handle of the last request started by an API call.
+     */
+    int Core::getLastRequestHandle() {
+        pthread_mutex_lock( &m_requestMutex );
+        int handle = m_lastRequestHandle;
+        pthread_mutex_unlock( &m_requestMutex );
+        return handle;
     }
 
-
-    //--------------------------------------
-    //--------------------------------------
-    //--------------------------------------
     /**
-     * Function adds a new message to the SQLite message queue.
+     * Function parses an HTTP date ("Sun, 06 Nov 1994 08:49:37 GMT") into milliseconds
+     * since the epoch, or returns -1 if it is not one.
      */
-    void Core::mf_addMessageToDataQueue( string path, string requestType, string coreCB, string postdata, const char* contentType ) {
-        // Only proceed if the data sync object exists
-        if( m_dataSync != NULL ) {
-            m_dataSync->addToMsgQ( m_deviceId, path, requestType, coreCB, postdata, contentType );
+    static int64_t parseHttpDate( const char* date ) {
+        static const char* months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+        char month[ 4 ];
+        int day, year, hour, minute, second;
+        if( date == NULL || sscanf( date, "%*3s, %d %3s %d %d:%d:%d", &day, month, &year, &hour, &minute, &second ) != 6 ) {
+            return -1;
         }
-        else {
-            displayError( "Core::mf_addMessageToDataQueue()", "Tried to add a message to MSG_QUEUE but the sync object was NULL!" );
+        const char* found = strstr( months, month );
+        if( found == NULL || strlen( month ) != 3 || ( found - months ) % 3 != 0 ) {
+            return -1;
         }
+        int m = (int)( found - months ) / 3 + 1;
+
+        // Days since the epoch of the Gregorian date
+        int y = m <= 2 ? year - 1 : year;
+        int era = ( y >= 0 ? y : y - 399 ) / 400;
+        int yearOfEra = y - era * 400;
+        int dayOfYear = ( 153 * ( m > 2 ? m - 3 : m + 9 ) + 2 ) / 5 + day - 1;
+        int64_t days = (int64_t)era * 146097 + yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear - 719468;
+
+        return ( ( days * 24 + hour ) * 60 + minute ) * 60000LL + second * 1000LL;
     }
+
     /**
-     * Function updates the status of a single message in the SQLite message queue.
+     * Function updates the clock skew estimate from the Date header of a response. The
+     * header is truncated to the second and was written somewhere within the round trip,
+     * so the middle of that second is compared to the middle of the round trip and the
+     * samples are smoothed. Slow round trips are ignored.
      */
-    void Core::mf_updateMessageStatusInDataQueue( int rowId, string status ) {
-        // Only proceed if the data sync object exists
-        if( m_dataSync != NULL && rowId != -1 ) {
-            //printf( "Marking object at %i as %s\n", rowId, status.c_str() );
-            m_dataSync->updateMessageStatus( rowId, status );
+    void Core::mf_sampleClockSkew( struct evhttp_request* req, int64_t sentMicros ) {
+        int64_t serverMillis = parseHttpDate( evhttp_find_header( req->input_headers, "Date" ) );
+        if( serverMillis < 0 ) {
+            return;
         }
-    }
 
-    /**
-     * Function updates the totalTimePlayed for the user associated with the parameter devieceId 
-     * in the SQLite session table.
-     */
-    void Core::mf_updateTotalTimePlayedInSessionTable( float totalTimePlayed ) {
-        // Only proceed if the data sync object exists
-        if( m_dataSync != NULL ) {
-            m_dataSync->updatePlayerInfoFromDeviceId( m_deviceId, totalTimePlayed, m_gameSessionEventOrder );
+        int64_t roundTripMillis = ( getClock()->monotonicMicros() - sentMicros ) / 1000;
+        if( roundTripMillis < 0 || roundTripMillis > CLOCK_SKEW_MAX_RTT_MS ) {
+            return;
+        }
+        int64_t localMillis = getClock()->wallMillis() - roundTripMillis / 2;
+        int64_t sample = serverMillis + 500 - localMillis;
+
+        // A jump past the reset threshold means the device clock was changed, start over from it
+        int64_t estimate = m_clockSkewMs;
+        if( !m_clockSkewKnown || llabs( sample - estimate ) > CLOCK_SKEW_RESET_MS ) {
+            estimate = sample;
         }
         else {
-            displayError( "Core::mf_updateTotalTimePlayedInSessionTable()", "Tried to update the totalTimePlayed in the SESSION table but the sync object was NULL!" );
+            estimate += (int64_t)( ( sample - estimate ) * CLOCK_SKEW_SMOOTHING );
         }
+        m_clockSkewMs = estimate;
+        m_clockSkewKnown = true;
     }
 
-
-    //--------------------------------------
-    //--------------------------------------
-    //--------------------------------------
     /**
-     * Append telemetry functions for all possible data types.
-     * TODO: include bools
+     * Function returns the estimated server minus device clock in ms, add it to a device
+     * timestamp to get server time. It is 0 until the first response arrives.
      */
-    void Core::addTelemEventValue( const char* key, const char* value ) {
-        json_object_set_new( m_telemEventValues, key, json_string( value ) );
-    }
-    void Core::addTelemEventValue( const char* key, int8_t value ) {
-        json_object_set_new( m_telemEventValues, key, json_integer( value ) );
-    }
-    void Core::addTelemEventValue( const char* key, int16_t value ) {
-        json_object_set_new( m_telemEventValues, key, json_integer( value ) );
-    }
-    void Core::addTelemEventValue( const char* key, int32_t value ) {
-        json_object_set_new( m_telemEventValues, key, json_integer( value ) );
-    }
-    void Core::addTelemEventValue( const char* key, uint8_t value ) {
-        json_object_set_new( m_telemEventValues, key, json_integer( value ) );
-    }
-    void Core::addTelemEventValue( const char* key, uint16_t value ) {
-        json_object_set_new( m_telemEventValues, key, json_integer( value ) );
-    }
-    void Core::addTelemEventValue( const char* key, uint32_t value ) {
-        json_object_set_new( m_telemEventValues, key, json_integer( value ) );
-    }
-    void Core::addTelemEventValue( const char* key, float value ) {
-        json_object_set_new( m_telemEventValues, key, json_real( value ) );
-    }
-    void Core::addTelemEventValue( const char* key, double value ) {
-        json_object_set_new( m_telemEventValues, key, json_real( value ) );
-    }
-    void Core::addTelemEventValue( const char* key, bool value ) {
-        json_object_set_new( m_telemEventValues, key, json_boolean( value ) );
+    int Core::getClockSkew() {
+        return (int)m_clockSkewMs;
     }
 
     /**
-     * Function clears all telemetry events stored in the JSON object.
+     * Function returns true if the request and every request attached to it were cancelled.
      */
-    void Core::clearTelemEventValues() {
-        // Initialize events array
-        int ret = json_array_clear(m_telemEvents);
-        if( !m_telemEvents || ret == -1 ) {
-            displayError( "Core::clearTelemEventValues()", "There was an error intializing a new telemetry document after clearing the old one." );
-        }
+    bool Core::isRequestCancelled( int handle ) {
+        pthread_mutex_lock( &m_requestMutex );
+        bool cancelled = mf_requestCancelled( handle );
+        pthread_mutex_unlock( &m_requestMutex );
+        return cancelled;
     }
 
     /**
-     * Functions saves a telemetry event by name with all default parameters,
-     * including a timestamp, name, gameId, gameSessionId, deviceId, 
-     * clientVersion, gameLevel, and the data itself.
+     * Function runs the core callback once for the request and once for each request attached
+     * to it, skipping the cancelled ones. Requests made after this point start a new round trip.
      */
-    void Core::saveTelemEvent( const char* name ) {
-        // Create the JSON event object to populate
-        json_t* event = json_object();
-        if( event ) {
-            // Time this event occurred
-            time_t t = time(NULL);
-
-            // Increment the session timer if it is active
-            if( m_autoSessionManagement && m_sessionTimerActive ) {
-                // Measure the time between last session time and current (in seconds)
-                float delta = difftime( t, m_sessionTimerLast );
-                m_sessionTimerLast = t;
-
-                // If the time since last event is greater than the SESSION_TIMEOUT, start a new play session
-                if( delta >= SESSION_TIMEOUT ) {
-                    startPlaySession();
-                }
-            }
-
-            // Set default information
-            json_object_set_new( event, "clientTimeStamp", json_integer( (int)t ) );
-            json_object_set_new( event, "eventName", json_string( name ) );
-            json_object_set_new( event, "gameId",  json_string( m_gameId.c_str() ) );
-            json_object_set_new( event, "gameSessionId", json_string( "$gameSessionId$" ) );
-            json_object_set_new( event, "playSessionId", json_string( m_playSessionId.c_str() ) );
-            json_object_set_new( event, "gameSessionEventOrder", json_integer( m_gameSessionEventOrder++ ) );
-            json_object_set_new( event, "playSessionEventOrder", json_integer( m_playSessionEventOrder++ ) );
+    void Core::mf_runCoreCallback( int handle, int coreCB, p_glSDKInfo& sdkInfo ) {
+        CoreCallback_Func callback = getCoreCallback( coreCB );
+        if( callback == NULL ) {
+            return;
+        }
 
-            // Set the deviceId if it exists
-            if( m_deviceId.length() > 0 ) {
-                json_object_set_new( event, "deviceId", json_string( m_deviceId.c_str() ) );
-            }
-            // Set the clientVersion if it exists
-            if( m_clientVersion.length() > 0 ) {
-                json_object_set_new( event, "clientVersion", json_string( m_clientVersion.c_str() ) );
+        int waiters = 0;
+        pthread_mutex_lock( &m_requestMutex );
+        map<int, glRequestState>::iterator it = m_activeRequests.find( handle );
+        if( it != m_activeRequests.end() ) {
+            map<string, int>::iterator flight = m_singleFlights.find( it->second.flightKey );
+            if( flight != m_singleFlights.end() && flight->second == handle ) {
+                m_singleFlights.erase( flight );
             }
-            // Set the gameLevel if it exists
-            if( m_gameLevel.length() > 0 ) {
-                json_object_set_new( event, "gameLevel", json_string( m_gameLevel.c_str() ) );
+
+            waiters = it->second.cancelled ? 0 : 1;
+            for( size_t i = 0; i < it->second.followers.size(); i++ ) {
+                map<int, glRequestState>::iterator follower = m_activeRequests.find( it->second.followers[ i ] );
+                if( follower != m_activeRequests.end() && !follower->second.cancelled ) {
+                    waiters++;
+                }
             }
-            // Set the eventData as a separate JSON document using the values
-            json_object_set_new( event, "eventData", m_telemEventValues );
+        }
+        pthread_mutex_unlock( &m_requestMutex );
 
-            // Get the total time played from the player info and set it (-1 indicates an error or it doesn't exist)
-            float totalTimePlay = getTotalTimePlayed();
-            json_object_set_new( event, "totalTimePlayed", json_real( totalTimePlay ) );
-            
-            // Append the final event structure to the telemetry events JSON object
-            json_array_append_new( m_telemEvents, event );
-            
-            //string jsonOut = "";
-            //char* rootJSON = json_dumps( event, JSON_SORT_KEYS );//JSON_ENCODE_ANY | JSON_INDENT(3) | JSON_SORT_KEYS );
-            //jsonOut = rootJSON;
-            //free( rootJSON );            
-            //printf( "\n---------------------------\n" );
-            //printf( "saveTelemEvent: \n%s", jsonOut.c_str() );
-            //printf( "\n---------------------------\n" );
-            
-            // Reset all memebers in event object
-            m_telemEventValues  = json_object();
+        if( waiters == 0 ) {
+            logMessage( "\n\t\t request ignored because it was cancelled" );
         }
-        // If the JSON object wasn't created properly, we have an error
-        else {
-            displayError( "Core::saveTelemEvent()", "Could not create a new event document, unable to send event." );
+        for( int i = 0; i < waiters; i++ ) {
+            callback( sdkInfo );
         }
     }
 
-
+    /**
+     * Function hands out a request handle. With a flight key, the request is attached to the
+     * identical request that is queued or in flight if there is one, unless newFlight is set,
+     * then later identical requests are attached to this one.
+     */
+    int Core::mf_newRequestHandle( int coreCB, const string& flightKey, bool apiCall, bool& attached, bool newFlight ) {
+        pthread_mutex_lock( &m_requestMutex );
+        int handle = m_nextRequestHandle++;
+        if( apiCall ) {
+            m_lastRequestHandle = handle;
+        }
+
+        glRequestState state;
+        state.coreCB = coreCB;
+        state.cancelled = false;
+        state.leader = handle;
+        state.flightKey = flightKey;
+
+        attached = false;
+        if( flightKey.length() > 0 ) {
+            map<string, int>::iterator flight = m_singleFlights.find( flightKey );
+            if( flight != m_singleFlights.end() && !newFlight ) {
+                state.leader = flight->second;
+                m_activeRequests[ flight->second ].followers.push_back( handle );
+                attached = true;
+            }
+            else {
+                m_singleFlights[ flightKey ] = handle;
+            }
+        }
+        m_activeRequests[ handle ] = state;
+
+        pthread_mutex_unlock( &m_requestMutex );
+        return handle;
+    }
+
+    /**
+     * Function returns true if a request other than a GET is queued behind the request
+     * sharing the flight key, or anywhere in the queue when that request is being sent.
+     * Called with m_jobQueueMutex held.
+     */
+    bool Core::mf_mutationQueuedAfter( const string& flightKey ) {
+#ifdef MULTITHREADED
+        pthread_mutex_lock( &m_requestMutex );
+        map<string, int>::iterator flight = m_singleFlights.find( flightKey );
+        int leader = flight != m_singleFlights.end() ? flight->second : -1;
+        pthread_mutex_unlock( &m_requestMutex );
+        if( leader == -1 ) {
+            return false;
+        }
+
+        // Start behind the leader if it is still queued
+        std::deque<HTTPThreadData*>::iterator it = m_httpGetJobs.begin();
+        for( std::deque<HTTPThreadData*>::iterator job = m_httpGetJobs.begin(); job != m_httpGetJobs.end(); ++job ) {
+            if( (*job)->handle == leader ) {
+                it = job + 1;
+                break;
+            }
+        }
+        for( ; it != m_httpGetJobs.end(); ++it ) {
+            if( (*it)->requestType != "GET" ) {
+                return true;
+            }
+        }
+        return false;
+#else
+        (void)flightKey;
+        return false;
+#endif
+    }
+
+    /**
+     * Function forgets a finished request and the requests attached to it.
+     */
+    void Core::mf_endRequest( int handle ) {
+        pthread_mutex_lock( &m_requestMutex );
+        mf_eraseRequest( handle );
+        pthread_mutex_unlock( &m_requestMutex );
+    }
+
+    /**
+     * Helpers for the request tracking above, m_requestMutex must be held.
+     */
+    bool Core::mf_requestCancelled( int leader ) {
+        map<int, glRequestState>::iterator it = m_activeRequests.find( leader );
+        if( it == m_activeRequests.end() ) {
+            return false;
+        }
+        if( !it->second.cancelled ) {
+            return false;
+        }
+        for( size_t i = 0; i < it->second.followers.size(); i++ ) {
+            map<int, glRequestState>::iterator follower = m_activeRequests.find( it->second.followers[ i ] );
+            if( follower != m_activeRequests.end() && !follower->second.cancelled ) {
+                return false;
+            }
+        }
+        return true;
+    }
+    void Core::mf_eraseRequest( int leader ) {
+        map<int, glRequestState>::iterator it = m_activeRequests.find( leader );
+        if( it == m_activeRequests.end() ) {
+            return;
+        }
+        map<string, int>::iterator flight = m_singleFlights.find( it->second.flightKey );
+        if( flight != m_singleFlights.end() && flight->second == leader ) {
+            m_singleFlights.erase( flight );
+        }
+        for( size_t i = 0; i < it->second.followers.size(); i++ ) {
+            m_activeRequests.erase( it->second.followers[ i ] );
+        }
+        m_activeRequests.erase( it );
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * Core callback table, indexed by Const::CoreCallback. Requests and MSG_QUEUE
+     * rows refer to callbacks by id, the name is kept for cancelRequest() and rows
+     * queued by older SDK versions.
+     * TODO: include client callback functions
+     */
+    static const coreCallbackStructure s_coreCallbacks[ Const::Callback_Count ] = {
+        { "getConnect_Done",            getConnect_Done,            "GET" },
+        { "getConfig_Done",             getConfig_Done,             "GET" },
+        { "deviceUpdate_Done",          deviceUpdate_Done,          "POST" },
+        { "authStatus_Done",            authStatus_Done,            "GET" },
+        { "register_Done",              register_Done,              "POST" },
+        { "getPlayerInfo_Done",         getPlayerInfo_Done,         "GET" },
+        { "getUserInfo_Done",           getUserInfo_Done,           "GET" },
+        { "login_Done",                 login_Done,                 "POST" },
+        { "logout_Done",                logout_Done,                "POST" },
+        { "enroll_Done",                enroll_Done,                "POST" },
+        { "unenroll_Done",              unenroll_Done,              "POST" },
+        { "getCourses_Done",            getCourses_Done,            "GET" },
+        { "startPlaySession_Done",      startPlaySession_Done,      "GET" },
+        { "startSession_Done",          startSession_Done,          "POST" },
+        { "endSession_Done",            endSession_Done,            "POST" },
+        { "saveGame_Done",              saveGame_Done,              "POST" },
+        { "getSaveGame_Done",           getSaveGame_Done,           "GET" },
+        { "deleteSaveGame_Done",        deleteSaveGame_Done,        "DELETE" },
+        { "saveAchievement_Done",       saveAchievement_Done,       "POST" },
+        { "savePlayerInfo_Done",        savePlayerInfo_Done,        "POST" },
+        { "sendTotalTimePlayed_Done",   sendTotalTimePlayed_Done,   "POST" },
+        { "createMatch_Done",           createMatch_Done,           "POST" },
+        { "updateMatch_Done",           updateMatch_Done,           "POST" },
+        { "pollMatches_Done",           pollMatches_Done,           "GET" },
+        { "sendTelemEvent_Done",        sendTelemEvent_Done,        "POST" }
+    };
+
+    /**
+     * Function returns a Core Callback function from the table using the id parameter.
+     */
+    CoreCallback_Func Core::getCoreCallback( int id ) {
+        // Callback function does not exist
+        if( id < 0 || id >= Const::Callback_Count ) {
+            return NULL;
+        }
+        return s_coreCallbacks[ id ].coreCB;
+    }
+    /**
+     * Function returns the request type of the Core Callback function requested.
+     */
+    const char* Core::getCoreCallbackRequestType( int id ) {
+        // Callback function does not exist
+        if( id < 0 || id >= Const::Callback_Count ) {
+            return "GET";
+        }
+        return s_coreCallbacks[ id ].requestType;
+    }
+    /**
+     * Functions map between callback ids and names ("sendTelemEvent_Done").
+     */
+    int Core::getCoreCallbackId( const char* name ) {
+        if( name != NULL ) {
+            for( int i = 0; i < Const::Callback_Count; i++ ) {
+                if( strcmp( s_coreCallbacks[ i ].name, name ) == 0 ) {
+                    return i;
+                }
+            }
+        }
+        return Const::Callback_None;
+    }
+    const char* Core::getCoreCallbackName( int id ) {
+        if( id < 0 || id >= Const::Callback_Count ) {
+            return "";
+        }
+        return s_coreCallbacks[ id ].name;
+    }
+
+    /**
+     * Function returns the match for the match Id.
+     */
+    const char* Core::getMatchForId( int matchId ) {
+        // Match does not exist
+        if( m_matchesMap.find( matchId ) == m_matchesMap.end() ) {
+            return "{ \"error\": \"match does not exist\" }";
+        }
+        // Callback function exists
+        else {
+            return m_matchesMap[ matchId ];
+        }
+    }
+
+    void Core::setMatchForId( int id, const char* data ) {
+        m_matchesMap[ id ] = data;
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * Function adds a new message to the SQLite message queue.
+     */
+    void Core::mf_addMessageToDataQueue( string path, string requestType, int coreCB, const string& postdata, const char* contentType ) {
+        // Only proceed if the data sync object exists
+        if( m_dataSync != NULL ) {
+            m_dataSync->addToMsgQ( m_deviceId, path, requestType, coreCB, postdata, contentType );
+        }
+        else {
+            displayError( "Core::mf_addMessageToDataQueue()", "Tried to add a message to MSG_QUEUE but the sync object was NULL!" );
+        }
+    }
+    /**
+     * Function updates the status of a single message in the SQLite message queue.
+     */
+    void Core::mf_updateMessageStatusInDataQueue( int rowId, string status ) {
+        // Only proceed if the data sync object exists
+        if( m_dataSync != NULL && rowId != -1 ) {
+            //printf( "Marking object at %i as %s\n", rowId, status.c_str() );
+            m_dataSync->updateMessageStatus( rowId, status );
+        }
+    }
+
+    /**
+     * Functions report what the message queue overflow policy removed: rows and
+     * bytes evicted to make room, and new rows that were dropped.
+     */
+    int Core::getMessageQueueEvictedCount() {
+        return m_dataSync != NULL ? m_dataSync->getEvictedMessageCount() : 0;
+    }
+    int Core::getMessageQueueEvictedBytes() {
+        return m_dataSync != NULL ? m_dataSync->getEvictedMessageBytes() : 0;
+    }
+    int Core::getMessageQueueDroppedCount() {
+        return m_dataSync != NULL ? m_dataSync->getDroppedMessageCount() : 0;
+    }
+
+    /**
+     * Function returns the message queue storage backend (Const::QueueStore).
+     */
+    int Core::getMessageStore() {
+        return m_dataSync != NULL ? m_dataSync->getMessageStore() : Const::QueueStore_SQLite;
+    }
+
+    /**
+     * Function updates the totalTimePlayed for the user associated with the parameter devieceId 
+     * in the SQLite session table.
+     */
+    void Core::mf_updateTotalTimePlayedInSessionTable( float totalTimePlayed ) {
+        // Only proceed if the data sync object exists
+        if( m_dataSync != NULL ) {
+            mf_updatePlayerInfo( totalTimePlayed );
+        }
+        else {
+            displayError( "Core::mf_updateTotalTimePlayedInSessionTable()", "Tried to update the totalTimePlayed in the SESSION table but the sync object was NULL!" );
+        }
+    }
+
+    /**
+     * Function updates the totalTimePlayed and event order of the current device's
+     * session, in memory and in the SESSION table. Only existing sessions are updated.
+     */
+    void Core::mf_updatePlayerInfo( float totalTimePlayed ) {
+        pthread_mutex_lock( &m_sessionMutex );
+        map<string, glSession>::iterator session = m_sessions.find( m_deviceId );
+        if( session != m_sessions.end() ) {
+            session->second.totalTimePlayed = totalTimePlayed;
+            session->second.gameSessionEventOrder = m_gameSessionEventOrder;
+        }
+        pthread_mutex_unlock( &m_sessionMutex );
+
+        // The stored totals are added to these once they are read, until then they are not written
+        if( m_sessionsLoaded ) {
+            m_dataSync->updatePlayerInfoFromDeviceId( m_deviceId, totalTimePlayed, m_gameSessionEventOrder );
+        }
+    }
+
+    /**
+     * Function returns the session of a device, adding a new one the way the SESSION
+     * table does. Called with m_sessionMutex held.
+     */
+    glSession& Core::mf_session( const string& deviceId ) {
+        map<string, glSession>::iterator it = m_sessions.find( deviceId );
+        if( it == m_sessions.end() ) {
+            glSession session;
+            session.cookie = "";
+            session.gameSessionId = "";
+            session.gameSessionEventOrder = 1;
+            session.totalTimePlayed = 0;
+            session.fields = 0;
+            it = m_sessions.insert( make_pair( deviceId, session ) ).first;
+        }
+        return it->second;
+    }
+
+    /**
+     * Function copies the session of a device. Returns false if there is none, any
+     * thread may call it.
+     */
+    bool Core::mf_getSession( string deviceId, glSession& session ) {
+        pthread_mutex_lock( &m_sessionMutex );
+        map<string, glSession>::iterator it = m_sessions.find( deviceId );
+        bool found = it != m_sessions.end();
+        if( found ) {
+            session = it->second;
+        }
+        pthread_mutex_unlock( &m_sessionMutex );
+        return found;
+    }
+
+    /**
+     * Function adds the sessions read from the SESSION table, the ones already in
+     * memory are newer and kept.
+     */
+    void Core::mf_mergeSessions( const map<string, glSession>& sessions ) {
+        pthread_mutex_lock( &m_sessionMutex );
+        m_sessions.insert( sessions.begin(), sessions.end() );
+        pthread_mutex_unlock( &m_sessionMutex );
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * RequestWriter constructor. The buffer is kept between requests so building
+     * a body only allocates while it grows past the largest one seen.
+     */
+    RequestWriter::RequestWriter() {
+        m_buffer.reserve( 256 );
+        m_json  = false;
+        m_first = true;
+    }
+
+    /**
+     * Functions start a new body, either a JSON object or a form-urlencoded list.
+     */
+    void RequestWriter::beginJSON() {
+        m_buffer.clear();
+        m_buffer += '{';
+        m_json  = true;
+        m_first = true;
+    }
+    void RequestWriter::beginForm() {
+        m_buffer.clear();
+        m_json  = false;
+        m_first = true;
+    }
+
+    /**
+     * Functions append a key/value pair. Strings are escaped for the body type,
+     * addRaw writes the value untouched (used for placeholders and prebuilt JSON).
+     */
+    void RequestWriter::addString( const char* key, const char* value ) {
+        mf_writeKey( key );
+        if( m_json ) {
+            m_buffer += '"';
+            mf_writeEscaped( value != NULL ? value : "" );
+            m_buffer += '"';
+        }
+        else {
+            mf_writeEscaped( value != NULL ? value : "" );
+        }
+    }
+    void RequestWriter::addInteger( const char* key, int64_t value ) {
+        char t[ 24 ];
+        sprintf( t, "%lld", (long long)value );
+        mf_writeKey( key );
+        m_buffer += t;
+    }
+    void RequestWriter::addReal( const char* key, double value, int decimals ) {
+        char t[ 64 ];
+        snprintf( t, sizeof( t ), "%.*f", decimals, value );
+        mf_writeKey( key );
+        m_buffer += t;
+    }
+    void RequestWriter::addBoolean( const char* key, bool value ) {
+        mf_writeKey( key );
+        m_buffer += value ? "true" : "false";
+    }
+    void RequestWriter::addRaw( const char* key, const char* value ) {
+        mf_writeKey( key );
+        m_buffer += value;
+    }
+
+    /**
+     * Function closes the body and returns it. The reference is valid until the next begin.
+     */
+    const string& RequestWriter::finish() {
+        if( m_json ) {
+            m_buffer += '}';
+        }
+        return m_buffer;
+    }
+
+    /**
+     * Function writes the separator and the key.
+     */
+    void RequestWriter::mf_writeKey( const char* key ) {
+        if( !m_first ) {
+            m_buffer += m_json ? ',' : '&';
+        }
+        m_first = false;
+
+        if( m_json ) {
+            m_buffer += '"';
+            mf_writeEscaped( key );
+            m_buffer += "\":";
+        }
+        else {
+            mf_writeEscaped( key );
+            m_buffer += '=';
+        }
+    }
+
+    /**
+     * Function escapes a string for a JSON string literal or form-urlencoding.
+     */
+    void RequestWriter::mf_writeEscaped( const char* value ) {
+        static const char* hex = "0123456789ABCDEF";
+
+        for( const unsigned char* c = (const unsigned char*)value; *c != 0; c++ ) {
+            if( m_json ) {
+                switch( *c ) {
+                    case '"':  m_buffer += "\\\""; break;
+                    case '\\': m_buffer += "\\\\"; break;
+                    case '\b': m_buffer += "\\b"; break;
+                    case '\f': m_buffer += "\\f"; break;
+                    case '\n': m_buffer += "\\n"; break;
+                    case '\r': m_buffer += "\\r"; break;
+                    case '\t': m_buffer += "\\t"; break;
+                    default:
+                        if( *c < 0x20 ) {
+                            m_buffer += "\\u00";
+                            m_buffer += hex[ *c >> 4 ];
+                            m_buffer += hex[ *c & 0xF ];
+                        }
+                        else {
+                            m_buffer += (char)*c;
+                        }
+                        break;
+                }
+            }
+            else {
+                if( isalnum( *c ) || *c == '-' || *c == '_' || *c == '.' || *c == '~' ) {
+                    m_buffer += (char)*c;
+                }
+                else if( *c == ' ' ) {
+                    m_buffer += '+';
+                }
+                else {
+                    m_buffer += '%';
+                    m_buffer += hex[ *c >> 4 ];
+                    m_buffer += hex[ *c & 0xF ];
+                }
+            }
+        }
+    }
+
+    /**
+     * Function returns the request writer for the calling thread, request builders
+     * also run from callbacks on the HTTP thread.
+     */
+    RequestWriter& Core::mf_getRequestWriter() {
+        RequestWriter* writer = (RequestWriter*)pthread_getspecific( m_requestWriterKey );
+        if( writer == NULL ) {
+            writer = new RequestWriter();
+            pthread_setspecific( m_requestWriterKey, writer );
+        }
+        return *writer;
+    }
+
+    /**
+     * Thread exit handler for the request writer key.
+     */
+    void Core::mf_releaseRequestWriter( void* writer ) {
+        delete static_cast<RequestWriter*>( writer );
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * TelemetrySymbols constructor. The table is allocated at full size so that
+     * readers never observe it being reallocated.
+     */
+    TelemetrySymbols::TelemetrySymbols() {
+        pthread_mutex_init( &m_mutex, NULL );
+        m_symbols = new char*[ TELEM_MAX_SYMBOLS_DEFAULT ];
+        m_count = 0;
+    }
+
+    TelemetrySymbols::~TelemetrySymbols() {
+        for( int i = 0; i < m_count; i++ ) {
+            free( m_symbols[ i ] );
+        }
+        delete[] m_symbols;
+        pthread_mutex_destroy( &m_mutex );
+    }
+
+    /**
+     * Function interns a key or event name and returns its handle. Registering
+     * the same string again returns the existing handle.
+     */
+    int TelemetrySymbols::registerSymbol( const char* symbol ) {
+        if( symbol == NULL || strlen( symbol ) == 0 ) {
+            return -1;
+        }
+
+        int handle = -1;
+        pthread_mutex_lock( &m_mutex );
+        map<string, int>::iterator it = m_handles.find( symbol );
+        if( it != m_handles.end() ) {
+            handle = it->second;
+        }
+        else if( m_count < TELEM_MAX_SYMBOLS_DEFAULT ) {
+            // The slot is filled before the count is published to readers
+            handle = m_count;
+            m_symbols[ handle ] = strdup( symbol );
+            m_handles[ symbol ] = handle;
+            m_count = handle + 1;
+        }
+        pthread_mutex_unlock( &m_mutex );
+        return handle;
+    }
+
+    /**
+     * Function indicates if the handle was returned by registerSymbol.
+     */
+    bool TelemetrySymbols::isSymbol( int handle ) const {
+        return handle >= 0 && handle < m_count;
+    }
+
+    /**
+     * Function returns the string for a symbol handle.
+     */
+    const char* TelemetrySymbols::getSymbol( int handle ) const {
+        return isSymbol( handle ) ? m_symbols[ handle ] : "";
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * TelemetryBuffer constructor. Storage is reserved separately with reserve().
+     */
+    TelemetryBuffer::TelemetryBuffer() {
+        m_symbols       = NULL;
+        m_pendingValues = 0;
+        m_pendingArena  = 0;
+    }
+
+    /**
+     * Function reserves the arena and record storage so that capture does not
+     * allocate until these sizes are exceeded.
+     */
+    void TelemetryBuffer::reserve( size_t arenaBytes, size_t maxValues, size_t maxEvents ) {
+        m_arena.reserve( arenaBytes );
+        m_values.reserve( maxValues );
+        m_events.reserve( maxEvents );
+        m_contexts.reserve( 16 );
+    }
+
+    /**
+     * Function gives back storage that grew past the given reserve, once the
+     * buffer holds no events or values.
+     */
+    void TelemetryBuffer::trim( size_t arenaBytes, size_t maxValues, size_t maxEvents ) {
+        if( !m_arena.empty() || !m_values.empty() || !m_events.empty() ) {
+            return;
+        }
+        if( m_arena.capacity() > arenaBytes || m_values.capacity() > maxValues || m_events.capacity() > maxEvents ) {
+            vector<char>().swap( m_arena );
+            vector<glTelemValue>().swap( m_values );
+            vector<glTelemEvent>().swap( m_events );
+            vector<glTelemContext>().swap( m_contexts );
+            reserve( arenaBytes, maxValues, maxEvents );
+        }
+    }
+
+    /**
+     * Function sets the symbol table used to resolve key and event name handles.
+     */
+    void TelemetryBuffer::setSymbols( const TelemetrySymbols* symbols ) {
+        m_symbols = symbols;
+    }
+
+    /**
+     * Functions record a typed value for the event under construction. Setting
+     * the same key twice replaces the previous value, as the JSON object did.
+     */
+    void TelemetryBuffer::addValue( const char* key, const char* value ) {
+        if( key == NULL || value == NULL ) {
+            return;
+        }
+        glTelemValue* record = mf_pendingValue( key );
+        record->type = TelemValue_String;
+        record->v.s = mf_storeString( value );
+    }
+    void TelemetryBuffer::addValue( const char* key, int64_t value ) {
+        if( key == NULL ) {
+            return;
+        }
+        glTelemValue* record = mf_pendingValue( key );
+        record->type = TelemValue_Integer;
+        record->v.i = value;
+    }
+    void TelemetryBuffer::addValue( const char* key, double value ) {
+        if( key == NULL ) {
+            return;
+        }
+        glTelemValue* record = mf_pendingValue( key );
+        record->type = TelemValue_Real;
+        record->v.r = value;
+    }
+    void TelemetryBuffer::addValue( const char* key, bool value ) {
+        if( key == NULL ) {
+            return;
+        }
+        glTelemValue* record = mf_pendingValue( key );
+        record->type = TelemValue_Boolean;
+        record->v.b = value;
+    }
+
+    /**
+     * Handle variants of addValue. The key is stored as a symbol reference, so
+     * only the value itself is copied.
+     */
+    void TelemetryBuffer::addValue( int keyHandle, const char* value ) {
+        if( m_symbols == NULL || !m_symbols->isSymbol( keyHandle ) || value == NULL ) {
+            return;
+        }
+        glTelemValue* record = mf_pendingValue( keyHandle );
+        record->type = TelemValue_String;
+        record->v.s = mf_storeString( value );
+    }
+    void TelemetryBuffer::addValue( int keyHandle, int64_t value ) {
+        if( m_symbols == NULL || !m_symbols->isSymbol( keyHandle ) ) {
+            return;
+        }
+        glTelemValue* record = mf_pendingValue( keyHandle );
+        record->type = TelemValue_Integer;
+        record->v.i = value;
+    }
+    void TelemetryBuffer::addValue( int keyHandle, double value ) {
+        if( m_symbols == NULL || !m_symbols->isSymbol( keyHandle ) ) {
+            return;
+        }
+        glTelemValue* record = mf_pendingValue( keyHandle );
+        record->type = TelemValue_Real;
+        record->v.r = value;
+    }
+    void TelemetryBuffer::addValue( int keyHandle, bool value ) {
+        if( m_symbols == NULL || !m_symbols->isSymbol( keyHandle ) ) {
+            return;
+        }
+        glTelemValue* record = mf_pendingValue( keyHandle );
+        record->type = TelemValue_Boolean;
+        record->v.b = value;
+    }
+
+    /**
+     * Function records JSON text that is rendered as a nested value. Binary
+     * batches carry it as a string.
+     */
+    void TelemetryBuffer::addJSONValue( const char* key, const char* json ) {
+        if( key == NULL || json == NULL ) {
+            return;
+        }
+        glTelemValue* record = mf_pendingValue( key );
+        record->type = TelemValue_JSON;
+        record->v.s = mf_storeString( json );
+    }
+
+    /**
+     * Function drops all values recorded for the event under construction.
+     */
+    void TelemetryBuffer::discardValues() {
+        m_values.resize( m_pendingValues );
+        m_arena.resize( m_pendingArena );
+    }
+
+    /**
+     * Function closes the event under construction. The pending values become
+     * the eventData of the new event.
+     */
+    void TelemetryBuffer::commitEvent( const char* name, int64_t clientTimeMillis, int gameSessionEventOrder, int playSessionEventOrder, float totalTimePlayed,
+                                       const char* gameId, const char* playSessionId, const char* deviceId, const char* clientVersion, const char* gameLevel ) {
+        mf_commitEvent( mf_storeString( name != NULL ? name : "" ), clientTimeMillis, gameSessionEventOrder, playSessionEventOrder, totalTimePlayed,
+                        gameId, playSessionId, deviceId, clientVersion, gameLevel );
+    }
+    void TelemetryBuffer::commitEvent( int nameHandle, int64_t clientTimeMillis, int gameSessionEventOrder, int playSessionEventOrder, float totalTimePlayed,
+                                       const char* gameId, const char* playSessionId, const char* deviceId, const char* clientVersion, const char* gameLevel ) {
+        if( m_symbols == NULL || !m_symbols->isSymbol( nameHandle ) ) {
+            return;
+        }
+        mf_commitEvent( (uint32_t)nameHandle | TELEM_SYMBOL_FLAG, clientTimeMillis, gameSessionEventOrder, playSessionEventOrder, totalTimePlayed,
+                        gameId, playSessionId, deviceId, clientVersion, gameLevel );
+    }
+
+    /**
+     * Function records the event header for an already resolved name reference.
+     */
+    void TelemetryBuffer::mf_commitEvent( uint32_t name, int64_t clientTimeMillis, int gameSessionEventOrder, int playSessionEventOrder, float totalTimePlayed,
+                                          const char* gameId, const char* playSessionId, const char* deviceId, const char* clientVersion, const char* gameLevel ) {
+        glTelemEvent event;
+        event.name                  = name;
+        event.context               = mf_storeContext( gameId, playSessionId, deviceId, clientVersion, gameLevel );
+        event.clientTimeMillis      = clientTimeMillis;
+        event.gameSessionEventOrder = gameSessionEventOrder;
+        event.playSessionEventOrder = playSessionEventOrder;
+        event.totalTimePlayed       = totalTimePlayed;
+        event.firstValue            = (uint32_t)m_pendingValues;
+        event.numValues             = (uint32_t)( m_values.size() - m_pendingValues );
+        m_events.push_back( event );
+
+        // The next event starts after everything recorded so far
+        m_pendingValues = m_values.size();
+        m_pendingArena  = m_arena.size();
+    }
+
+    /**
+     * Function removes all committed events. Values already recorded for the event
+     * under construction are moved to the front of the storage and kept.
+     */
+    void TelemetryBuffer::clear() {
+        size_t pendingBytes = m_arena.size() - m_pendingArena;
+        size_t pendingCount = m_values.size() - m_pendingValues;
+
+        // Pending strings always live at the end of the arena, shift them down
+        if( pendingBytes > 0 && m_pendingArena > 0 ) {
+            memmove( &m_arena[ 0 ], &m_arena[ m_pendingArena ], pendingBytes );
+        }
+        for( size_t i = 0; i < pendingCount; i++ ) {
+            glTelemValue value = m_values[ m_pendingValues + i ];
+            if( ( value.key & TELEM_SYMBOL_FLAG ) == 0 ) {
+                value.key -= (uint32_t)m_pendingArena;
+            }
+            if( value.type == TelemValue_String || value.type == TelemValue_JSON ) {
+                value.v.s -= (uint32_t)m_pendingArena;
+            }
+            m_values[ i ] = value;
+        }
+
+        m_arena.resize( pendingBytes );
+        m_values.resize( pendingCount );
+        m_events.clear();
+        m_contexts.clear();
+        m_pendingValues = 0;
+        m_pendingArena  = 0;
+    }
+
+    /**
+     * Function copies the committed events of another buffer to the end of this
+     * one. Symbol references are kept as-is, so both buffers must share the same
+     * symbol table, and this buffer must not have an event under construction.
+     */
+    void TelemetryBuffer::append( const TelemetryBuffer& other ) {
+        for( size_t e = 0; e < other.m_events.size(); e++ ) {
+            glTelemEvent event = other.m_events[ e ];
+            const glTelemContext& context = other.m_contexts[ event.context ];
+
+            uint32_t firstValue = (uint32_t)m_values.size();
+            for( uint32_t v = event.firstValue; v < event.firstValue + event.numValues; v++ ) {
+                glTelemValue value = other.m_values[ v ];
+                value.key = mf_copyString( other, value.key );
+                if( value.type == TelemValue_String || value.type == TelemValue_JSON ) {
+                    value.v.s = mf_copyString( other, value.v.s );
+                }
+                m_values.push_back( value );
+            }
+
+            event.name       = mf_copyString( other, event.name );
+            event.context    = mf_storeContext( other.getString( context.gameId ), other.getString( context.playSessionId ), other.getString( context.deviceId ),
+                                                other.getString( context.clientVersion ), other.getString( context.gameLevel ) );
+            event.firstValue = firstValue;
+            m_events.push_back( event );
+        }
+
+        m_pendingValues = m_values.size();
+        m_pendingArena  = m_arena.size();
+    }
+
+    /**
+     * Function renders all committed events. The legacy format is an array of
+     * events that each carry their context fields. The envelope format stores
+     * the gameSessionId once and groups consecutive events sharing a context:
+     *   { "gameSessionId": ..., "groups": [ { gameId, playSessionId, ..., "events": [ ... ] } ] }
+     */
+    json_t* TelemetryBuffer::toJSON( int format ) const {
+        if( format == Const::TelemFormat_Envelope ) {
+            json_t* groups = json_array();
+            json_t* group = NULL;
+            json_t* groupEvents = NULL;
+            uint32_t groupContext = 0;
+
+            for( size_t e = 0; e < m_events.size(); e++ ) {
+                const glTelemEvent& event = m_events[ e ];
+
+                // Contexts are deduplicated as they are stored, so a new index means new field values
+                if( group == NULL || event.context != groupContext ) {
+                    group = json_object();
+                    mf_contextToJSON( m_contexts[ event.context ], group );
+                    groupEvents = json_array();
+                    json_object_set_new( group, "events", groupEvents );
+                    json_array_append_new( groups, group );
+                    groupContext = event.context;
+                }
+
+                json_array_append_new( groupEvents, mf_eventToJSON( event ) );
+            }
+
+            json_t* envelope = json_object();
+            json_object_set_new( envelope, "gameSessionId", json_string( "$gameSessionId$" ) );
+            json_object_set_new( envelope, "groups", groups );
+            return envelope;
+        }
+
+        json_t* events = json_array();
+        for( size_t e = 0; e < m_events.size(); e++ ) {
+            const glTelemEvent& event = m_events[ e ];
+
+            json_t* root = mf_eventToJSON( event );
+            json_object_set_new( root, "gameSessionId", json_string( "$gameSessionId$" ) );
+            mf_contextToJSON( m_contexts[ event.context ], root );
+            json_array_append_new( events, root );
+        }
+
+        return events;
+    }
+
+    /**
+     * Function renders the fields that vary per event, including its eventData.
+     */
+    json_t* TelemetryBuffer::mf_eventToJSON( const glTelemEvent& event ) const {
+        json_t* root = json_object();
+        json_object_set_new( root, "clientTimeStamp", json_integer( (json_int_t)( event.clientTimeMillis / 1000 ) ) );
+        json_object_set_new( root, "clientTimeStampMs", json_integer( (json_int_t)event.clientTimeMillis ) );
+        json_object_set_new( root, "eventName", json_string( getString( event.name ) ) );
+        json_object_set_new( root, "gameSessionEventOrder", json_integer( event.gameSessionEventOrder ) );
+        json_object_set_new( root, "playSessionEventOrder", json_integer( event.playSessionEventOrder ) );
+
+        // Set the eventData as a separate JSON document using the values
+        json_t* eventData = json_object();
+        for( uint32_t v = event.firstValue; v < event.firstValue + event.numValues; v++ ) {
+            const glTelemValue& value = m_values[ v ];
+            const char* key = getString( value.key );
+            switch( value.type ) {
+                case TelemValue_String:
+                    json_object_set_new( eventData, key, json_string( getString( value.v.s ) ) );
+                    break;
+                case TelemValue_Integer:
+                    json_object_set_new( eventData, key, json_integer( (json_int_t)value.v.i ) );
+                    break;
+                case TelemValue_Real:
+                    json_object_set_new( eventData, key, json_real( value.v.r ) );
+                    break;
+                case TelemValue_Boolean:
+                    json_object_set_new( eventData, key, json_boolean( value.v.b ) );
+                    break;
+                case TelemValue_JSON: {
+                    json_t* nested = json_loads( getString( value.v.s ), JSON_DECODE_ANY, NULL );
+                    json_object_set_new( eventData, key, nested != NULL ? nested : json_string( getString( value.v.s ) ) );
+                    break;
+                }
+            }
+        }
+        json_object_set_new( root, "eventData", eventData );
+        json_object_set_new( root, "totalTimePlayed", json_real( event.totalTimePlayed ) );
+
+        return root;
+    }
+
+    /**
+     * Function sets the context fields on the target object.
+     */
+    void TelemetryBuffer::mf_contextToJSON( const glTelemContext& context, json_t* target ) const {
+        json_object_set_new( target, "gameId", json_string( getString( context.gameId ) ) );
+        json_object_set_new( target, "playSessionId", json_string( getString( context.playSessionId ) ) );
+
+        // Optional fields are only included if they exist
+        if( strlen( getString( context.deviceId ) ) > 0 ) {
+            json_object_set_new( target, "deviceId", json_string( getString( context.deviceId ) ) );
+        }
+        if( strlen( getString( context.clientVersion ) ) > 0 ) {
+            json_object_set_new( target, "clientVersion", json_string( getString( context.clientVersion ) ) );
+        }
+        if( strlen( getString( context.gameLevel ) ) > 0 ) {
+            json_object_set_new( target, "gameLevel", json_string( getString( context.gameLevel ) ) );
+        }
+    }
+
+    /**
+     * Function returns the number of committed events.
+     */
+    size_t TelemetryBuffer::getEventCount() const {
+        return m_events.size();
+    }
+
+    /**
+     * Function returns the bytes used by the events and values held, reserved
+     * capacity that is not in use is not counted.
+     */
+    size_t TelemetryBuffer::getByteSize() const {
+        return m_arena.size() + m_values.size() * sizeof( glTelemValue ) +
+               m_events.size() * sizeof( glTelemEvent ) + m_contexts.size() * sizeof( glTelemContext );
+    }
+
+    /**
+     * Function returns the string for a reference, either an arena offset or
+     * a tagged symbol handle.
+     */
+    const char* TelemetryBuffer::getString( uint32_t ref ) const {
+        if( ref & TELEM_SYMBOL_FLAG ) {
+            return m_symbols != NULL ? m_symbols->getSymbol( (int)( ref & ~TELEM_SYMBOL_FLAG ) ) : "";
+        }
+        return &m_arena[ ref ];
+    }
+
+    /**
+     * Function returns the record for key in the event under construction,
+     * appending a new one if the key has not been set yet.
+     */
+    glTelemValue* TelemetryBuffer::mf_pendingValue( const char* key ) {
+        for( size_t i = m_pendingValues; i < m_values.size(); i++ ) {
+            if( strcmp( getString( m_values[ i ].key ), key ) == 0 ) {
+                return &m_values[ i ];
+            }
+        }
+
+        glTelemValue value;
+        value.key = mf_storeString( key );
+        value.type = TelemValue_Integer;
+        value.v.i = 0;
+        m_values.push_back( value );
+        return &m_values.back();
+    }
+    glTelemValue* TelemetryBuffer::mf_pendingValue( int keyHandle ) {
+        uint32_t ref = (uint32_t)keyHandle | TELEM_SYMBOL_FLAG;
+        for( size_t i = m_pendingValues; i < m_values.size(); i++ ) {
+            uint32_t key = m_values[ i ].key;
+            if( key == ref ) {
+                return &m_values[ i ];
+            }
+            // Distinct symbols are distinct strings, only plain keys need comparing
+            if( ( key & TELEM_SYMBOL_FLAG ) == 0 && strcmp( getString( key ), getString( ref ) ) == 0 ) {
+                return &m_values[ i ];
+            }
+        }
+
+        glTelemValue value;
+        value.key = ref;
+        value.type = TelemValue_Integer;
+        value.v.i = 0;
+        m_values.push_back( value );
+        return &m_values.back();
+    }
+
+    /**
+     * Function copies a null-terminated string into the arena and returns its offset.
+     */
+    uint32_t TelemetryBuffer::mf_storeString( const char* value ) {
+        size_t offset = m_arena.size();
+        size_t length = strlen( value ) + 1;
+        m_arena.insert( m_arena.end(), value, value + length );
+        return (uint32_t)offset;
+    }
+
+    /**
+     * Function copies a string reference from another buffer into this one.
+     */
+    uint32_t TelemetryBuffer::mf_copyString( const TelemetryBuffer& other, uint32_t ref ) {
+        if( ref & TELEM_SYMBOL_FLAG ) {
+            return ref;
+        }
+        return mf_storeString( other.getString( ref ) );
+    }
+
+    /**
+     * Function returns the index of the context matching the parameters, reusing
+     * the most recent one when nothing has changed since the last event.
+     */
+    uint32_t TelemetryBuffer::mf_storeContext( const char* gameId, const char* playSessionId, const char* deviceId, const char* clientVersion, const char* gameLevel ) {
+        if( !m_contexts.empty() ) {
+            const glTelemContext& last = m_contexts.back();
+            if( strcmp( getString( last.gameId ), gameId ) == 0 &&
+                strcmp( getString( last.playSessionId ), playSessionId ) == 0 &&
+                strcmp( getString( last.deviceId ), deviceId ) == 0 &&
+                strcmp( getString( last.clientVersion ), clientVersion ) == 0 &&
+                strcmp( getString( last.gameLevel ), gameLevel ) == 0 ) {
+                return (uint32_t)( m_contexts.size() - 1 );
+            }
+        }
+
+        glTelemContext context;
+        context.gameId          = mf_storeString( gameId );
+        context.playSessionId   = mf_storeString( playSessionId );
+        context.deviceId        = mf_storeString( deviceId );
+        context.clientVersion   = mf_storeString( clientVersion );
+        context.gameLevel       = mf_storeString( gameLevel );
+        m_contexts.push_back( context );
+        return (uint32_t)( m_contexts.size() - 1 );
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * Binary telemetry format (Const::TelemFormat_Binary). All integers are LEB128
+     * varints, signed ones zigzag encoded; floats are little-endian IEEE 754.
+     *
+     *   payload := "GLT2" string(gameSessionId) body
+     *   body    := sint                                   clockSkewMs when the batch was built, 0 if unknown
+     *              count string*                          dictionary of every string in the batch
+     *              count (ref ref ref ref ref)*           contexts: gameId, playSessionId, deviceId, clientVersion, gameLevel
+     *              count                                  number of events N, then one column per field:
+     *              ref[N] context, ref[N] name, sint[N] clientTimeStamp delta (milliseconds),
+     *              sint[N] gameSessionEventOrder delta, sint[N] playSessionEventOrder delta,
+     *              float32[N] totalTimePlayed, count[N] numValues
+     *              ref[V] key, byte[V] type, value[V]     V is the sum of numValues, values in event order
+     *   value   := ref (string) | sint (integer) | float64 (real) | byte (boolean)
+     *   string  := count bytes
+     *
+     * "GLT1" payloads have no clockSkewMs and the clientTimeStamp column in seconds.
+     *
+     * The body is produced by encodeBinary and stored base64 encoded in the message
+     * queue, behind a 0 byte and the format version (a GLT1 body starts with its
+     * dictionary size, never 0). The gameSessionId is only known at flush time,
+     * where wrapBinary adds the header. decodeBinary is the reference reader.
+     */
+    void TelemetryBuffer::encodeBinary( string& out, int64_t clockSkewMs ) const {
+        map<string, uint32_t> dictionary;
+        vector<const char*> strings;
+        string columns;
+
+        // Contexts reference the dictionary
+        string contexts;
+        mf_writeVarint( contexts, m_contexts.size() );
+        for( size_t c = 0; c < m_contexts.size(); c++ ) {
+            const glTelemContext& context = m_contexts[ c ];
+            mf_writeVarint( contexts, mf_dictionaryRef( getString( context.gameId ), dictionary, strings ) );
+            mf_writeVarint( contexts, mf_dictionaryRef( getString( context.playSessionId ), dictionary, strings ) );
+            mf_writeVarint( contexts, mf_dictionaryRef( getString( context.deviceId ), dictionary, strings ) );
+            mf_writeVarint( contexts, mf_dictionaryRef( getString( context.clientVersion ), dictionary, strings ) );
+            mf_writeVarint( contexts, mf_dictionaryRef( getString( context.gameLevel ), dictionary, strings ) );
+        }
+
+        // Event columns, numeric fields are delta encoded against the previous event
+        mf_writeVarint( columns, m_events.size() );
+        for( size_t e = 0; e < m_events.size(); e++ ) {
+            mf_writeVarint( columns, m_events[ e ].context );
+        }
+        for( size_t e = 0; e < m_events.size(); e++ ) {
+            mf_writeVarint( columns, mf_dictionaryRef( getString( m_events[ e ].name ), dictionary, strings ) );
+        }
+        int64_t previous = 0;
+        for( size_t e = 0; e < m_events.size(); e++ ) {
+            mf_writeSignedVarint( columns, m_events[ e ].clientTimeMillis - previous );
+            previous = m_events[ e ].clientTimeMillis;
+        }
+        previous = 0;
+        for( size_t e = 0; e < m_events.size(); e++ ) {
+            mf_writeSignedVarint( columns, m_events[ e ].gameSessionEventOrder - previous );
+            previous = m_events[ e ].gameSessionEventOrder;
+        }
+        previous = 0;
+        for( size_t e = 0; e < m_events.size(); e++ ) {
+            mf_writeSignedVarint( columns, m_events[ e ].playSessionEventOrder - previous );
+            previous = m_events[ e ].playSessionEventOrder;
+        }
+        for( size_t e = 0; e < m_events.size(); e++ ) {
+            uint32_t bits;
+            memcpy( &bits, &m_events[ e ].totalTimePlayed, sizeof( bits ) );
+            mf_writeFixed( columns, bits, 4 );
+        }
+        for( size_t e = 0; e < m_events.size(); e++ ) {
+            mf_writeVarint( columns, m_events[ e ].numValues );
+        }
+
+        // Value columns for every committed event
+        size_t valueCount = 0;
+        if( !m_events.empty() ) {
+            valueCount = m_events.back().firstValue + m_events.back().numValues;
+        }
+        for( size_t v = 0; v < valueCount; v++ ) {
+            mf_writeVarint( columns, mf_dictionaryRef( getString( m_values[ v ].key ), dictionary, strings ) );
+        }
+        for( size_t v = 0; v < valueCount; v++ ) {
+            columns += (char)( m_values[ v ].type == TelemValue_JSON ? TelemValue_String : m_values[ v ].type );
+        }
+        for( size_t v = 0; v < valueCount; v++ ) {
+            const glTelemValue& value = m_values[ v ];
+            switch( value.type ) {
+                case TelemValue_String:
+                case TelemValue_JSON:
+                    mf_writeVarint( columns, mf_dictionaryRef( getString( value.v.s ), dictionary, strings ) );
+                    break;
+                case TelemValue_Integer:
+                    mf_writeSignedVarint( columns, value.v.i );
+                    break;
+                case TelemValue_Real: {
+                    uint64_t bits;
+                    memcpy( &bits, &value.v.r, sizeof( bits ) );
+                    mf_writeFixed( columns, bits, 8 );
+                    break;
+                }
+                case TelemValue_Boolean:
+                    columns += (char)( value.v.b ? 1 : 0 );
+                    break;
+            }
+        }
+
+        // Version marker for the queue, then the dictionary first so a reader can resolve references as it goes
+        out.clear();
+        out += (char)0;
+        out += (char)2;
+        mf_writeSignedVarint( out, clockSkewMs );
+        mf_writeVarint( out, strings.size() );
+        for( size_t i = 0; i < strings.size(); i++ ) {
+            size_t length = strlen( strings[ i ] );
+            mf_writeVarint( out, length );
+            out.append( strings[ i ], length );
+        }
+        out += contexts;
+        out += columns;
+    }
+
+    /**
+     * Function adds the binary payload header holding the gameSessionId. Bodies
+     * queued before the version marker existed are sent as GLT1.
+     */
+    string TelemetryBuffer::wrapBinary( const string& body, const string& gameSessionId ) {
+        bool marked = body.size() >= 2 && body[ 0 ] == 0;
+        string payload = marked ? TELEM_BINARY_MAGIC : TELEM_BINARY_MAGIC_V1;
+        mf_writeVarint( payload, gameSessionId.size() );
+        payload += gameSessionId;
+        payload.append( body, marked ? 2 : 0, string::npos );
+        return payload;
+    }
+
+    /**
+     * Reference reader for the binary format. Returns the events in the legacy
+     * JSON format (caller owns the reference), or NULL if the payload is malformed.
+     */
+    json_t* TelemetryBuffer::decodeBinary( const string& payload ) {
+        size_t magicLength = strlen( TELEM_BINARY_MAGIC );
+        if( payload.size() < magicLength ) {
+            return NULL;
+        }
+        bool secondsOnly = payload.compare( 0, magicLength, TELEM_BINARY_MAGIC_V1 ) == 0;
+        if( !secondsOnly && payload.compare( 0, magicLength, TELEM_BINARY_MAGIC ) != 0 ) {
+            return NULL;
+        }
+
+        size_t pos = magicLength;
+        bool ok = true;
+        string gameSessionId = mf_readString( payload, pos, ok );
+        int64_t clockSkewMs = secondsOnly ? 0 : mf_readSignedVarint( payload, pos, ok );
+
+        // Dictionary
+        vector<string> strings;
+        uint64_t count = mf_readVarint( payload, pos, ok );
+        for( uint64_t i = 0; ok && i < count; i++ ) {
+            strings.push_back( mf_readString( payload, pos, ok ) );
+        }
+
+        // Contexts
+        vector<uint64_t> contexts;
+        count = mf_readVarint( payload, pos, ok );
+        for( uint64_t i = 0; ok && i < count * 5; i++ ) {
+            uint64_t ref = mf_readVarint( payload, pos, ok );
+            ok = ok && ref < strings.size();
+            contexts.push_back( ref );
+        }
+
+        // Event columns
+        uint64_t numEvents = mf_readVarint( payload, pos, ok );
+        if( !ok || numEvents > payload.size() ) {
+            return NULL;
+        }
+        vector<uint64_t> context( numEvents ), name( numEvents ), numValues( numEvents );
+        vector<int64_t> clientTimeMillis( numEvents ), gameSessionEventOrder( numEvents ), playSessionEventOrder( numEvents );
+        vector<float> totalTimePlayed( numEvents );
+        for( uint64_t e = 0; ok && e < numEvents; e++ ) {
+            context[ e ] = mf_readVarint( payload, pos, ok );
+            ok = ok && context[ e ] * 5 < contexts.size();
+        }
+        for( uint64_t e = 0; ok && e < numEvents; e++ ) {
+            name[ e ] = mf_readVarint( payload, pos, ok );
+            ok = ok && name[ e ] < strings.size();
+        }
+        for( uint64_t e = 0; ok && e < numEvents; e++ ) {
+            clientTimeMillis[ e ] = mf_readSignedVarint( payload, pos, ok ) + ( e > 0 ? clientTimeMillis[ e - 1 ] : 0 );
+        }
+        if( secondsOnly ) {
+            for( uint64_t e = 0; e < numEvents; e++ ) {
+                clientTimeMillis[ e ] *= 1000;
+            }
+        }
+        for( uint64_t e = 0; ok && e < numEvents; e++ ) {
+            gameSessionEventOrder[ e ] = mf_readSignedVarint( payload, pos, ok ) + ( e > 0 ? gameSessionEventOrder[ e - 1 ] : 0 );
+        }
+        for( uint64_t e = 0; ok && e < numEvents; e++ ) {
+            playSessionEventOrder[ e ] = mf_readSignedVarint( payload, pos, ok ) + ( e > 0 ? playSessionEventOrder[ e - 1 ] : 0 );
+        }
+        for( uint64_t e = 0; ok && e < numEvents; e++ ) {
+            uint32_t bits = (uint32_t)mf_readFixed( payload, pos, 4, ok );
+            memcpy( &totalTimePlayed[ e ], &bits, sizeof( bits ) );
+        }
+        uint64_t numTotalValues = 0;
+        for( uint64_t e = 0; ok && e < numEvents; e++ ) {
+            numValues[ e ] = mf_readVarint( payload, pos, ok );
+            numTotalValues += numValues[ e ];
+        }
+        if( !ok || numTotalValues > payload.size() ) {
+            return NULL;
+        }
+
+        // Value columns
+        vector<uint64_t> keys( numTotalValues );
+        vector<int> types( numTotalValues );
+        for( uint64_t v = 0; ok && v < numTotalValues; v++ ) {
+            keys[ v ] = mf_readVarint( payload, pos, ok );
+            ok = ok && keys[ v ] < strings.size();
+        }
+        for( uint64_t v = 0; ok && v < numTotalValues; v++ ) {
+            ok = ok && pos < payload.size();
+            types[ v ] = ok ? (unsigned char)payload[ pos++ ] : 0;
+        }
+
+        json_t* events = json_array();
+        uint64_t v = 0;
+        for( uint64_t e = 0; ok && e < numEvents; e++ ) {
+            const uint64_t* eventContext = &contexts[ context[ e ] * 5 ];
+
+            json_t* root = json_object();
+            json_object_set_new( root, "clientTimeStamp", json_integer( (json_int_t)( clientTimeMillis[ e ] / 1000 ) ) );
+            if( !secondsOnly ) {
+                json_object_set_new( root, "clientTimeStampMs", json_integer( (json_int_t)clientTimeMillis[ e ] ) );
+            }
+            if( clockSkewMs != 0 ) {
+                json_object_set_new( root, "clockSkewMs", json_integer( (json_int_t)clockSkewMs ) );
+            }
+            json_object_set_new( root, "eventName", json_string( strings[ name[ e ] ].c_str() ) );
+            json_object_set_new( root, "gameId", json_string( strings[ eventContext[ 0 ] ].c_str() ) );
+            json_object_set_new( root, "gameSessionId", json_string( gameSessionId.c_str() ) );
+            json_object_set_new( root, "playSessionId", json_string( strings[ eventContext[ 1 ] ].c_str() ) );
+            json_object_set_new( root, "gameSessionEventOrder", json_integer( (json_int_t)gameSessionEventOrder[ e ] ) );
+            json_object_set_new( root, "playSessionEventOrder", json_integer( (json_int_t)playSessionEventOrder[ e ] ) );
+            if( strings[ eventContext[ 2 ] ].length() > 0 ) {
+                json_object_set_new( root, "deviceId", json_string( strings[ eventContext[ 2 ] ].c_str() ) );
+            }
+            if( strings[ eventContext[ 3 ] ].length() > 0 ) {
+                json_object_set_new( root, "clientVersion", json_string( strings[ eventContext[ 3 ] ].c_str() ) );
+            }
+            if( strings[ eventContext[ 4 ] ].length() > 0 ) {
+                json_object_set_new( root, "gameLevel", json_string( strings[ eventContext[ 4 ] ].c_str() ) );
+            }
+
+            json_t* eventData = json_object();
+            for( uint64_t i = 0; ok && i < numValues[ e ]; i++, v++ ) {
+                const char* key = strings[ keys[ v ] ].c_str();
+                switch( types[ v ] ) {
+                    case TelemValue_String: {
+                        uint64_t ref = mf_readVarint( payload, pos, ok );
+                        ok = ok && ref < strings.size();
+                        if( ok ) {
+                            json_object_set_new( eventData, key, json_string( strings[ ref ].c_str() ) );
+                        }
+                        break;
+                    }
+                    case TelemValue_Integer:
+                        json_object_set_new( eventData, key, json_integer( (json_int_t)mf_readSignedVarint( payload, pos, ok ) ) );
+                        break;
+                    case TelemValue_Real: {
+                        uint64_t bits = mf_readFixed( payload, pos, 8, ok );
+                        double real;
+                        memcpy( &real, &bits, sizeof( real ) );
+                        json_object_set_new( eventData, key, json_real( real ) );
+                        break;
+                    }
+                    case TelemValue_Boolean:
+                        ok = ok && pos < payload.size();
+                        json_object_set_new( eventData, key, json_boolean( ok && payload[ pos++ ] != 0 ) );
+                        break;
+                    default:
+                        ok = false;
+                        break;
+                }
+            }
+            json_object_set_new( root, "eventData", eventData );
+            json_object_set_new( root, "totalTimePlayed", json_real( totalTimePlayed[ e ] ) );
+            json_array_append_new( events, root );
+        }
+
+        if( !ok ) {
+            json_decref( events );
+            return NULL;
+        }
+        return events;
+    }
+
+    /**
+     * Functions for base64, used to keep binary payloads in the text postdata column.
+     */
+    string TelemetryBuffer::toBase64( const string& data ) {
+        static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        string out;
+        out.reserve( ( data.size() + 2 ) / 3 * 4 );
+        for( size_t i = 0; i < data.size(); i += 3 ) {
+            uint32_t chunk = (unsigned char)data[ i ] << 16;
+            if( i + 1 < data.size() ) chunk |= (unsigned char)data[ i + 1 ] << 8;
+            if( i + 2 < data.size() ) chunk |= (unsigned char)data[ i + 2 ];
+            out += alphabet[ ( chunk >> 18 ) & 63 ];
+            out += alphabet[ ( chunk >> 12 ) & 63 ];
+            out += ( i + 1 < data.size() ) ? alphabet[ ( chunk >> 6 ) & 63 ] : '=';
+            out += ( i + 2 < data.size() ) ? alphabet[ chunk & 63 ] : '=';
+        }
+        return out;
+    }
+    string TelemetryBuffer::fromBase64( const string& text ) {
+        string out;
+        out.reserve( text.size() / 4 * 3 );
+        uint32_t chunk = 0;
+        int bits = 0;
+        for( size_t i = 0; i < text.size(); i++ ) {
+            char c = text[ i ];
+            int value;
+            if( c >= 'A' && c <= 'Z' )      value = c - 'A';
+            else if( c >= 'a' && c <= 'z' ) value = c - 'a' + 26;
+            else if( c >= '0' && c <= '9' ) value = c - '0' + 52;
+            else if( c == '+' )             value = 62;
+            else if( c == '/' )             value = 63;
+            else                            continue;
+
+            chunk = ( chunk << 6 ) | value;
+            bits += 6;
+            if( bits >= 8 ) {
+                bits -= 8;
+                out += (char)( ( chunk >> bits ) & 0xFF );
+            }
+        }
+        return out;
+    }
+
+    /**
+     * Helper functions for writing and reading the binary format.
+     */
+    uint32_t TelemetryBuffer::mf_dictionaryRef( const char* value, map<string, uint32_t>& dictionary, vector<const char*>& strings ) {
+        map<string, uint32_t>::iterator it = dictionary.find( value );
+        if( it != dictionary.end() ) {
+            return it->second;
+        }
+        uint32_t ref = (uint32_t)strings.size();
+        dictionary[ value ] = ref;
+        strings.push_back( value );
+        return ref;
+    }
+    void TelemetryBuffer::mf_writeVarint( string& out, uint64_t value ) {
+        while( value >= 0x80 ) {
+            out += (char)( ( value & 0x7F ) | 0x80 );
+            value >>= 7;
+        }
+        out += (char)value;
+    }
+    void TelemetryBuffer::mf_writeSignedVarint( string& out, int64_t value ) {
+        mf_writeVarint( out, ( (uint64_t)value << 1 ) ^ (uint64_t)( value >> 63 ) );
+    }
+    void TelemetryBuffer::mf_writeFixed( string& out, uint64_t value, int bytes ) {
+        for( int i = 0; i < bytes; i++ ) {
+            out += (char)( ( value >> ( 8 * i ) ) & 0xFF );
+        }
+    }
+    uint64_t TelemetryBuffer::mf_readVarint( const string& in, size_t& pos, bool& ok ) {
+        uint64_t value = 0;
+        for( int shift = 0; ok && shift < 64; shift += 7 ) {
+            if( pos >= in.size() ) {
+                break;
+            }
+            unsigned char byte = (unsigned char)in[ pos++ ];
+            value |= (uint64_t)( byte & 0x7F ) << shift;
+            if( ( byte & 0x80 ) == 0 ) {
+                return value;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+    int64_t TelemetryBuffer::mf_readSignedVarint( const string& in, size_t& pos, bool& ok ) {
+        uint64_t value = mf_readVarint( in, pos, ok );
+        return (int64_t)( value >> 1 ) ^ -(int64_t)( value & 1 );
+    }
+    uint64_t TelemetryBuffer::mf_readFixed( const string& in, size_t& pos, int bytes, bool& ok ) {
+        if( !ok || pos + bytes > in.size() ) {
+            ok = false;
+            return 0;
+        }
+        uint64_t value = 0;
+        for( int i = 0; i < bytes; i++ ) {
+            value |= (uint64_t)(unsigned char)in[ pos++ ] << ( 8 * i );
+        }
+        return value;
+    }
+    string TelemetryBuffer::mf_readString( const string& in, size_t& pos, bool& ok ) {
+        uint64_t length = mf_readVarint( in, pos, ok );
+        if( !ok || length > in.size() - pos ) {
+            ok = false;
+            return "";
+        }
+        string value = in.substr( pos, (size_t)length );
+        pos += (size_t)length;
+        return value;
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * Append telemetry functions for all possible data types. Values are recorded
+     * into the calling thread's capture batch, JSON is only produced in sendTelemEvents.
+     */
+    void Core::addTelemEventValue( const char* key, const char* value ) {
+        mf_getTelemProducer()->current->buffer.addValue( key, value );
+    }
+    void Core::addTelemEventValue( const char* key, int8_t value ) {
+        mf_getTelemProducer()->current->buffer.addValue( key, (int64_t)value );
+    }
+    void Core::addTelemEventValue( const char* key, int16_t value ) {
+        mf_getTelemProducer()->current->buffer.addValue( key, (int64_t)value );
+    }
+    void Core::addTelemEventValue( const char* key, int32_t value ) {
+        mf_getTelemProducer()->current->buffer.addValue( key, (int64_t)value );
+    }
+    void Core::addTelemEventValue( const char* key, uint8_t value ) {
+        mf_getTelemProducer()->current->buffer.addValue( key, (int64_t)value );
+    }
+    void Core::addTelemEventValue( const char* key, uint16_t value ) {
+        mf_getTelemProducer()->current->buffer.addValue( key, (int64_t)value );
+    }
+    void Core::addTelemEventValue( const char* key, uint32_t value ) {
+        mf_getTelemProducer()->current->buffer.addValue( key, (int64_t)value );
+    }
+    void Core::addTelemEventValue( const char* key, float value ) {
+        mf_getTelemProducer()->current->buffer.addValue( key, (double)value );
+    }
+    void Core::addTelemEventValue( const char* key, double value ) {
+        mf_getTelemProducer()->current->buffer.addValue( key, value );
+    }
+    void Core::addTelemEventValue( const char* key, bool value ) {
+        mf_getTelemProducer()->current->buffer.addValue( key, value );
+    }
+
+    /**
+     * Functions intern a telemetry key or event name and return a handle for the
+     * handle-based overloads below. Keys and names share one table, so a handle
+     * is valid in either position. Returns -1 if the string is NULL or empty.
+     */
+    int Core::registerTelemKey( const char* key ) {
+        return m_telemSymbols.registerSymbol( key );
+    }
+    int Core::registerTelemEventName( const char* name ) {
+        return m_telemSymbols.registerSymbol( name );
+    }
+
+    /**
+     * Append telemetry functions using a registered key handle. Unknown handles are ignored.
+     */
+    void Core::addTelemEventValue( int keyHandle, const char* value ) {
+        mf_getTelemProducer()->current->buffer.addValue( keyHandle, value );
+    }
+    void Core::addTelemEventValue( int keyHandle, int8_t value ) {
+        mf_getTelemProducer()->current->buffer.addValue( keyHandle, (int64_t)value );
+    }
+    void Core::addTelemEventValue( int keyHandle, int16_t value ) {
+        mf_getTelemProducer()->current->buffer.addValue( keyHandle, (int64_t)value );
+    }
+    void Core::addTelemEventValue( int keyHandle, int32_t value ) {
+        mf_getTelemProducer()->current->buffer.addValue( keyHandle, (int64_t)value );
+    }
+    void Core::addTelemEventValue( int keyHandle, uint8_t value ) {
+        mf_getTelemProducer()->current->buffer.addValue( keyHandle, (int64_t)value );
+    }
+    void Core::addTelemEventValue( int keyHandle, uint16_t value ) {
+        mf_getTelemProducer()->current->buffer.addValue( keyHandle, (int64_t)value );
+    }
+    void Core::addTelemEventValue( int keyHandle, uint32_t value ) {
+        mf_getTelemProducer()->current->buffer.addValue( keyHandle, (int64_t)value );
+    }
+    void Core::addTelemEventValue( int keyHandle, float value ) {
+        mf_getTelemProducer()->current->buffer.addValue( keyHandle, (double)value );
+    }
+    void Core::addTelemEventValue( int keyHandle, double value ) {
+        mf_getTelemProducer()->current->buffer.addValue( keyHandle, value );
+    }
+    void Core::addTelemEventValue( int keyHandle, bool value ) {
+        mf_getTelemProducer()->current->buffer.addValue( keyHandle, value );
+    }
+
+    /**
+     * Function clears telemetry. On the thread that created the SDK this removes
+     * all saved events, on any other thread it drops the values added for the
+     * event that thread is building.
+     */
+    void Core::clearTelemEventValues() {
+        if( pthread_equal( pthread_self(), m_telemOwnerThread ) ) {
+            mf_drainTelemEvents();
+            m_telemBuffer.clear();
+            m_telemBufferBytes = m_telemBuffer.getByteSize();
+            m_telemBufferEvents = 0;
+        }
+        else {
+            mf_getTelemProducer()->current->buffer.discardValues();
+        }
+    }
+
+    /**
+     * Functions saves a telemetry event by name with all default parameters,
+     * including a timestamp, name, gameId, gameSessionId, deviceId, 
+     * clientVersion, gameLevel, and the data itself. Safe to call from any
+     * thread, the event is published for the next sendTelemEvents.
+     */
+    void Core::saveTelemEvent( const char* name ) {
+        saveTelemEvent( name, TELEM_PRIORITY_DEFAULT );
+    }
+    void Core::saveTelemEvent( int nameHandle ) {
+        saveTelemEvent( nameHandle, TELEM_PRIORITY_DEFAULT );
+    }
+
+    /**
+     * Functions save a telemetry event with a priority. Lower numbers are more
+     * important; events with a priority above config.eventsDetailLevel are
+     * dropped along with their values and counted instead of being recorded.
+     */
+    void Core::saveTelemEvent( const char* name, int priority ) {
+        if( !mf_acceptTelemPriority( priority ) || !mf_acceptTelemRate( name ) ) {
+            return;
+        }
+
+        TelemetryProducer* producer = mf_getTelemProducer();
+
+        // Time this event occurred and the total time played (-1 indicates an error or it doesn't exist)
+        float totalTimePlay;
+        int64_t t = mf_beginTelemEvent( totalTimePlay );
+
+        // Record the event and its pending values, the gameSessionId is filled in during the message queue flush
+        pthread_mutex_lock( &m_telemContextMutex );
+        producer->current->buffer.commitEvent( name, t, m_gameSessionEventOrder++, m_playSessionEventOrder++, totalTimePlay,
+                                               m_gameId.c_str(), m_playSessionId.c_str(), m_deviceId.c_str(), m_clientVersion.c_str(), m_gameLevel.c_str() );
+        pthread_mutex_unlock( &m_telemContextMutex );
+
+        mf_publishTelemBatch( producer );
+    }
+    void Core::saveTelemEvent( int nameHandle, int priority ) {
+        if( !mf_acceptTelemPriority( priority ) ) {
+            return;
+        }
+        if( !m_telemSymbols.isSymbol( nameHandle ) ) {
+            displayError( "Core::saveTelemEvent()", "The event name handle was not returned by registerTelemEventName!" );
+            return;
+        }
+        if( !mf_acceptTelemRate( m_telemSymbols.getSymbol( nameHandle ) ) ) {
+            return;
+        }
+
+        TelemetryProducer* producer = mf_getTelemProducer();
+        float totalTimePlay;
+        int64_t t = mf_beginTelemEvent( totalTimePlay );
+
+        pthread_mutex_lock( &m_telemContextMutex );
+        producer->current->buffer.commitEvent( nameHandle, t, m_gameSessionEventOrder++, m_playSessionEventOrder++, totalTimePlay,
+                                               m_gameId.c_str(), m_playSessionId.c_str(), m_deviceId.c_str(), m_clientVersion.c_str(), m_gameLevel.c_str() );
+        pthread_mutex_unlock( &m_telemContextMutex );
+
+        mf_publishTelemBatch( producer );
+    }
+
+    /**
+     * Function indicates if events of the given priority are currently recorded,
+     * so callers can skip building the values of an event that would be dropped.
+     */
+    bool Core::isTelemPriorityEnabled( int priority ) {
+        return priority <= mf_getConfig().eventsDetailLevel;
+    }
+
+    /**
+     * Function checks an event priority against the detail level, discarding the
+     * values of the calling thread's event if it is filtered out.
+     */
+    bool Core::mf_acceptTelemPriority( int priority ) {
+        if( isTelemPriorityEnabled( priority ) ) {
+            return true;
+        }
+
+        mf_getTelemProducer()->current->buffer.discardValues();
+        m_telemFilteredEvents++;
+        return false;
+    }
+
+    /**
+     * Function returns the wall-clock time in ms for a new telemetry event. On the
+     * thread that created the SDK it also starts a new play session if the session
+     * timer has run out and refreshes the total time played; other threads reuse
+     * the last total time played seen there.
+     */
+    int64_t Core::mf_beginTelemEvent( float& totalTimePlayed ) {
+        int64_t t = getClock()->wallMillis();
+
+        if( !pthread_equal( pthread_self(), m_telemOwnerThread ) ) {
+            totalTimePlayed = m_telemTimePlayed;
+            return t;
+        }
+
+        // Increment the session timer if it is active
+        if( m_autoSessionManagement && m_sessionTimerActive ) {
+            // Measure the time between last session time and current (in seconds)
+            int64_t now = getClock()->monotonicMicros();
+            float delta = (float)Clock::secondsBetween( m_sessionTimerLast, now );
+            m_sessionTimerLast = now;
+
+            // If the time since last event is greater than the SESSION_TIMEOUT, start a new play session
+            if( delta >= SESSION_TIMEOUT ) {
+                startPlaySession();
+            }
+        }
+
+        totalTimePlayed = getTotalTimePlayed();
+        m_telemTimePlayed = totalTimePlayed;
+        return t;
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * Function returns the telemetry producer for the calling thread, creating one
+     * or taking over one left behind by an exited thread on first use.
+     */
+    TelemetryProducer* Core::mf_getTelemProducer() {
+        TelemetryProducer* producer = (TelemetryProducer*)pthread_getspecific( m_telemProducerKey );
+        if( producer != NULL ) {
+            return producer;
+        }
+
+        // Producers are never unlinked while the Core exists, so the list can be walked without a lock
+        for( TelemetryProducer* p = m_telemProducers; p != NULL; p = p->next ) {
+            bool retired = true;
+            if( p->retired.compare_exchange_strong( retired, false ) ) {
+                producer = p;
+                producer->current->buffer.discardValues();
+                break;
+            }
+        }
+
+        if( producer == NULL ) {
+            producer = new TelemetryProducer();
+            producer->freeList = NULL;
+            producer->returned = NULL;
+            producer->retired  = false;
+            producer->current  = mf_acquireTelemBatch( producer );
+
+            producer->next = m_telemProducers;
+            while( !m_telemProducers.compare_exchange_weak( producer->next, producer ) ) {}
+        }
+
+        pthread_setspecific( m_telemProducerKey, producer );
+        return producer;
+    }
+
+    /**
+     * Function returns an empty batch for the producer, recycling the batches
+     * sendTelemEvents has handed back before allocating a new one.
+     */
+    TelemetryBatch* Core::mf_acquireTelemBatch( TelemetryProducer* producer ) {
+        if( producer->freeList == NULL ) {
+            producer->freeList = producer->returned.exchange( NULL );
+        }
+
+        TelemetryBatch* batch = producer->freeList;
+        if( batch != NULL ) {
+            producer->freeList = batch->next;
+        }
+        else {
+            batch = new TelemetryBatch();
+            batch->owner = producer;
+            batch->buffer.setSymbols( &m_telemSymbols );
+            batch->buffer.reserve( TELEM_BATCH_ARENA_SIZE_DEFAULT, TELEM_BATCH_MAX_VALUES_DEFAULT, 1 );
+        }
+
+        batch->next = NULL;
+        return batch;
+    }
+
+    /**
+     * Function pushes the producer's completed batch onto the published stack
+     * and starts a new one.
+     */
+    void Core::mf_publishTelemBatch( TelemetryProducer* producer ) {
+        TelemetryBatch* batch = producer->current;
+        m_telemPublishedBytes += batch->buffer.getByteSize();
+        m_telemPublishedEvents += batch->buffer.getEventCount();
+        batch->next = m_telemPublished;
+        while( !m_telemPublished.compare_exchange_weak( batch->next, batch ) ) {}
+
+        producer->current = mf_acquireTelemBatch( producer );
+
+        // Past the budget, move everything buffered into the message queue without waiting for sendTelemEvents
+        int maxBufferBytes = mf_getConfig().eventsMaxBufferBytes;
+        if( maxBufferBytes > 0 && getTelemBufferedBytes() > maxBufferBytes &&
+            !m_telemSpillRequested.exchange( true ) ) {
+#ifdef MULTITHREADED
+            // Other threads leave it to the flush thread, or the next sendTelemEvents
+            if( !pthread_equal( pthread_self(), m_telemOwnerThread ) ) {
+                pthread_cond_broadcast( &m_jobTriggerCondition );
+                return;
+            }
+#endif
+            // Without a flush thread the publishing thread spills, which resets the request
+            mf_spillTelemEvents();
+        }
+    }
+
+    /**
+     * Function services a spill request. The thread that created the SDK queues
+     * everything buffered, other threads only queue the published batches since
+     * the capture arena belongs to the thread that created the SDK.
+     */
+    void Core::mf_spillTelemEvents() {
+        if( !m_telemSpillRequested.exchange( false ) ) {
+            return;
+        }
+        logMessage( "Telemetry buffer budget exceeded, spilling events to the message queue" );
+
+        if( pthread_equal( pthread_self(), m_telemOwnerThread ) ) {
+            mf_drainTelemEvents();
+            if( m_telemBuffer.getEventCount() > 0 ) {
+                mf_queueTelemEvents();
+            }
+
+            // Give back an arena that outgrew its reserve
+            m_telemBuffer.trim( TELEM_ARENA_SIZE_DEFAULT, TELEM_MAX_VALUES_DEFAULT, TELEM_MAX_EVENTS_DEFAULT );
+            m_telemBufferBytes = m_telemBuffer.getByteSize();
+            return;
+        }
+
+        TelemetryBuffer spill;
+        spill.setSymbols( &m_telemSymbols );
+        mf_drainTelemEvents( spill );
+        if( spill.getEventCount() > 0 ) {
+            mf_queueTelemBuffer( spill );
+        }
+    }
+
+    /**
+     * Function moves all published events into the capture arena in the order
+     * they were published and returns the batches to their producers.
+     */
+    void Core::mf_drainTelemEvents() {
+        mf_drainTelemEvents( m_telemBuffer );
+        m_telemBufferBytes = m_telemBuffer.getByteSize();
+        m_telemBufferEvents = m_telemBuffer.getEventCount();
+    }
+
+    /**
+     * Function moves all published events into the target buffer. Batches taken
+     * by concurrent calls do not overlap.
+     */
+    void Core::mf_drainTelemEvents( TelemetryBuffer& target ) {
+        // The stack is newest first, reverse it
+        TelemetryBatch* batch = m_telemPublished.exchange( NULL );
+        TelemetryBatch* ordered = NULL;
+        while( batch != NULL ) {
+            TelemetryBatch* next = batch->next;
+            batch->next = ordered;
+            ordered = batch;
+            batch = next;
+        }
+
+        while( ordered != NULL ) {
+            TelemetryBatch* next = ordered->next;
+            m_telemPublishedBytes -= ordered->buffer.getByteSize();
+            m_telemPublishedEvents -= ordered->buffer.getEventCount();
+            target.append( ordered->buffer );
+            ordered->buffer.clear();
+
+            TelemetryProducer* owner = ordered->owner;
+            ordered->next = owner->returned;
+            while( !owner->returned.compare_exchange_weak( ordered->next, ordered ) ) {}
+
+            ordered = next;
+        }
+    }
+
+    /**
+     * Functions report the telemetry held in memory, saved events that have not
+     * reached the message queue yet, the events dropped for exceeding the buffer
+     * budget and the events filtered out by priority. Safe to call from any thread.
+     */
+    int Core::getTelemBufferedBytes() {
+        return (int)( m_telemBufferBytes + m_telemPublishedBytes );
+    }
+    int Core::getTelemBufferedEventCount() {
+        return (int)( m_telemBufferEvents + m_telemPublishedEvents );
+    }
+    int Core::getTelemDroppedEventCount() {
+        return m_telemDroppedEvents;
+    }
+    int Core::getTelemFilteredEventCount() {
+        return m_telemFilteredEvents;
+    }
+
+    /**
+     * Thread exit handler for the producer key. The producer is kept for the
+     * next thread to take over, since published batches may still reference it.
+     */
+    void Core::mf_retireTelemProducer( void* producer ) {
+        static_cast<TelemetryProducer*>( producer )->retired = true;
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * Functions accumulate high-frequency telemetry locally instead of saving an
+     * event per sample. Each name is emitted as one summary event per window of
+     * config.eventsAggregatePeriodSecs through the regular event pipeline. A name
+     * keeps the kind it was first used with. Safe to call from any thread.
+     */
+    void Core::incrementTelemCounter( const char* name, int delta ) {
+        pthread_mutex_lock( &m_telemAggregateMutex );
+        TelemetryAggregate* aggregate = mf_getTelemAggregate( name, Const::TelemAggregate_Counter );
+        if( aggregate != NULL ) {
+            aggregate->count++;
+            aggregate->sum += delta;
+        }
+        pthread_mutex_unlock( &m_telemAggregateMutex );
+    }
+    void Core::setTelemGauge( const char* name, double value ) {
+        pthread_mutex_lock( &m_telemAggregateMutex );
+        TelemetryAggregate* aggregate = mf_getTelemAggregate( name, Const::TelemAggregate_Gauge );
+        if( aggregate != NULL ) {
+            aggregate->min = aggregate->count == 0 || value < aggregate->min ? value : aggregate->min;
+            aggregate->max = aggregate->count == 0 || value > aggregate->max ? value : aggregate->max;
+            aggregate->count++;
+            aggregate->sum += value;
+            aggregate->last = value;
+        }
+        pthread_mutex_unlock( &m_telemAggregateMutex );
+    }
+
+    /**
+     * Function sets the bucket upper bounds of a histogram, resetting its counts.
+     * Values recorded to a histogram without bounds only update its statistics.
+     */
+    void Core::defineTelemHistogram( const char* name, const double* bounds, int boundCount ) {
+        if( boundCount < 0 || ( bounds == NULL && boundCount > 0 ) ) {
+            displayWarning( "Core::defineTelemHistogram()", "The histogram bounds are invalid!" );
+            return;
+        }
+
+        pthread_mutex_lock( &m_telemAggregateMutex );
+        TelemetryAggregate* aggregate = mf_getTelemAggregate( name, Const::TelemAggregate_Histogram );
+        if( aggregate != NULL ) {
+            aggregate->bounds.assign( bounds, bounds + boundCount );
+            std::sort( aggregate->bounds.begin(), aggregate->bounds.end() );
+            aggregate->buckets.assign( boundCount + 1, 0 );
+            aggregate->count = 0;
+            aggregate->sum = 0;
+        }
+        pthread_mutex_unlock( &m_telemAggregateMutex );
+    }
+    void Core::recordTelemHistogram( const char* name, double value ) {
+        pthread_mutex_lock( &m_telemAggregateMutex );
+        TelemetryAggregate* aggregate = mf_getTelemAggregate( name, Const::TelemAggregate_Histogram );
+        if( aggregate != NULL ) {
+            aggregate->min = aggregate->count == 0 || value < aggregate->min ? value : aggregate->min;
+            aggregate->max = aggregate->count == 0 || value > aggregate->max ? value : aggregate->max;
+            aggregate->count++;
+            aggregate->sum += value;
+            aggregate->last = value;
+
+            // The first bucket whose bound is not below the value
+            size_t bucket = std::lower_bound( aggregate->bounds.begin(), aggregate->bounds.end(), value ) - aggregate->bounds.begin();
+            aggregate->buckets[ bucket ]++;
+        }
+        pthread_mutex_unlock( &m_telemAggregateMutex );
+    }
+
+    /**
+     * Function emits the aggregate summaries now instead of waiting for the window
+     * to end. Off the thread that created the SDK the summaries are emitted by the
+     * next sendTelemEvents.
+     */
+    void Core::flushTelemAggregates() {
+        if( pthread_equal( pthread_self(), m_telemOwnerThread ) ) {
+            mf_emitTelemAggregates( true );
+        }
+        else {
+            m_telemAggregateFlushPending = true;
+        }
+    }
+
+    /**
+     * Function returns the aggregate for a name, creating it on first use. Returns
+     * NULL if the name is already used by a different kind. The caller holds
+     * m_telemAggregateMutex.
+     */
+    TelemetryAggregate* Core::mf_getTelemAggregate( const char* name, int type ) {
+        if( name == NULL ) {
+            return NULL;
+        }
+
+        map<string, TelemetryAggregate>::iterator it = m_telemAggregates.find( name );
+        if( it == m_telemAggregates.end() ) {
+            TelemetryAggregate& aggregate = m_telemAggregates[ name ];
+            aggregate.type  = type;
+            aggregate.count = 0;
+            aggregate.sum   = 0;
+            aggregate.min   = 0;
+            aggregate.max   = 0;
+            aggregate.last  = 0;
+            aggregate.buckets.assign( 1, 0 );
+            return &aggregate;
+        }
+
+        if( it->second.type != type ) {
+            displayWarning( "Core::mf_getTelemAggregate()", "The aggregate name is already used by a different kind!" );
+            return NULL;
+        }
+        return &it->second;
+    }
+
+    /**
+     * Function writes one summary event per updated aggregate into the capture
+     * arena once the window has ended, then starts a new window. Aggregates are
+     * reset but kept so their storage is reused. Only called on the thread that
+     * created the SDK.
+     */
+    void Core::mf_emitTelemAggregates( bool force ) {
+        // A flush requested on another thread ends the window early, windowSecs stays accurate
+        if( m_telemAggregateFlushPending.exchange( false ) ) {
+            force = true;
+        }
+        int64_t now = getClock()->monotonicMicros();
+        int64_t t = 0;
+        float totalTimePlayed = -1;
+        bool started = false;
+
+        pthread_mutex_lock( &m_telemAggregateMutex );
+        int windowSecs = (int)Clock::secondsBetween( m_telemAggregateLast, now );
+        if( !force && windowSecs < mf_getConfig().eventsAggregatePeriodSecs ) {
+            pthread_mutex_unlock( &m_telemAggregateMutex );
+            return;
+        }
+        m_telemAggregateLast = now;
+
+        char key[ 64 ];
+        for( map<string, TelemetryAggregate>::iterator it = m_telemAggregates.begin(); it != m_telemAggregates.end(); it++ ) {
+            TelemetryAggregate& aggregate = it->second;
+            if( aggregate.count == 0 ) {
+                continue;
+            }
+
+            // The session timer only advances when there is something to report
+            if( !started ) {
+                t = mf_beginTelemEvent( totalTimePlayed );
+                started = true;
+            }
+
+            m_telemBuffer.addValue( "count", (int64_t)aggregate.count );
+            m_telemBuffer.addValue( "windowSecs", (int64_t)windowSecs );
+            if( aggregate.type == Const::TelemAggregate_Counter ) {
+                m_telemBuffer.addValue( "aggregate", "counter" );
+                m_telemBuffer.addValue( "value", (int64_t)aggregate.sum );
+            }
+            else {
+                m_telemBuffer.addValue( "aggregate", aggregate.type == Const::TelemAggregate_Gauge ? "gauge" : "histogram" );
+                m_telemBuffer.addValue( aggregate.type == Const::TelemAggregate_Gauge ? "value" : "sum",
+                                        aggregate.type == Const::TelemAggregate_Gauge ? aggregate.last : aggregate.sum );
+                m_telemBuffer.addValue( "min", aggregate.min );
+                m_telemBuffer.addValue( "max", aggregate.max );
+                m_telemBuffer.addValue( "mean", aggregate.sum / aggregate.count );
+            }
+
+            // Bucket counts are keyed by their upper bound
+            if( aggregate.type == Const::TelemAggregate_Histogram ) {
+                for( size_t i = 0; i < aggregate.bounds.size(); i++ ) {
+                    snprintf( key, sizeof( key ), "le_%g", aggregate.bounds[ i ] );
+                    m_telemBuffer.addValue( key, (int64_t)aggregate.buckets[ i ] );
+                }
+                m_telemBuffer.addValue( "le_inf", (int64_t)aggregate.buckets.back() );
+            }
+
+            pthread_mutex_lock( &m_telemContextMutex );
+            m_telemBuffer.commitEvent( it->first.c_str(), t, m_gameSessionEventOrder++, m_playSessionEventOrder++, totalTimePlayed,
+                                       m_gameId.c_str(), m_playSessionId.c_str(), m_deviceId.c_str(), m_clientVersion.c_str(), m_gameLevel.c_str() );
+            pthread_mutex_unlock( &m_telemContextMutex );
+
+            aggregate.count = 0;
+            aggregate.sum   = 0;
+            aggregate.min   = 0;
+            aggregate.max   = 0;
+            aggregate.last  = 0;
+            std::fill( aggregate.buckets.begin(), aggregate.buckets.end(), 0 );
+        }
+
+        // Events dropped by their limits are reported on the same window
+        mf_commitTelemLimitSummary( t, windowSecs, started, totalTimePlayed );
+        pthread_mutex_unlock( &m_telemAggregateMutex );
+
+        m_telemBufferBytes = m_telemBuffer.getByteSize();
+        m_telemBufferEvents = m_telemBuffer.getEventCount();
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * Function sets the fraction of events with this name that are recorded,
+     * the others are counted as sampled out. Safe to call from any thread.
+     */
+    void Core::setTelemEventSampleRate( const char* name, float sampleRate ) {
+        if( name == NULL ) {
+            return;
+        }
+
+        pthread_mutex_lock( &m_telemLimitMutex );
+        mf_getTelemEventLimit( name ).sampleRate = sampleRate < 0 ? 0 : ( sampleRate > 1 ? 1 : sampleRate );
+        pthread_mutex_unlock( &m_telemLimitMutex );
+    }
+
+    /**
+     * Function caps how often events with this name are recorded with a token
+     * bucket refilled at ratePerSec, holding at most burst events. A rate of 0
+     * removes the cap. Safe to call from any thread.
+     */
+    void Core::setTelemEventRateLimit( const char* name, float ratePerSec, int burst ) {
+        if( name == NULL ) {
+            return;
+        }
+
+        pthread_mutex_lock( &m_telemLimitMutex );
+        TelemetryEventLimit& limit = mf_getTelemEventLimit( name );
+        limit.ratePerSec = ratePerSec > 0 ? ratePerSec : 0;
+        limit.burst      = burst > 1 ? (float)burst : 1;
+        limit.tokens     = limit.burst;
+        limit.lastRefill = getClock()->monotonicMicros();
+        pthread_mutex_unlock( &m_telemLimitMutex );
+    }
+
+    /**
+     * Function returns the number of events sampled out or rate limited.
+     */
+    int Core::getTelemSampledOutEventCount() {
+        return m_telemSampledOutEvents;
+    }
+
+    /**
+     * Function returns the limit for an event name, creating one that keeps
+     * every event. The caller holds m_telemLimitMutex.
+     */
+    TelemetryEventLimit& Core::mf_getTelemEventLimit( const char* name ) {
+        map<string, TelemetryEventLimit>::iterator it = m_telemEventLimits.find( name );
+        if( it != m_telemEventLimits.end() ) {
+            return it->second;
+        }
+
+        TelemetryEventLimit& limit = m_telemEventLimits[ name ];
+        limit.sampleRate  = 1;
+        limit.ratePerSec  = 0;
+        limit.burst       = 1;
+        limit.tokens      = 1;
+        limit.lastRefill  = getClock()->monotonicMicros();
+        limit.sampledOut  = 0;
+        limit.rateLimited = 0;
+        m_telemLimitCount = (int)m_telemEventLimits.size();
+        return limit;
+    }
+
+    /**
+     * Function applies the sampling and rate limit of an event name, discarding
+     * the values of the calling thread's event if it is not recorded.
+     */
+    bool Core::mf_acceptTelemRate( const char* name ) {
+        if( m_telemLimitCount == 0 || name == NULL ) {
+            return true;
+        }
+
+        bool accept = true;
+        pthread_mutex_lock( &m_telemLimitMutex );
+        map<string, TelemetryEventLimit>::iterator it = m_telemEventLimits.find( name );
+        if( it != m_telemEventLimits.end() ) {
+            TelemetryEventLimit& limit = it->second;
+
+            // Sampled out events do not use up the rate limit
+            if( limit.sampleRate < 1 && mf_telemSampleRandom() >= limit.sampleRate ) {
+                limit.sampledOut++;
+                accept = false;
+            }
+            else if( limit.ratePerSec > 0 ) {
+                int64_t now = getClock()->monotonicMicros();
+                float elapsed = (float)Clock::secondsBetween( limit.lastRefill, now );
+                if( elapsed > 0 ) {
+                    limit.tokens = limit.tokens + elapsed * limit.ratePerSec;
+                    limit.tokens = limit.tokens > limit.burst ? limit.burst : limit.tokens;
+                    limit.lastRefill = now;
+                }
+
+                if( limit.tokens >= 1 ) {
+                    limit.tokens -= 1;
+                }
+                else {
+                    limit.rateLimited++;
+                    accept = false;
+                }
+            }
+        }
+        pthread_mutex_unlock( &m_telemLimitMutex );
+
+        if( !accept ) {
+            mf_getTelemProducer()->current->buffer.discardValues();
+            m_telemSampledOutEvents++;
+        }
+        return accept;
+    }
+
+    /**
+     * Function returns a uniform number in [0, 1) from the sampling generator
+     * (xorshift64*), so sampling does not share or reseed the global rand() state.
+     * The caller holds m_telemLimitMutex.
+     */
+    double Core::mf_telemSampleRandom() {
+        m_telemSampleState ^= m_telemSampleState >> 12;
+        m_telemSampleState ^= m_telemSampleState << 25;
+        m_telemSampleState ^= m_telemSampleState >> 27;
+        return ( ( m_telemSampleState * 2685821657736338717ULL ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+    }
+
+    /**
+     * Function writes a summary event with the number of events of each name
+     * that were sampled out or rate limited during the window, nested under
+     * byEventName, then resets the counts. Called with the aggregate window on
+     * the thread that created the SDK.
+     */
+    void Core::mf_commitTelemLimitSummary( int64_t& t, int windowSecs, bool& started, float& totalTimePlayed ) {
+        if( m_telemLimitCount == 0 ) {
+            return;
+        }
+
+        int64_t sampledOut = 0;
+        int64_t rateLimited = 0;
+        json_t* byEventName = json_object();
+
+        pthread_mutex_lock( &m_telemLimitMutex );
+        for( map<string, TelemetryEventLimit>::iterator it = m_telemEventLimits.begin(); it != m_telemEventLimits.end(); it++ ) {
+            TelemetryEventLimit& limit = it->second;
+            if( limit.sampledOut + limit.rateLimited > 0 ) {
+                json_object_set_new( byEventName, it->first.c_str(), json_integer( (json_int_t)( limit.sampledOut + limit.rateLimited ) ) );
+                sampledOut += limit.sampledOut;
+                rateLimited += limit.rateLimited;
+                limit.sampledOut = 0;
+                limit.rateLimited = 0;
+            }
+        }
+        pthread_mutex_unlock( &m_telemLimitMutex );
+
+        if( sampledOut + rateLimited == 0 ) {
+            json_decref( byEventName );
+            return;
+        }
+
+        if( !started ) {
+            t = mf_beginTelemEvent( totalTimePlayed );
+            started = true;
+        }
+
+        char* byEventNameJSON = json_dumps( byEventName, JSON_COMPACT | JSON_SORT_KEYS );
+        json_decref( byEventName );
+        m_telemBuffer.addJSONValue( "byEventName", byEventNameJSON );
+        free( byEventNameJSON );
+        m_telemBuffer.addValue( "totalSampledOut", sampledOut );
+        m_telemBuffer.addValue( "totalRateLimited", rateLimited );
+        m_telemBuffer.addValue( "windowSecs", (int64_t)windowSecs );
+
+        pthread_mutex_lock( &m_telemContextMutex );
+        m_telemBuffer.commitEvent( TELEM_LIMIT_SUMMARY_EVENT, t, m_gameSessionEventOrder++, m_playSessionEventOrder++, totalTimePlayed,
+                                   m_gameId.c_str(), m_playSessionId.c_str(), m_deviceId.c_str(), m_clientVersion.c_str(), m_gameLevel.c_str() );
+        pthread_mutex_unlock( &m_telemContextMutex );
+    }
+
+
     //--------------------------------------
     //--------------------------------------
     //--------------------------------------
@@ -2801,7 +5669,15 @@ namespace nsGlasslabSDK {
      * Set platform required default key-value pairs in the player info data structure.
      */
     void Core::setDefaultPlayerInfoKeys() {
-        json_object_set_new( m_playerInfo, "$totalTimePlayed$", json_real( m_dataSync->getTotalTimePlayedFromDeviceId( m_deviceId ) ) );
+        // The session already holds any restored total time played
+        pthread_mutex_lock( &m_sessionMutex );
+        map<string, glSession>::iterator session = m_sessions.find( m_deviceId );
+        float totalTimePlayed = session != m_sessions.end() ? session->second.totalTimePlayed : 0;
+        m_timePlayedRestored = false;
+        m_restoredTimePlayed = 0;
+        pthread_mutex_unlock( &m_sessionMutex );
+
+        json_object_set_new( m_playerInfo, "$totalTimePlayed$", json_real( totalTimePlayed ) );
     }
 
     /**
@@ -2826,7 +5702,7 @@ namespace nsGlasslabSDK {
         // Only reset the last time if we were previously inactive
         if( !m_gameTimerActive ) {
             m_gameTimerActive = true;
-            m_gameTimerLast = time( NULL );
+            m_gameTimerLast = getClock()->monotonicMicros();
         }
     }
 
@@ -2848,7 +5724,7 @@ namespace nsGlasslabSDK {
         // Only reset the last time if we were previously inactive
         if( !m_sessionTimerActive ) {
             m_sessionTimerActive = true;
-            m_sessionTimerLast = time( NULL );
+            m_sessionTimerLast = getClock()->monotonicMicros();
         }
     }
 
@@ -2869,6 +5745,10 @@ namespace nsGlasslabSDK {
      */
     void Core::resetDatabase() {
         if( m_dataSync != NULL ) {
+            pthread_mutex_lock( &m_sessionMutex );
+            m_sessions.clear();
+            pthread_mutex_unlock( &m_sessionMutex );
+
             m_dataSync->resetDatabase();
         }
     }
@@ -2881,7 +5761,10 @@ namespace nsGlasslabSDK {
      * Setters.
      */
     void Core::setConnectUri( const char* uri ) {
+        pthread_mutex_lock( &m_sessionMutex );
         m_connectUri = uri;
+        m_connectUriSet = true;
+        pthread_mutex_unlock( &m_sessionMutex );
     }
 
     void Core::setGameSecret( const char* gameSecret ) {
@@ -2893,11 +5776,15 @@ namespace nsGlasslabSDK {
     }
 
     void Core::setVersion( const char* version ) {
+        pthread_mutex_lock( &m_telemContextMutex );
         m_clientVersion = version;
+        pthread_mutex_unlock( &m_telemContextMutex );
     }
 
     void Core::setGameLevel( const char* gameLevel ) {
+        pthread_mutex_lock( &m_telemContextMutex );
         m_gameLevel = gameLevel;
+        pthread_mutex_unlock( &m_telemContextMutex );
     }
 
     void Core::setUserId( int userId ) {
@@ -2905,13 +5792,26 @@ namespace nsGlasslabSDK {
     }
     
     void Core::setConfig( glConfig _config ){
+        pthread_mutex_lock( &m_sessionMutex );
+        pthread_mutex_lock( &m_configMutex );
         memcpy(&config, &_config, sizeof(glConfig));
+        pthread_mutex_unlock( &m_configMutex );
+        m_configSet = true;
+        pthread_mutex_unlock( &m_sessionMutex );
     }
     
     void Core::setTime( time_t time ) {
         m_currentTime = time;
     }
 
+    /**
+     * Function replaces the clock used for timers and event timestamps, NULL restores
+     * the system clock. The caller keeps ownership and must outlive its use.
+     */
+    void Core::setClock( Clock* clock ) {
+        m_clock = clock != NULL ? clock : &m_systemClock;
+    }
+
     void Core::setPlayerHandle( const char* handle ) {
         printf( "player handle to set: %s\n" , handle );
 
@@ -2927,21 +5827,22 @@ namespace nsGlasslabSDK {
         if( m_dataSync != NULL ) {
             printf( "setting new device Id using player handle: %s", newDeviceId );
             m_dataSync->updateSessionTableWithPlayerHandle( newDeviceId );
-
-            // Get the cookie stored for this device Id
-            m_cookie = m_dataSync->getCookieFromDeviceId( newDeviceId );
         }
 
-        // Set the new device Id
+        // Get the cookie and event order stored for this device Id and set the new device Id
+        pthread_mutex_lock( &m_sessionMutex );
+        glSession& session = mf_session( newDeviceId );
+        m_cookie = session.cookie;
+        m_gameSessionEventOrder = session.gameSessionEventOrder;
+        pthread_mutex_lock( &m_telemContextMutex );
         m_deviceId = newDeviceId;
+        pthread_mutex_unlock( &m_telemContextMutex );
+        pthread_mutex_unlock( &m_sessionMutex );
 
         // Send the current player info and reset it for this user
         savePlayerInfo();
         resetPlayerInfo();
 
-        // Get the game session event order to update
-        m_gameSessionEventOrder = m_dataSync->getGameSessionEventOrderFromDeviceId( m_deviceId );
-
         // Call the update device Id API
         //deviceUpdate();
     }
@@ -2960,33 +5861,50 @@ namespace nsGlasslabSDK {
             logMessage( "device Id to remove:", deviceIdToRemove );
             m_dataSync->removeSessionWithDeviceId( deviceIdToRemove );
         }
+
+        pthread_mutex_lock( &m_sessionMutex );
+        m_sessions.erase( deviceIdToRemove );
+        pthread_mutex_unlock( &m_sessionMutex );
     }
 
     void Core::setCookie( const char* cookie ) {
+        pthread_mutex_lock( &m_sessionMutex );
         m_cookie = cookie;
+        string deviceId = m_deviceId;
+        glSession& session = mf_session( deviceId );
+        session.cookie = cookie;
+        session.fields |= SessionField_Cookie;
+        pthread_mutex_unlock( &m_sessionMutex );
 
         // Set the cookie in the SESSION table
         if( m_dataSync != NULL ) {
-            logMessage( "setting cookie:", m_cookie.c_str() );
-            m_dataSync->updateSessionTableWithCookie( m_deviceId, m_cookie );
+            logMessage( "setting cookie:", cookie );
+            m_dataSync->updateSessionTableWithCookie( deviceId, cookie );
         }
     }
 
     void Core::setPlaySessionId( const char* playSessionId ) {
+        pthread_mutex_lock( &m_telemContextMutex );
         m_playSessionId = playSessionId;
         m_playSessionEventOrder = 1;
+        pthread_mutex_unlock( &m_telemContextMutex );
     }
 
     void Core::setSessionId( const char* sessionId ) {
         m_sessionId = sessionId;
 
+        // Get the game session event order to update
+        pthread_mutex_lock( &m_sessionMutex );
+        glSession& session = mf_session( m_deviceId );
+        session.gameSessionId = m_sessionId;
+        session.fields |= SessionField_GameSessionId;
+        m_gameSessionEventOrder = session.gameSessionEventOrder;
+        pthread_mutex_unlock( &m_sessionMutex );
+
         // Set the gameSessionId in the SESSION table
         if( m_dataSync != NULL ) {
             //logMessage( "setting game session Id:", m_sessionId.c_str() );
             m_dataSync->updateSessionTableWithGameSessionId( m_deviceId, m_sessionId );
-
-            // Get the game session event order to update
-            m_gameSessionEventOrder = m_dataSync->getGameSessionEventOrderFromDeviceId( m_deviceId );
         }
     }
 
@@ -2994,6 +5912,29 @@ namespace nsGlasslabSDK {
         m_autoSessionManagement = state;
     }
 
+    /**
+     * Function selects where queued messages are stored (Const::QueueStore), the
+     * MSG_QUEUE table or an append-only log next to the database. Messages already
+     * queued are moved over. Call it before connecting, while nothing is being sent.
+     */
+    void Core::setMessageStore( int type ) {
+        if( m_dataSync != NULL ) {
+            m_dataSync->setMessageStore( type );
+        }
+    }
+
+    /**
+     * Function sets the file an in-memory database (dataPath DB_MEMORY_PATH) is
+     * snapshotted to, every intervalSecs seconds, at forceFlushTelemEvents() and
+     * when the SDK is destroyed.
+     * Events queued in an existing snapshot are restored.
+     */
+    void Core::setDatabaseSnapshot( const char* path, int intervalSecs ) {
+        if( m_dataSync != NULL ) {
+            m_dataSync->setSnapshot( path, intervalSecs );
+        }
+    }
+
 
     //--------------------------------------
     //--------------------------------------
@@ -3001,8 +5942,22 @@ namespace nsGlasslabSDK {
     /**
      * Getters.
      */
+    Clock* Core::getClock() {
+        return m_clock;
+    }
+
     const char* Core::getConnectUri() {
-        return m_connectUri.c_str();
+        pthread_mutex_lock( &m_sessionMutex );
+        m_connectUriResult = m_connectUri;
+        pthread_mutex_unlock( &m_sessionMutex );
+        return m_connectUriResult.c_str();
+    }
+
+    glConfig Core::mf_getConfig() {
+        pthread_mutex_lock( &m_configMutex );
+        glConfig current = config;
+        pthread_mutex_unlock( &m_configMutex );
+        return current;
     }
 
     int Core::getUserId() {
@@ -3030,6 +5985,9 @@ namespace nsGlasslabSDK {
     }
 
     float Core::getTotalTimePlayed() {
+        // Pick up the total time played restored from storage
+        mf_applyRestoredTimePlayed();
+
         // Get the JSON value from player info
         json_t* totalTimePlayedAsJSON = json_object_get( m_playerInfo, "$totalTimePlayed$" );
         // Verify it exists and is the right type
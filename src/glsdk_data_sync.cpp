@@ -44,18 +44,45 @@ either expressed or implied, of the FreeBSD Project.
 #include "glasslab_sdk.h"
 #include "glsdk_config.h"
 
+#ifdef ZLIB_COMPRESSION
+#include <zlib.h>
+#endif
+
 
 namespace nsGlasslabSDK {
 
     /**
-     * DataSync constructor creates the SQLite database.
+     * DataSync constructor sets up the database name, open() creates the SQLite database.
      */
     DataSync::DataSync( Core* core, const char* dbPath ) {
         // Set the Core SDK object
         m_core = core;
+
+        // Overflow counters
+        m_evictedMessages = 0;
+        m_evictedBytes = 0;
+        m_droppedMessages = 0;
+
+        // The writer thread is started by open()
+        m_writerStarted = false;
+        m_writerStopping = false;
+        m_writerBusy = false;
+        m_storageReady = false;
+#ifdef MULTITHREADED
+        queueFlushRequested = false;
+#endif
+
+        // Snapshots are off until setSnapshot() is called
+        m_inMemory = dbPath != NULL && strcmp( dbPath, DB_MEMORY_PATH ) == 0;
+        m_snapshotInterval = 0;
+        m_lastSnapshot = time( NULL );
+        pthread_mutex_init( &m_snapshotMutex, NULL );
         
         m_dbName = "";
-        if( dbPath ) {
+        if( m_inMemory ) {
+            m_dbName = DB_MEMORY_PATH;
+        }
+        else if( dbPath ) {
             m_dbName += dbPath;
             m_dbName += "/glasslabsdk.db";
         } else {
@@ -86,6 +113,43 @@ namespace nsGlasslabSDK {
         m_core->logMessage( "Database file:", m_dbName.c_str() );
         //cout << "Database file: " << result << endl;
 
+        // The message queue starts in the MSG_QUEUE table once storage is initialized
+        m_store = NULL;
+        m_storeType = Const::QueueStore_SQLite;
+        pthread_mutex_init( &m_storeMutex, NULL );
+    }
+
+    /**
+     * Function opens the database. With MULTITHREADED this happens on the storage writer
+     * thread, so the caller does not wait on a version check or migration; writes made
+     * in the meantime are queued in memory and reads wait until storage is ready.
+     * Core::mf_storageReady() is called once it is.
+     */
+    void DataSync::open() {
+#ifdef MULTITHREADED
+        // Move SQLite work off the calling threads
+        if( startWriterThread() == 0 ) {
+            return;
+        }
+        m_core->logMessage( "Couldn't start the storage writer thread, writing synchronously..." );
+#endif
+        initStorage();
+        m_storageReady = true;
+        m_core->mf_storageReady();
+    }
+
+    /**
+     * Function returns true once open() has initialized the database.
+     */
+    bool DataSync::isStorageReady() {
+        return m_storageReady;
+    }
+
+    /**
+     * Function opens the database, validates the stored version, creates the tables
+     * and the message store.
+     */
+    void DataSync::initStorage() {
         // Open the database
         initDB();
 
@@ -94,6 +158,18 @@ namespace nsGlasslabSDK {
 
         // Create the tables needed (tables that already exist will be ignored)
         createTables();
+
+        // The message queue stays in the backend setMessageStore() last switched to
+        if( getStoredMessageStoreType() == Const::QueueStore_Log && !m_inMemory ) {
+            m_store = new LogMessageStore( m_core, m_dbName + ".msgq" );
+            if( m_store->open() ) {
+                m_storeType = Const::QueueStore_Log;
+                return;
+            }
+            delete m_store;
+        }
+        m_store = new SQLiteMessageStore( m_core, &m_db );
+        m_store->open();
     }
 
     /**
@@ -101,6 +177,17 @@ namespace nsGlasslabSDK {
      */
     DataSync::~DataSync() {
         cout << endl << endl << "Destructor has been called" << endl << endl;
+
+        // Apply what is still queued before closing
+        stopWriterThread();
+
+        // Keep what is still queued in memory, ~Core gets here once the request thread is stopped
+        snapshotDatabase();
+        pthread_mutex_destroy( &m_snapshotMutex );
+
+        delete m_store;
+        pthread_mutex_destroy( &m_storeMutex );
+
         try {
             m_db.close();
         }
@@ -236,7 +323,8 @@ namespace nsGlasslabSDK {
 
     /**
      * Function validates the SDK version by searching for an entry in the CONFIG table.
-     * If there is a version mismatch, the database is reset.
+     * If there is no entry, the database is reset. If the SDK version or the schema
+     * version (PRAGMA user_version) is behind, the tables are migrated.
      */
     void DataSync::validateSDKVersion() {
         try {
@@ -270,21 +358,15 @@ namespace nsGlasslabSDK {
                 }
                 // There is an entry, grab it
                 else {
-                    // Get the SDK versions, old and new [MAJOR.MINOR.REVISION], and compare
+                    // Get the SDK versions, old and new [MAJOR.MINOR.REVISION], and compare.
+                    // The stored version is updated by migrateTables(), with the tables.
                     if( isVersionOutOfDate( q.fieldValue( 0 ), SDK_VERSION ) ) {
                         printf( "detected out of date version, performing migration\n" );
-
-                        s = "";
-                        s += "update ";
-                        s += CONFIG_TABLE_NAME;
-                        s += " set version='";
-                        s += SDK_VERSION;
-                        s += "'";
-                        printf("SQL: %s\n", s.c_str());
-                        int nRows = m_db.execDML( s.c_str() );
-                        printf("%d rows updated in %s\n", nRows, CONFIG_TABLE_NAME);
-
-                        // Indicate that a table migration is required
+                        performMigration = true;
+                    }
+                    // An interrupted migration left the schema version behind
+                    else if( getSchemaVersion() < DB_SCHEMA_VERSION ) {
+                        printf( "detected out of date schema, performing migration\n" );
                         performMigration = true;
                     }
                     else {
@@ -322,186 +404,351 @@ namespace nsGlasslabSDK {
      *
      * Inserts a new entry into the MSG_QUEUE table.
      */
-    void DataSync::addToMsgQ( string deviceId, string path, string requestType, string coreCB, string postdata, const char* contentType ) {
-        if( m_messageTableSize > DB_MESSAGE_CAP ) {
-            cout << "------------------------------------" << endl;
-            cout << "Database has reached a message cap! No longer inserting events!" << endl;
-            cout << "------------------------------------" << endl;
+    void DataSync::addToMsgQ( string deviceId, string path, string requestType, int coreCB, string postdata, const char* contentType ) {
+        // Hand the insert to the storage writer thread
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_AddMessage, deviceId );
+            write->path = path;
+            write->requestType = requestType;
+            write->coreCB = coreCB;
+            write->postdata = postdata;
+            write->contentType = contentType != NULL ? contentType : "";
+            queueWrite( write );
             return;
         }
 
-        int nRows = 0;
-        // string stream
-        string s = "";
-        
-        try {
-            cout << "------------------------------------" << endl;
-            s += "INSERT INTO ";
-            s += MSG_QUEUE_TABLE_NAME;
-            s += " (deviceId, path, requestType, coreCB, postdata, contentType, status) VALUES ('";
-            s += deviceId;
-            s += "', ";
+        glQueuedMessage message;
+        message.id = 0;
+        message.deviceId = deviceId;
+        message.path = path;
+        message.requestType = requestType;
+        message.coreCB = coreCB;
+        message.contentType = contentType != NULL ? contentType : "";
+        message.status = "ready";
+
+        // Compress larger payloads, small ones are stored as text
+        string compressed;
+        if( postdata.size() >= DB_MESSAGE_COMPRESS_MIN_SIZE && compressPostdata( postdata, compressed ) && compressed.size() < postdata.size() ) {
+            message.postdata = compressed;
+            message.codec = DB_MESSAGE_CODEC_DEFLATE;
+        }
+        else {
+            message.postdata = postdata;
+        }
 
-            // Check the API path
-            if( path.c_str() == NULL ) {
-               s += "''";
-            }
-            else {
-                s += "'";
-                s += path;
-                s += "'";
-            }
-            s += ", ";
+        // Apply the overflow policy before inserting
+        int64_t postdataBytes = message.postdata.size();
+        pthread_mutex_lock( &m_storeMutex );
+        if( !makeRoomInMsgQ( postdataBytes ) ) {
+            pthread_mutex_unlock( &m_storeMutex );
+            m_core->logMessage( "MSG_QUEUE cap reached, dropping the new message:", path.c_str() );
+            m_droppedMessages++;
+            return;
+        }
 
-            // Check the request type
-            if( requestType.c_str() == NULL ) {
-               s += "''";
-            }
-            else {
-                s += "'";
-                s += requestType;
-                s += "'";
-            }
-            s += ", ";
+        m_store->append( message );
+        pthread_mutex_unlock( &m_storeMutex );
+#ifdef VERBOSE
+        printf("insert %s (%lu bytes%s) as message %d\n", path.c_str(), (unsigned long)postdataBytes, message.codec.length() > 0 ? ", compressed" : "", message.id);
+#endif
 
-            // Check the Core Callback key
-            if( coreCB.c_str() == NULL ) {
-               s += "''";
-            }
-            else {
-                s += "'";
-                s += coreCB;
-                s += "'";
-            }
-            s += ", ";
-            
-            // Check the postdata
-            if( postdata.c_str() == NULL ) {
-                s += "''";
-            }
-            else {
-                // Replace all ' characters with escapes: \'
-                string characterToSearch = "'";
-                string characterToReplace = "''";
-                string::size_type n = 0;
-                while( ( n = postdata.find( characterToSearch, n ) ) != string::npos ) {
-                    postdata.replace( n, 1, characterToReplace );
-                    n += 2;
-                }
+        // Debug display
+        displayTable( MSG_QUEUE_TABLE_NAME );
+    }
 
-                s += "'";
-                s += postdata;
-                s += "'";
-            }
-            s += ", ";
-            
-            // Check the content type
-            if( contentType == NULL ) {
-                s += "''";
-            }
-            else {
-                s += "'";
-                s += contentType;
-                s += "'";
-            }
-            s += ", 'ready'";
-            s += ");";
-        
-            // Execute the insertion
-            printf("SQL: %s\n", s.c_str());
-            nRows = m_db.execDML( s.c_str() );
-            printf("%d rows inserted\n", nRows);
-            printf("------------------------------------\n");
+    /**
+     * MSG_QUEUE operation.
+     *
+     * Removes an existing entry from MSG_QUEUE using the rowId.
+     */
+    void DataSync::removeFromMsgQ( int rowId ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_RemoveMessage, "" );
+            write->rowId = rowId;
+            queueWrite( write );
+            return;
+        }
 
-            // Set the message table size
-            m_messageTableSize++;
-            
-            // Debug display
-            displayTable( MSG_QUEUE_TABLE_NAME );
+        pthread_mutex_lock( &m_storeMutex );
+        m_store->remove( rowId );
+        pthread_mutex_unlock( &m_storeMutex );
+    }
+
+    /**
+     * MSG_QUEUE operation.
+     *
+     * Updates the status of an existing entry in MSG_QUEUE using the rowId.
+     */
+    void DataSync::updateMessageStatus( int rowId, string status ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_MessageStatus, "" );
+            write->rowId = rowId;
+            write->value = status;
+            queueWrite( write );
+            return;
         }
-        catch( CppSQLite3Exception e ) {
-            m_core->displayError( "DataSync::addToMsgQ()", e.errorMessage() );
-            cout << "Exception in addToMsgQ() " << e.errorMessage() << " (" << e.errorCode() << ")" << endl;
+
+        // If the status is success, remove the entry from the queue
+        if( status == "success" ) {
+            //cout << "Successful request, removing entry from database." << endl;
+            removeFromMsgQ( rowId );
+        }
+        // Else, update the entry's status field
+        else {
+            pthread_mutex_lock( &m_storeMutex );
+            m_store->setStatus( rowId, status );
+            pthread_mutex_unlock( &m_storeMutex );
         }
     }
 
     /**
      * MSG_QUEUE operation.
      *
-     * Removes an existing entry from MSG_QUEUE using the rowId.
+     * Returns the current size of the message queue table.
      */
-    void DataSync::removeFromMsgQ( int rowId ) {
-        try {
-            int r = 0;
-            // string stream
-            string s = "";
-            char t[255];
-            
-            // Remove the entry at rowId
-            s += "delete from ";
-            s += MSG_QUEUE_TABLE_NAME;
-            s += " where id=";
-            sprintf(t, "%d", rowId);
-            s += t;
-            //cout << "delete SQL: " << m_sql << endl;
-            r = m_db.execDML( s.c_str() );
-            //printf("Deleting result: %d\n", r);
-
-            // Set the message table size
-            m_messageTableSize--;
+    int DataSync::getMessageTableSize() {
+        // Nothing is counted until storage is ready
+        if( !m_storageReady ) {
+            return 0;
         }
-        catch( CppSQLite3Exception e ) {
-            m_core->displayError( "DataSync::removeFromMsgQ()", e.errorMessage() );
-            printf("Exception in removeFromMsgQ() %s (%d)\n", e.errorMessage(), e.errorCode());
+        pthread_mutex_lock( &m_storeMutex );
+        int count = m_store->getCount();
+        pthread_mutex_unlock( &m_storeMutex );
+        return count;
+    }
+
+    /**
+     * MSG_QUEUE operation.
+     *
+     * Returns the number of rows and bytes evicted to keep the queue under its caps,
+     * and the number of new rows that were dropped instead.
+     */
+    int DataSync::getEvictedMessageCount() {
+        return m_evictedMessages;
+    }
+    int DataSync::getEvictedMessageBytes() {
+        return (int)m_evictedBytes;
+    }
+    int DataSync::getDroppedMessageCount() {
+        return m_droppedMessages;
+    }
+
+    /**
+     * MSG_QUEUE operation.
+     *
+     * Reads up to limit messages with an id greater than afterId. The store is only
+     * used on the storage writer thread, so other threads wait for it there.
+     */
+    bool DataSync::readMsgQ( int afterId, int limit, vector<glQueuedMessage>& messages ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_ReadMessages, "" );
+            write->rowId = afterId;
+            write->number = limit;
+            write->out = &messages;
+            waitForWrite( write );
+            bool result = write->result;
+            delete write;
+            return result;
         }
+
+        pthread_mutex_lock( &m_storeMutex );
+        bool result = m_store->readAfter( afterId, limit, messages );
+        pthread_mutex_unlock( &m_storeMutex );
+        return result;
     }
 
     /**
      * MSG_QUEUE operation.
      *
-     * Updates the status of an existing entry in MSG_QUEUE using the rowId.
+     * Switches the storage backend of the message queue. Queued messages are moved
+     * to the new backend with their ids, so requests in flight still resolve, and
+     * messages the new backend already held are renumbered. If a message cannot be
+     * moved the current backend is kept as it was. The choice is stored in CONFIG.
      */
-    void DataSync::updateMessageStatus( int rowId, string status ) {
-        try {
-            // If the status is success, remove the entry from the db
-            if( status == "success" ) {
-                //cout << "Successful request, removing entry from database." << endl;
-                removeFromMsgQ( rowId );
+    void DataSync::setMessageStore( int type ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_MessageStore, "" );
+            write->number = type;
+            queueWrite( write );
+            return;
+        }
+
+        if( type == m_storeType ) {
+            return;
+        }
+        if( m_inMemory && type == Const::QueueStore_Log ) {
+            m_core->displayWarning( "DataSync::setMessageStore()", "The message log is not available for an in-memory database." );
+            return;
+        }
+
+        MessageStore* store;
+        if( type == Const::QueueStore_Log ) {
+            store = new LogMessageStore( m_core, m_dbName + ".msgq" );
+        }
+        else {
+            type = Const::QueueStore_SQLite;
+            store = new SQLiteMessageStore( m_core, &m_db );
+        }
+
+        if( !store->open() ) {
+            m_core->displayError( "DataSync::setMessageStore()", "The message store could not be opened, keeping the current one." );
+            delete store;
+            return;
+        }
+
+        // Move the queued messages over in batches
+        vector<glQueuedMessage> messages;
+        vector<int> moved;
+        bool failed = false;
+        int afterId = 0;
+        while( !failed && m_store->readAfter( afterId, 256, messages ) && messages.size() > 0 ) {
+            for( size_t i = 0; i < messages.size() && !failed; i++ ) {
+                afterId = messages[ i ].id;
+                failed = !store->append( messages[ i ] );
+                if( !failed ) {
+                    moved.push_back( messages[ i ].id );
+                }
             }
-            // Else, update the entry's status field
-            else {
-                // string stream
-                string s = "";
-                char t[255];
+        }
 
-                // Execute the update operation
-                s += "UPDATE ";
-                s += MSG_QUEUE_TABLE_NAME;
-                s += " SET status='";
-                s += status;
-                s += "' WHERE id='";
-                sprintf(t, "%d", rowId);
-                s += t;
-                s += "'";
-                
-                //printf("update SQL: %s\n", s.c_str());
-                int r = m_db.execDML( s.c_str() );
-                //cout << "Updating result: " << r << endl;
+        if( failed ) {
+            m_core->displayError( "DataSync::setMessageStore()", "A queued message could not be moved, keeping the current message store." );
+            for( size_t i = 0; i < moved.size(); i++ ) {
+                store->remove( moved[ i ] );
             }
+            delete store;
+            return;
         }
-        catch( CppSQLite3Exception e ) {
-            m_core->displayError( "DataSync::updateMessageStatus()", e.errorMessage() );
-            //cout << "Exception in updateMessageStatus() " << e.errorMessage() << " (" << e.errorCode() << ")" << endl;
+
+        // Only what was moved leaves the old backend
+        for( size_t i = 0; i < moved.size(); i++ ) {
+            m_store->remove( moved[ i ] );
         }
+
+        pthread_mutex_lock( &m_storeMutex );
+        MessageStore* oldStore = m_store;
+        m_store = store;
+        m_storeType = type;
+        pthread_mutex_unlock( &m_storeMutex );
+        delete oldStore;
+
+        storeMessageStoreType( type );
     }
 
     /**
      * MSG_QUEUE operation.
      *
-     * Returns the current size of the message queue table.
+     * Returns the storage backend of the message queue (Const::QueueStore).
      */
-    int DataSync::getMessageTableSize() {
-        return m_messageTableSize;
+    int DataSync::getMessageStore() {
+        return m_storeType;
+    }
+
+    /**
+     * MSG_QUEUE operation.
+     *
+     * Makes room for a new row under the row cap (DB_MESSAGE_CAP) and the byte cap
+     * (config.eventsQueueMaxBytes) using config.eventsQueuePolicy. Returns false if
+     * the new row should be dropped instead, nothing is evicted then.
+     */
+    bool DataSync::makeRoomInMsgQ( int64_t incomingBytes ) {
+        glConfig config = m_core->mf_getConfig();
+        int64_t maxBytes = config.eventsQueueMaxBytes;
+        if( maxBytes > 0 && incomingBytes > maxBytes ) {
+            return false;
+        }
+
+        int rows = m_store->getCount() + 1 - DB_MESSAGE_CAP;
+        int64_t bytes = maxBytes > 0 ? m_store->getBytes() + incomingBytes - maxBytes : 0;
+        if( rows <= 0 && bytes <= 0 ) {
+            return true;
+        }
+
+        // Session, achievement and save rows are never evicted, only old telemetry
+        if( config.eventsQueuePolicy == Const::QueuePolicy_DropNewest ) {
+            return false;
+        }
+        return evictFromMsgQ( rows, bytes );
+    }
+
+    /**
+     * MSG_QUEUE operation.
+     *
+     * Removes the oldest telemetry rows to free the given number of rows and bytes,
+     * skipping rows with a request in flight. Nothing is removed and false is returned
+     * if the telemetry queued is not enough.
+     */
+    bool DataSync::evictFromMsgQ( int rows, int64_t bytes ) {
+        int64_t evictedBytes = 0;
+        int evictedRows = m_store->evict( rows, bytes, evictedBytes );
+        if( evictedRows == 0 ) {
+            return false;
+        }
+
+        m_evictedMessages += evictedRows;
+        m_evictedBytes += evictedBytes;
+
+        char t[32];
+        sprintf( t, "%d", evictedRows );
+        m_core->logMessage( "MSG_QUEUE cap reached, evicted telemetry rows:", t );
+        return true;
+    }
+
+    /**
+     * MSG_QUEUE operation.
+     *
+     * Compresses postdata with zlib for storage, the result is also a valid HTTP
+     * "deflate" body. Returns false when the SDK is built without ZLIB_COMPRESSION.
+     */
+    bool DataSync::compressPostdata( const string& postdata, string& out ) {
+#ifdef ZLIB_COMPRESSION
+        uLongf size = compressBound( (uLong)postdata.size() );
+        out.resize( size );
+        if( compress2( (Bytef*)&out[ 0 ], &size, (const Bytef*)postdata.data(), (uLong)postdata.size(), Z_DEFAULT_COMPRESSION ) != Z_OK ) {
+            return false;
+        }
+        out.resize( size );
+        return true;
+#else
+        (void)postdata;
+        (void)out;
+        return false;
+#endif
+    }
+
+    /**
+     * MSG_QUEUE operation.
+     *
+     * Restores postdata stored with compressPostdata.
+     */
+    bool DataSync::decompressPostdata( const unsigned char* data, int size, string& out ) {
+#ifdef ZLIB_COMPRESSION
+        z_stream stream;
+        memset( &stream, 0, sizeof( stream ) );
+        if( inflateInit( &stream ) != Z_OK ) {
+            return false;
+        }
+
+        stream.next_in = (Bytef*)data;
+        stream.avail_in = (uInt)size;
+
+        char chunk[ 16 * 1024 ];
+        int result = Z_OK;
+        out.clear();
+        while( result == Z_OK ) {
+            stream.next_out = (Bytef*)chunk;
+            stream.avail_out = sizeof( chunk );
+            result = inflate( &stream, Z_NO_FLUSH );
+            out.append( chunk, sizeof( chunk ) - stream.avail_out );
+        }
+        inflateEnd( &stream );
+        return result == Z_STREAM_END;
+#else
+        (void)data;
+        (void)size;
+        (void)out;
+        return false;
+#endif
     }
 
 
@@ -515,6 +762,13 @@ namespace nsGlasslabSDK {
      * the cookie and deviceId.
      */
     void DataSync::updateSessionTableWithCookie( string deviceId, string cookie ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_SessionCookie, deviceId );
+            write->value = cookie;
+            queueWrite( write );
+            return;
+        }
+
         // string stream
         string s = "";
         
@@ -584,6 +838,13 @@ namespace nsGlasslabSDK {
      * the gameSessionId and deviceId.
      */
     void DataSync::updateSessionTableWithGameSessionId( string deviceId, string gameSessionId ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_SessionGameSessionId, deviceId );
+            write->value = gameSessionId;
+            queueWrite( write );
+            return;
+        }
+
         // string stream
         string s;
         
@@ -654,6 +915,11 @@ namespace nsGlasslabSDK {
      * the deviceId. The new deviceId will include a player handle, in the form of "handle_deviceId".
      */
     void DataSync::updateSessionTableWithPlayerHandle( string deviceIdWithHandle ) {
+        if( deferWrites() ) {
+            queueWrite( newWrite( WriteOp_SessionPlayerHandle, deviceIdWithHandle ) );
+            return;
+        }
+
         // string stream
         string s = "";
         
@@ -706,6 +972,11 @@ namespace nsGlasslabSDK {
      * Removes the session entry associated with the parameter deviceId.
      */
     void DataSync::removeSessionWithDeviceId( string deviceId ) {
+        if( deferWrites() ) {
+            queueWrite( newWrite( WriteOp_RemoveSession, deviceId ) );
+            return;
+        }
+
         try {
             string s = "";
             // Remove the entry with the associated deviceId
@@ -727,70 +998,31 @@ namespace nsGlasslabSDK {
     /**
      * SESSION operation.
      *
-     * Gets a cookie stored in the SESSION table using the deviceId.
+     * Updates an existing session with player info, including total time played and the current game session event order.
      */
-    const char* DataSync::getCookieFromDeviceId( string deviceId ) {
+    void DataSync::updatePlayerInfoFromDeviceId( string deviceId, float totalTimePlayed, int gameSessionEventOrder ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_PlayerInfo, deviceId );
+            write->totalTimePlayed = totalTimePlayed;
+            write->gameSessionEventOrder = gameSessionEventOrder;
+            queueWrite( write );
+            return;
+        }
+
         // string stream
-        string s = "";
-        string cookie = "";
+        string s;
+        char t[255];
         
         try {
-            // Display the session table
-            displayTable( SESSION_TABLE_NAME );
-            
             // Look for an existing entry with the device Id
+            //printf("------------------------------------\n");
+            s = "";
             s += "select * from ";
             s += SESSION_TABLE_NAME;
             s += " where deviceId='";
             s += deviceId;
             s += "';";
-            CppSQLite3Query sessionQuery = m_db.execQuery( s.c_str() );
-            
-            // If the count is 0, no entry exists with deviceId, return an empty string
-            // The empty string will tell the next get request that we need one to store
-            if( sessionQuery.eof() ) {
-                cout << "no cookie exists for " << deviceId.c_str() << endl;
-            }
-            // An entry does exist, grab the cookie and return it
-            else {
-                cookie = sessionQuery.fieldValue( 0 );
-                cout << "cookie exists for " << deviceId.c_str() << ": " << cookie.c_str() << endl;
-            }
-            
-            // Finalize the query
-            sessionQuery.finalize();
-            
-            return cookie.c_str();
-        }
-        catch( CppSQLite3Exception e ) {
-            m_core->displayError( "DataSync::getCookieFromDeviceId()", e.errorMessage() );
-            //cout << "Exception in getCookieFromDeviceId() " << e.errorMessage() << " (" << e.errorCode() << ")" << endl;
-        }
-
-        // Return empty string by default
-        return "";
-    }
-
-    /**
-     * SESSION operation.
-     *
-     * Updates an existing session with player info, including total time played and the current game session event order.
-     */
-    void DataSync::updatePlayerInfoFromDeviceId( string deviceId, float totalTimePlayed, int gameSessionEventOrder ) {
-        // string stream
-        string s;
-        char t[255];
-        
-        try {
-            // Look for an existing entry with the device Id
-            //printf("------------------------------------\n");
-            s = "";
-            s += "select * from ";
-            s += SESSION_TABLE_NAME;
-            s += " where deviceId='";
-            s += deviceId;
-            s += "';";
-            //cout << "session SQL: " << m_sql << endl;
+            //cout << "session SQL: " << m_sql << endl;
             CppSQLite3Query sessionQuery = m_db.execQuery( s.c_str() );
 
             // Only continue if an entry exists
@@ -824,53 +1056,19 @@ namespace nsGlasslabSDK {
         }
     }
 
-    /**
-     * SESSION operation.
-     *
-     * Get the totalTimePlayed stored in the SESSION table using the deviceId.
-     */
-    float DataSync::getTotalTimePlayedFromDeviceId( string deviceId ) {
-        try {
-            float totalTimePlayed = 0;
-            string s = "";
-            // Look for an existing entry with the device Id
-            s += "select * from ";
-            s += SESSION_TABLE_NAME;
-            s += " where deviceId='";
-            s += deviceId;
-            s += "';";
-            CppSQLite3Query sessionQuery = m_db.execQuery( s.c_str() );
-
-            // If the count is 0, no entry exists with deviceId, return a default value of 0.0
-            if( sessionQuery.eof() ) {
-                cout << "totalTimePlayed does not exist for " << deviceId.c_str() << endl;
-            }
-            // An entry does exist, grab the totalTimePlayed and return it
-            else if( sessionQuery.fieldValue( 4 ) != NULL ) {
-                totalTimePlayed = atof( sessionQuery.fieldValue( 4 ) );
-                cout << "totalTimePlayed exists for " << deviceId.c_str() << ": " << totalTimePlayed << endl;
-            }
-            
-            // Finalize the query
-            sessionQuery.finalize();
-
-            return totalTimePlayed;
-        }
-        catch( CppSQLite3Exception e ) {
-            m_core->displayError( "DataSync::getTotalTimePlayedFromDeviceId()", e.errorMessage() );
-            //cout << "Exception in getTotalTimePlayedFromDeviceId() " << e.errorMessage() << " (" << e.errorCode() << ")" << endl;
-        }
-
-        // Return 0.0 by default
-        return 0.0;
-    }
-
     /**
      * SESSION operation.
      *
      * Update the gameSessionEventOrder stored in the SESSION table using the deviceId.
      */
     void DataSync::updateGameSessionEventOrderWithDeviceId( string deviceId, int gameSessionEventOrder ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_EventOrder, deviceId );
+            write->gameSessionEventOrder = gameSessionEventOrder;
+            queueWrite( write );
+            return;
+        }
+
         // string stream
         string s = "";
         char t[255];
@@ -899,42 +1097,35 @@ namespace nsGlasslabSDK {
     /**
      * SESSION operation.
      *
-     * Get the gameSessionEventOrder stored in the SESSION table using the deviceId.
+     * Gets every entry of the SESSION table by deviceId. Core keeps them in memory and
+     * only reads them when storage is ready or a snapshot was restored.
      */
-    int DataSync::getGameSessionEventOrderFromDeviceId( string deviceId ) {
-        try {
-            int gameSessionEventOrder = 1;
-            string s = "";
-            // Look for an existing entry with the device Id
-            s += "select * from ";
-            s += SESSION_TABLE_NAME;
-            s += " where deviceId='";
-            s += deviceId;
-            s += "';";
-            CppSQLite3Query sessionQuery = m_db.execQuery( s.c_str() );
+    void DataSync::getSessions( map<string, glSession>& sessions ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_ReadSessions, "" );
+            write->out = &sessions;
+            waitForWrite( write );
+            delete write;
+            return;
+        }
 
-            // If the count is 0, no entry exists with deviceId, return a default value of 1
-            if( sessionQuery.eof() ) {
-                //cout << "gameSessionEventOrder does not exist for " << deviceId.c_str() << endl;
-            }
-            // An entry does exist, grab the gameSessionEventOrder and return it
-            else if( sessionQuery.fieldValue( 3 ) != NULL ) {
-                gameSessionEventOrder = atoi( sessionQuery.fieldValue( 3 ) );
-                //cout << "gameSessionEventOrder exists for " << deviceId.c_str() << ": " << gameSessionEventOrder << endl;
+        try {
+            CppSQLite3Query q = m_db.execQuery( "select cookie, deviceId, gameSessionId, gameSessionEventOrder, totalTimePlayed from " SESSION_TABLE_NAME ";" );
+            while( !q.eof() ) {
+                glSession session;
+                session.cookie = q.getStringField( 0 );
+                session.gameSessionId = q.getStringField( 2 );
+                session.gameSessionEventOrder = q.getIntField( 3, 1 );
+                session.totalTimePlayed = (float)q.getFloatField( 4, 0.0 );
+                session.fields = 0;
+                sessions[ q.getStringField( 1 ) ] = session;
+                q.nextRow();
             }
-            
-            // Finalize the query
-            sessionQuery.finalize();
-            
-            return gameSessionEventOrder;
+            q.finalize();
         }
         catch( CppSQLite3Exception e ) {
-            m_core->displayError( "DataSync::getGameSessionEventOrderFromDeviceId()", e.errorMessage() );
-            //cout << "Exception in getGameSessionEventOrderFromDeviceId() " << e.errorMessage() << " (" << e.errorCode() << ")" << endl;
+            m_core->displayError( "DataSync::getSessions()", e.errorMessage() );
         }
-
-        // Return 1 by default
-        return 1;
     }
 
     /**
@@ -1008,6 +1199,456 @@ namespace nsGlasslabSDK {
         return "";
     }
 
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * CONFIG operation.
+     *
+     * Stores the last good server config JSON and the URI it was retrieved from, keyed by
+     * the bootstrap URI and gameId connect() was given, so the next start can use them
+     * before the connect handshake completes. An empty config forgets them.
+     */
+    void DataSync::storeServerConfig( string bootstrapUri, string gameId, string uri, string config ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_ServerConfig, "" );
+            write->bootstrapUri = bootstrapUri;
+            write->gameId = gameId;
+            write->path = uri;
+            write->postdata = config;
+            queueWrite( write );
+            return;
+        }
+
+        try {
+            CppSQLite3Statement update = m_db.compileStatement( "update " CONFIG_TABLE_NAME " set bootstrapUri=?, gameId=?, uri=?, serverConfig=?;" );
+            update.bind( 1, bootstrapUri.c_str() );
+            update.bind( 2, gameId.c_str() );
+            update.bind( 3, uri.c_str() );
+            if( config.length() > 0 ) {
+                update.bind( 4, config.c_str() );
+            }
+            else {
+                update.bindNull( 4 );
+            }
+            update.execDML();
+            update.finalize();
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "DataSync::storeServerConfig()", e.errorMessage() );
+        }
+    }
+
+    /**
+     * CONFIG operation.
+     *
+     * Gets the stored server config and URI, if they were stored for this bootstrap URI
+     * and gameId. Returns false if there are none, a config from another server or game
+     * does not apply.
+     */
+    bool DataSync::getServerConfig( string bootstrapUri, string gameId, string& uri, string& config ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_ReadServerConfig, "" );
+            write->bootstrapUri = bootstrapUri;
+            write->gameId = gameId;
+            waitForWrite( write );
+            bool found = write->result;
+            uri = write->path;
+            config = write->postdata;
+            delete write;
+            return found;
+        }
+
+        bool found = false;
+        try {
+            CppSQLite3Statement select = m_db.compileStatement( "select uri, serverConfig from " CONFIG_TABLE_NAME " where bootstrapUri=? and gameId=?;" );
+            select.bind( 1, bootstrapUri.c_str() );
+            select.bind( 2, gameId.c_str() );
+            CppSQLite3Query q = select.execQuery();
+            if( !q.eof() && !q.fieldIsNull( 1 ) ) {
+                uri = q.getStringField( 0 );
+                config = q.getStringField( 1 );
+                found = uri.length() > 0 && config.length() > 0;
+            }
+            q.finalize();
+            select.finalize();
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "DataSync::getServerConfig()", e.errorMessage() );
+        }
+
+        return found;
+    }
+
+    /**
+     * RESPONSE_CACHE operation.
+     *
+     * Gets the cached response stored under the key. Returns false if there is none.
+     */
+    bool DataSync::getCachedResponse( string key, glCachedResponse& response ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_ReadCache, "" );
+            write->path = key;
+            write->out = &response;
+            waitForWrite( write );
+            bool found = write->result;
+            delete write;
+            return found;
+        }
+
+        bool found = false;
+        try {
+            CppSQLite3Statement select = m_db.compileStatement( "select etag, lastModified, body, storedAt from "
+                RESPONSE_CACHE_TABLE_NAME " where key=?;" );
+            select.bind( 1, key.c_str() );
+            CppSQLite3Query q = select.execQuery();
+            if( !q.eof() ) {
+                response.etag = q.getStringField( 0 );
+                response.lastModified = q.getStringField( 1 );
+                response.body = q.getStringField( 2 );
+                response.storedAt = (time_t)q.getInt64Field( 3 );
+                found = true;
+            }
+            q.finalize();
+            select.finalize();
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "DataSync::getCachedResponse()", e.errorMessage() );
+        }
+
+        return found;
+    }
+
+    /**
+     * RESPONSE_CACHE operation.
+     *
+     * Stores a response body with its validators, replacing any previous entry for the key.
+     */
+    void DataSync::storeCachedResponse( string key, string etag, string lastModified, string body ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_CacheResponse, "" );
+            write->path = key;
+            write->value = etag;
+            write->lastModified = lastModified;
+            write->postdata = body;
+            queueWrite( write );
+            return;
+        }
+
+        try {
+            CppSQLite3Statement insert = m_db.compileStatement( "insert or replace into " RESPONSE_CACHE_TABLE_NAME
+                " (key, etag, lastModified, body, storedAt) VALUES (?, ?, ?, ?, ?);" );
+            insert.bind( 1, key.c_str() );
+            insert.bind( 2, etag.c_str() );
+            insert.bind( 3, lastModified.c_str() );
+            insert.bind( 4, body.c_str() );
+            insert.bind( 5, (double)time( NULL ) );
+            insert.execDML();
+            insert.finalize();
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "DataSync::storeCachedResponse()", e.errorMessage() );
+        }
+    }
+
+    /**
+     * RESPONSE_CACHE operation.
+     *
+     * Marks a cached response as fresh again after the server answered 304 Not Modified.
+     */
+    void DataSync::touchCachedResponse( string key ) {
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_CacheTouch, "" );
+            write->path = key;
+            queueWrite( write );
+            return;
+        }
+
+        try {
+            CppSQLite3Statement update = m_db.compileStatement( "update " RESPONSE_CACHE_TABLE_NAME " set storedAt=? where key=?;" );
+            update.bind( 1, (double)time( NULL ) );
+            update.bind( 2, key.c_str() );
+            update.execDML();
+            update.finalize();
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "DataSync::touchCachedResponse()", e.errorMessage() );
+        }
+    }
+
+    /**
+     * RESPONSE_CACHE operation.
+     *
+     * Removes every cached response.
+     */
+    void DataSync::clearResponseCache() {
+        if( deferWrites() ) {
+            queueWrite( newWrite( WriteOp_CacheClear, "" ) );
+            return;
+        }
+
+        try {
+            m_db.execDML( "delete from " RESPONSE_CACHE_TABLE_NAME ";" );
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "DataSync::clearResponseCache()", e.errorMessage() );
+        }
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * startWriterThread - starts the thread that initializes storage and then applies
+     * the writes queued by deferWrites(), so SQLite I/O does not run on the game thread.
+     * Returns:
+     *  0 on success
+     *  1 on failure due to thread already being started
+     *  2 on failure due to inability to start thread
+     */
+    int DataSync::startWriterThread() {
+        if( m_writerStarted ) {
+            return 1;
+        }
+
+        pthread_mutex_init( &m_writeQueueMutex, NULL );
+        pthread_cond_init( &m_writeQueueCondition, NULL );
+        pthread_cond_init( &m_writeIdleCondition, NULL );
+        m_writerStopping = false;
+
+        int pthreadError = pthread_create( &m_writerThread, NULL, proc_storageWriter, (void*)this );
+        if( pthreadError != 0 ) {
+            char errorStr[256];
+            sprintf( errorStr, "ERROR: Could not create pthread in startWriterThread - Error code: %i", pthreadError );
+            m_core->logMessage( errorStr );
+
+            pthread_cond_destroy( &m_writeIdleCondition );
+            pthread_cond_destroy( &m_writeQueueCondition );
+            pthread_mutex_destroy( &m_writeQueueMutex );
+            return 2;
+        }
+
+        m_writerStarted = true;
+        return 0;
+    }
+
+    /**
+     * Function lets the writer thread apply the remaining writes, then joins it.
+     * Later writes are made on the calling thread.
+     */
+    void DataSync::stopWriterThread() {
+        if( !m_writerStarted ) {
+            return;
+        }
+
+        pthread_mutex_lock( &m_writeQueueMutex );
+        m_writerStopping = true;
+        pthread_cond_broadcast( &m_writeQueueCondition );
+        pthread_mutex_unlock( &m_writeQueueMutex );
+
+        pthread_join( m_writerThread, NULL );
+        m_writerStarted = false;
+
+        pthread_cond_destroy( &m_writeIdleCondition );
+        pthread_cond_destroy( &m_writeQueueCondition );
+        pthread_mutex_destroy( &m_writeQueueMutex );
+    }
+
+    /**
+     * Function returns true if a write should be queued for the writer thread
+     * rather than made on the calling thread.
+     */
+    bool DataSync::deferWrites() {
+        return m_writerStarted && !pthread_equal( pthread_self(), m_writerThread );
+    }
+
+    DataSync::StorageWrite* DataSync::newWrite( WriteOp op, string deviceId ) {
+        StorageWrite* write = new StorageWrite();
+        write->op = op;
+        write->deviceId = deviceId;
+        write->coreCB = Const::Callback_None;
+        write->rowId = 0;
+        write->totalTimePlayed = 0;
+        write->gameSessionEventOrder = 0;
+        write->number = 0;
+        write->out = NULL;
+        write->result = false;
+        write->wait = false;
+        write->done = false;
+        return write;
+    }
+
+    void DataSync::queueWrite( StorageWrite* write ) {
+        pthread_mutex_lock( &m_writeQueueMutex );
+        bool shouldTriggerWriterThread = m_writeQueue.size() == 0;
+        m_writeQueue.push( write );
+        pthread_mutex_unlock( &m_writeQueueMutex );
+
+        // If we had no writes before, the writer thread is waiting. Wake it.
+        if( shouldTriggerWriterThread ) {
+            pthread_cond_broadcast( &m_writeQueueCondition );
+        }
+    }
+
+    /**
+     * Function queues a read and blocks until the writer thread has made it, after the
+     * writes queued before it. The database and the message store are only used on
+     * the writer thread. The caller deletes the write.
+     */
+    void DataSync::waitForWrite( StorageWrite* write ) {
+        write->wait = true;
+        queueWrite( write );
+
+        pthread_mutex_lock( &m_writeQueueMutex );
+        while( !write->done ) {
+            pthread_cond_wait( &m_writeIdleCondition, &m_writeQueueMutex );
+        }
+        pthread_mutex_unlock( &m_writeQueueMutex );
+    }
+
+    /**
+     * Function blocks until storage is ready and every write queued so far has been
+     * applied, e.g. before the application is suspended. Returns at once without the
+     * writer thread or when called from it.
+     */
+    void DataSync::flushWrites() {
+        if( !deferWrites() ) {
+            return;
+        }
+
+        pthread_mutex_lock( &m_writeQueueMutex );
+        while( !m_storageReady || m_writeQueue.size() > 0 || m_writerBusy ) {
+            pthread_cond_wait( &m_writeIdleCondition, &m_writeQueueMutex );
+        }
+        pthread_mutex_unlock( &m_writeQueueMutex );
+    }
+
+    /**
+     * Function makes a queued write, on the writer thread the public functions
+     * write directly.
+     */
+    void DataSync::applyWrite( StorageWrite* write ) {
+        switch( write->op ) {
+            case WriteOp_AddMessage:
+                addToMsgQ( write->deviceId, write->path, write->requestType, write->coreCB, write->postdata, write->contentType.c_str() );
+                break;
+            case WriteOp_RemoveMessage:
+                removeFromMsgQ( write->rowId );
+                break;
+            case WriteOp_MessageStatus:
+                updateMessageStatus( write->rowId, write->value );
+                break;
+            case WriteOp_SessionCookie:
+                updateSessionTableWithCookie( write->deviceId, write->value );
+                break;
+            case WriteOp_SessionGameSessionId:
+                updateSessionTableWithGameSessionId( write->deviceId, write->value );
+                break;
+            case WriteOp_SessionPlayerHandle:
+                updateSessionTableWithPlayerHandle( write->deviceId );
+                break;
+            case WriteOp_RemoveSession:
+                removeSessionWithDeviceId( write->deviceId );
+                break;
+            case WriteOp_PlayerInfo:
+                updatePlayerInfoFromDeviceId( write->deviceId, write->totalTimePlayed, write->gameSessionEventOrder );
+                break;
+            case WriteOp_EventOrder:
+                updateGameSessionEventOrderWithDeviceId( write->deviceId, write->gameSessionEventOrder );
+                break;
+            case WriteOp_CacheResponse:
+                storeCachedResponse( write->path, write->value, write->lastModified, write->postdata );
+                break;
+            case WriteOp_CacheTouch:
+                touchCachedResponse( write->path );
+                break;
+            case WriteOp_CacheClear:
+                clearResponseCache();
+                break;
+            case WriteOp_ServerConfig:
+                storeServerConfig( write->bootstrapUri, write->gameId, write->path, write->postdata );
+                break;
+            case WriteOp_MessageStore:
+                setMessageStore( write->number );
+                break;
+            case WriteOp_ResetDatabase:
+                resetDatabase();
+                break;
+            case WriteOp_SetSnapshot:
+                setSnapshot( write->path.c_str(), write->number );
+                break;
+            case WriteOp_ReadMessages:
+                write->result = readMsgQ( write->rowId, write->number, *(vector<glQueuedMessage>*)write->out );
+                break;
+            case WriteOp_ReadSessions:
+                getSessions( *(map<string, glSession>*)write->out );
+                break;
+            case WriteOp_ReadServerConfig:
+                write->result = getServerConfig( write->bootstrapUri, write->gameId, write->path, write->postdata );
+                break;
+            case WriteOp_ReadCache:
+                write->result = getCachedResponse( write->path, *(glCachedResponse*)write->out );
+                break;
+            case WriteOp_Snapshot:
+                write->result = snapshotDatabase();
+                break;
+        }
+    }
+
+    /**
+     * proc_storageWriter is a THREADED STATIC function that takes in a DataSync instance.
+     * It initializes storage, then applies the queued writes one-by-one in the order they
+     * were made, waiting on m_writeQueueCondition when there are none, until
+     * stopWriterThread() is called.
+     */
+    void* DataSync::proc_storageWriter( void* dataSync ) {
+        DataSync* pDataSync = static_cast<DataSync*>( dataSync );
+
+        // Writes made while this runs stay queued
+        pDataSync->initStorage();
+        pthread_mutex_lock( &pDataSync->m_writeQueueMutex );
+        pDataSync->m_storageReady = true;
+        pthread_mutex_unlock( &pDataSync->m_writeQueueMutex );
+        pDataSync->m_core->mf_storageReady();
+
+        pthread_mutex_lock( &pDataSync->m_writeQueueMutex );
+        for( ;; ) {
+            // Let flushWrites() return once everything is applied
+            if( pDataSync->m_writeQueue.size() == 0 ) {
+                pthread_cond_broadcast( &pDataSync->m_writeIdleCondition );
+                if( pDataSync->m_writerStopping ) {
+                    break;
+                }
+                pthread_cond_wait( &pDataSync->m_writeQueueCondition, &pDataSync->m_writeQueueMutex );
+                continue;
+            }
+
+            StorageWrite* write = pDataSync->m_writeQueue.front();
+            pDataSync->m_writeQueue.pop();
+            pDataSync->m_writerBusy = true;
+            pthread_mutex_unlock( &pDataSync->m_writeQueueMutex );
+
+            pDataSync->applyWrite( write );
+
+            pthread_mutex_lock( &pDataSync->m_writeQueueMutex );
+            pDataSync->m_writerBusy = false;
+
+            // A waiting reader takes its write back
+            if( write->wait ) {
+                write->done = true;
+                pthread_cond_broadcast( &pDataSync->m_writeIdleCondition );
+            }
+            else {
+                delete write;
+            }
+        }
+        pthread_mutex_unlock( &pDataSync->m_writeQueueMutex );
+
+        return NULL;
+    }
+
     void DataSync::doFlushMsgQ()
     {
 #ifdef MULTITHREADED
@@ -1029,30 +1670,33 @@ namespace nsGlasslabSDK {
      */
     void DataSync::flushMsgQ() {
         try {
-            char t[255];
             string s;
             // Begin display out
             //cout << "\n\n\n-----------------------------------" << endl;
             //printf("\tflushing MSG_QUEUE: %d\n", m_messageTableSize);
             //m_core->logMessage( "flushing MSG_QUEUE" );
 
-            // Select all entries in MSG_QUEUE
-            s = "select * from " MSG_QUEUE_TABLE_NAME ";";
-            //printf("msgQ SQL: %s\n", s.c_str());
-            CppSQLite3Query msgQuery = m_db.execQuery( s.c_str() );
+            // Entries are read from the message store in id order, a batch at a time
+            vector<glQueuedMessage> messages;
+            size_t next = 0;
+            int afterId = 0;
 
             // Keep a counter for the number of requests made so we can limit it
             int requestsMade = 0;
+            glConfig config = m_core->mf_getConfig();
 
             // Iterate 
-            while ( !msgQuery.eof() )
+            while ( true )
             {
-                // Print the entry to consider
-                /*printf( "Entry: " );
-                for( int fld = 0; fld < msgQuery.numFields(); fld++ ) {
-                    printf( "value: %s", msgQuery.fieldValue( fld ) );
-                    printf( "|" );
-                }*/
+                // Get the next batch when this one is done
+                if( next >= messages.size() ) {
+                    if( !readMsgQ( afterId, 256, messages ) || messages.size() == 0 ) {
+                        break;
+                    }
+                    next = 0;
+                }
+                glQueuedMessage& message = messages[ next++ ];
+                afterId = message.id;
 
                 /*
                 This message will contain the following information:
@@ -1076,43 +1720,34 @@ namespace nsGlasslabSDK {
                 // Check the deviceId listed in the message for an entry in the SESSION table
                 // If the deviceId is empty, which should not open, we should skip this entry
                 // or remove it from MSG_QUEUE (?)
-                int rowId = atoi( msgQuery.fieldValue( 0 ) );
-                string deviceId = msgQuery.fieldValue( 1 );
+                int rowId = message.id;
+                string deviceId = message.deviceId;
                 if( deviceId.c_str() != NULL ) {
-                    // Select all entries in SESSION with deviceId
-                    displayTable( SESSION_TABLE_NAME );
-                    s = "select * from " SESSION_TABLE_NAME " where deviceId='";
-                    s += deviceId;
-                    s += "';";
-                    //printf("session SQL: %s\n", s.c_str());
-                    CppSQLite3Query sessionQuery = m_db.execQuery( s.c_str() );
+                    // Look up the session of deviceId, Core keeps the SESSION entries in memory
+                    glSession session;
 
                     // Only continue if we received an entry from SESSION
-                    if( !sessionQuery.eof() ) {
+                    if( m_core->mf_getSession( deviceId, session ) ) {
                         // Get the cookie field
-                        string cookie = sessionQuery.fieldValue( 0 );
+                        string cookie = session.cookie;
 
                         // Only continue if the cookie exists
                         if( cookie.c_str() != NULL ) {
                             //cout << "cookie is: " << cookie << endl;
                             
                             // Get the path from MSG_QUEUE
-                            string apiPath = msgQuery.fieldValue( 2 );
+                            string apiPath = message.path;
                             string requestType = "NULL";
-                            if( msgQuery.fieldValue( 3 ) != NULL ) {
-                                requestType = msgQuery.fieldValue( 3 );
+                            if( message.requestType.length() > 0 ) {
+                                requestType = message.requestType;
                             }
-                            string coreCB = msgQuery.fieldValue( 4 );
-                            //cout << "coreCB is: " << coreCB << endl;
+                            int coreCB = message.coreCB;
 
                             // We only care about startsession, endsession, and sendtelemetry
                             // Anything else should be ignored (and not present in the queue)
                             // Only continue with endsession and sendtelemetry if gameSessionId
                             // exists in the SESSION entry
-                            string gameSessionId = sessionQuery.fieldValue( 2 );
-                            
-                            // Finalize the query
-                            sessionQuery.finalize();
+                            string gameSessionId = session.gameSessionId;
                             
                             //cout << "game session Id is: " << gameSessionId << endl;
                             if( strstr( apiPath.c_str(), API_POST_SESSION_START ) ||
@@ -1127,12 +1762,35 @@ namespace nsGlasslabSDK {
                               ) {
 
                                 // Get the event information
-                                //string coreCB = msgQuery.fieldValue( 3 );
-                                string postdata = msgQuery.fieldValue( 5 );
-                                const char* contentType = msgQuery.fieldValue( 6 );
+                                string postdata;
+                                const char* contentType = message.contentType.c_str();
+                                const char* contentEncoding = NULL;
+                                bool binaryTelemetry = contentType != NULL && strcmp( contentType, TELEM_BINARY_CONTENT_TYPE ) == 0;
+                                bool rewritePostdata = binaryTelemetry || strstr( apiPath.c_str(), API_POST_SESSION_END ) || strstr( apiPath.c_str(), API_POST_EVENTS );
+
+                                // Compressed entries are forwarded as they are if the server accepts it and nothing needs replacing,
+                                // otherwise they are restored first and compressed again once rewritten
+                                if( message.codec == DB_MESSAGE_CODEC_DEFLATE ) {
+                                    if( config.eventsSendCompressed && !rewritePostdata ) {
+                                        postdata = message.postdata;
+                                        contentEncoding = "deflate";
+                                    }
+                                    else if( !decompressPostdata( (const unsigned char*)message.postdata.data(), (int)message.postdata.size(), postdata ) ) {
+                                        m_core->displayWarning( "DataSync::flushMsgQ()", "The entry could not be decompressed. Removing the entry from the queue." );
+                                        removeFromMsgQ( rowId );
+                                        continue;
+                                    }
+                                }
+                                else {
+                                    postdata = message.postdata;
+                                }
 
+                                // Binary telemetry is stored base64 encoded, decode it and add the header with the gameSessionId
+                                if( binaryTelemetry ) {
+                                    postdata = TelemetryBuffer::wrapBinary( TelemetryBuffer::fromBase64( postdata ), gameSessionId );
+                                }
                                 // If this is a telemetry event or end session, update the postdata to include the correct gameSessionId
-                                if( strstr( apiPath.c_str(), API_POST_SESSION_END ) || strstr( apiPath.c_str(), API_POST_EVENTS ) ) {
+                                else if( strstr( apiPath.c_str(), API_POST_SESSION_END ) || strstr( apiPath.c_str(), API_POST_EVENTS ) ) {
                                     string gameSessionIdTag = "$gameSessionId$";
 
                                     string::size_type n = 0;
@@ -1142,17 +1800,20 @@ namespace nsGlasslabSDK {
                                     }
                                 }
 
-                                // Update the entry's status field
-                                s = "UPDATE " MSG_QUEUE_TABLE_NAME " SET status='pending' WHERE ";
-                                sprintf(t, "id='%d'", rowId);
-                                s += t;
+                                // Entries stored as text, under DB_MESSAGE_COMPRESS_MIN_SIZE or not smaller compressed, are sent as text
+                                if( message.codec == DB_MESSAGE_CODEC_DEFLATE && contentEncoding == NULL && config.eventsSendCompressed ) {
+                                    string compressed;
+                                    if( compressPostdata( postdata, compressed ) && compressed.size() < postdata.size() ) {
+                                        postdata = compressed;
+                                        contentEncoding = "deflate";
+                                    }
+                                }
 
-                                //printf("update SQL: %s\n", s.c_str());
-                                int r = m_db.execDML( s.c_str() );
-                                //printf("Updating result: %d\n", r);
+                                // Update the entry's status field
+                                updateMessageStatus( rowId, "pending" );
                                 
                                 // Perform the get request using the message information
-                                m_core->mf_httpGetRequest( apiPath, requestType, coreCB, postdata, contentType, rowId );
+                                m_core->mf_httpGetRequest( apiPath, requestType, coreCB, postdata, contentType, rowId, contentEncoding );
                                 
                                 requestsMade++;
                             }
@@ -1178,25 +1839,24 @@ namespace nsGlasslabSDK {
 
                 // If we've exceeded the max number of requests we can make per flush, exit
                 // The next batch of events will be picked up during the next flush
-                if( requestsMade >= m_core->config.eventsMaxSize ) {
+                if( requestsMade >= config.eventsMaxSize ) {
                     cout << "Exceeded max number of requests we can make, exit." << endl;
                     break;
                 }
-
-                // Get the next row in MSG_QUEUE
-                //cout << "--- get the next entry in MSG_QUEUE ---" << endl;
-                msgQuery.nextRow();
             }
-            
-            // Finalize the query
-            msgQuery.finalize();
         }
         catch( CppSQLite3Exception e ) {
             m_core->displayError( "DataSync::flushMsgQ()", e.errorMessage() );
             //cout << "Exception in flushMsgQ() " << e.errorMessage() << " (" << e.errorCode() << ")" << endl;
         }
         
+#ifdef MULTITHREADED
         queueFlushRequested = false;
+#endif
+
+        // Snapshot the in-memory database on its timer
+        snapshotDatabaseIfDue();
+
         // End display out
         //cout << "reached the end of MSG_QUEUE" << endl;
         //cout << "-----------------------------------\n\n\n" << endl;
@@ -1213,8 +1873,23 @@ namespace nsGlasslabSDK {
      * Function resets all tables in the database and recreates them.
      */
     void DataSync::resetDatabase() {
+        // Reset after the writes queued so far
+        if( deferWrites() ) {
+            queueWrite( newWrite( WriteOp_ResetDatabase, "" ) );
+            return;
+        }
+
         dropTables();
         createTables();
+        storeMessageStoreType( m_storeType );
+
+        // Reload the queue counts, or empty the log segments
+        if( m_storeType == Const::QueueStore_SQLite ) {
+            m_store->open();
+        }
+        else {
+            m_store->clear();
+        }
     }
 
 
@@ -1222,11 +1897,193 @@ namespace nsGlasslabSDK {
     //--------------------------------------
     //--------------------------------------
     /**
-     * Function creates all tables used in the SDK.
+     * Function sets the file the in-memory database is snapshotted to, every
+     * intervalSecs seconds (0 for forced snapshots only). Anything queued in an
+     * existing snapshot is restored first, so events survive a restart.
      */
-    void DataSync::createTables() {
-        int r;
-        string s;
+    void DataSync::setSnapshot( const char* path, int intervalSecs ) {
+        if( !m_inMemory ) {
+            m_core->displayWarning( "DataSync::setSnapshot()", "Snapshots are only used by the in-memory database." );
+            return;
+        }
+
+        // The snapshot is restored into the initialized tables, after the writes queued so far
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_SetSnapshot, "" );
+            write->path = path != NULL ? path : "";
+            write->number = intervalSecs;
+            queueWrite( write );
+            return;
+        }
+
+        pthread_mutex_lock( &m_snapshotMutex );
+        m_snapshotPath = path != NULL ? path : "";
+        m_snapshotInterval = intervalSecs > 0 ? intervalSecs : 0;
+        m_lastSnapshot = time( NULL );
+        bool restored = m_snapshotPath.length() > 0 && restoreSnapshot();
+        pthread_mutex_unlock( &m_snapshotMutex );
+
+        // Hand the restored sessions to Core
+        if( restored ) {
+            map<string, glSession> sessions;
+            getSessions( sessions );
+            m_core->mf_mergeSessions( sessions );
+        }
+    }
+
+    /**
+     * Function copies the in-memory tables to the snapshot file in one transaction.
+     */
+    bool DataSync::snapshotDatabase() {
+        if( !m_inMemory ) {
+            return false;
+        }
+
+        // Snapshot after the writes queued so far
+        if( deferWrites() ) {
+            StorageWrite* write = newWrite( WriteOp_Snapshot, "" );
+            waitForWrite( write );
+            bool written = write->result;
+            delete write;
+            return written;
+        }
+
+        pthread_mutex_lock( &m_snapshotMutex );
+        if( m_snapshotPath.length() == 0 ) {
+            pthread_mutex_unlock( &m_snapshotMutex );
+            return false;
+        }
+
+        bool written = false;
+        try {
+            attachSnapshot();
+            m_db.execDML( "begin transaction;" );
+
+            // Recreate each table with the in-memory schema and copy the rows over
+            const char* tables[] = { CONFIG_TABLE_NAME, MSG_QUEUE_TABLE_NAME, SESSION_TABLE_NAME };
+            for( int i = 0; i < 3; i++ ) {
+                string table = tables[ i ];
+                string s = "select sql from main.sqlite_master where type='table' and name='" + table + "';";
+                CppSQLite3Query q = m_db.execQuery( s.c_str() );
+                string schema = q.eof() ? "" : q.getStringField( 0 );
+                q.finalize();
+
+                size_t columns = schema.find( '(' );
+                if( columns == string::npos ) {
+                    continue;
+                }
+                m_db.execDML( ( "drop table if exists snapshot." + table + ";" ).c_str() );
+                m_db.execDML( ( "create table snapshot." + table + " " + schema.substr( columns ) + ";" ).c_str() );
+                m_db.execDML( ( "insert into snapshot." + table + " select * from main." + table + ";" ).c_str() );
+            }
+
+            m_db.execDML( "commit transaction;" );
+            written = true;
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "DataSync::snapshotDatabase()", e.errorMessage() );
+            try {
+                m_db.execDML( "rollback transaction;" );
+            }
+            catch( CppSQLite3Exception e ) {}
+        }
+        detachSnapshot();
+        m_lastSnapshot = time( NULL );
+
+        pthread_mutex_unlock( &m_snapshotMutex );
+        return written;
+    }
+
+    /**
+     * Function takes a snapshot if the interval set with setSnapshot() has passed.
+     */
+    void DataSync::snapshotDatabaseIfDue() {
+        if( m_inMemory && m_snapshotInterval > 0 && difftime( time( NULL ), m_lastSnapshot ) >= m_snapshotInterval ) {
+            snapshotDatabase();
+        }
+    }
+
+    bool DataSync::isInMemory() {
+        return m_inMemory;
+    }
+
+    /**
+     * Function adds the queued messages and sessions from the snapshot file to the
+     * in-memory tables. Snapshots from another SDK version are ignored. Called with
+     * m_snapshotMutex held.
+     */
+    bool DataSync::restoreSnapshot() {
+        bool restored = false;
+        try {
+            attachSnapshot();
+
+            CppSQLite3Query tables = m_db.execQuery( "select count(*) from snapshot.sqlite_master where type='table' and name in ('"
+                CONFIG_TABLE_NAME "', '" MSG_QUEUE_TABLE_NAME "', '" SESSION_TABLE_NAME "');" );
+            bool complete = tables.getIntField( 0 ) == 3;
+            tables.finalize();
+
+            string version;
+            if( complete ) {
+                CppSQLite3Query q = m_db.execQuery( "select version from snapshot." CONFIG_TABLE_NAME ";" );
+                version = q.eof() ? "" : q.getStringField( 0 );
+                q.finalize();
+            }
+
+            if( version == SDK_VERSION ) {
+                // Messages get new ids, requests in flight when the snapshot was taken are sent again
+                m_db.execDML( "begin transaction;" );
+                m_db.execDML( "insert into main." MSG_QUEUE_TABLE_NAME " (deviceId, path, requestType, coreCB, postdata, contentType, status, codec)"
+                    " select deviceId, path, requestType, coreCB, postdata, contentType, 'ready', codec from snapshot." MSG_QUEUE_TABLE_NAME " order by id;" );
+                m_db.execDML( "insert into main." SESSION_TABLE_NAME " select * from snapshot." SESSION_TABLE_NAME
+                    " where deviceId not in (select deviceId from main." SESSION_TABLE_NAME ");" );
+                m_db.execDML( "commit transaction;" );
+                restored = true;
+            }
+            else if( version.length() > 0 ) {
+                m_core->displayWarning( "DataSync::restoreSnapshot()", "The snapshot is from SDK version " + version + ", ignoring it." );
+            }
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "DataSync::restoreSnapshot()", e.errorMessage() );
+            try {
+                m_db.execDML( "rollback transaction;" );
+            }
+            catch( CppSQLite3Exception e ) {}
+        }
+        detachSnapshot();
+
+        // Reload the queue counts
+        if( restored ) {
+            m_store->open();
+            m_core->logMessage( "Restored the database snapshot:", m_snapshotPath.c_str() );
+        }
+        return restored;
+    }
+
+    void DataSync::attachSnapshot() {
+        CppSQLite3Statement attach = m_db.compileStatement( "attach database ? as snapshot;" );
+        attach.bind( 1, m_snapshotPath.c_str() );
+        attach.execDML();
+        attach.finalize();
+    }
+
+    void DataSync::detachSnapshot() {
+        try {
+            m_db.execDML( "detach database snapshot;" );
+        }
+        catch( CppSQLite3Exception e ) {}
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * Function creates all tables used in the SDK.
+     */
+    void DataSync::createTables() {
+        int r;
+        string s;
 
         try {
             // Create the CONFIG table
@@ -1236,7 +2093,7 @@ namespace nsGlasslabSDK {
                 s = "";
                 s += "create table ";
                 s += CONFIG_TABLE_NAME;
-                s += " (version char(256));";
+                s += " (version char(256), uri char(256), serverConfig text, bootstrapUri char(256), gameId char(256), messageStore integer);";
 
                 printf("SQL: %s\n", s.c_str());
                 r = m_db.execDML( s.c_str() );
@@ -1247,7 +2104,7 @@ namespace nsGlasslabSDK {
                 s = "";
                 s += "INSERT INTO ";
                 s += CONFIG_TABLE_NAME;
-                s += " VALUES ('";
+                s += " (version) VALUES ('";
                 s += SDK_VERSION;
                 s += "');";
                 
@@ -1255,6 +2112,9 @@ namespace nsGlasslabSDK {
                 int nRows = m_db.execDML( s.c_str() );
                 printf("%d rows inserted\n", nRows);
                 printf("------------------------------------\n");
+
+                // A new database starts at the current schema
+                setSchemaVersion( DB_SCHEMA_VERSION );
             }
 
             // Create the MSG_QUEUE table
@@ -1269,27 +2129,17 @@ namespace nsGlasslabSDK {
                 s += "deviceId char(256), ";
                 s += "path char(256), ";
                 s += "requestType char(256), ";
-                s += "coreCB char(256), ";
+                s += "coreCB integer, ";
                 s += "postdata text, ";
                 s += "contentType char(256), ";
-                s += "status char(256) ";
+                s += "status char(256), ";
+                s += "codec char(32) ";
                 s += ");";
                 
                 printf("SQL: %s\n", s.c_str());
                 r = m_db.execDML( s.c_str() );
                 printf("Created table: %d", r);
                 printf("------------------------------------\n");
-
-                // Initialize the table size to 0
-                m_messageTableSize = 0;
-            }
-            else {
-                // Set the message table size
-                s = "";
-                s += "select * from ";
-                s += MSG_QUEUE_TABLE_NAME;
-                CppSQLite3Table t = m_db.getTable( s.c_str() );
-                m_messageTableSize = t.numRows();
             }
             
             // Create the SESSION table
@@ -1313,6 +2163,27 @@ namespace nsGlasslabSDK {
                 printf("------------------------------------\n");
             }
 
+            // Create the RESPONSE_CACHE table
+            if( !m_db.tableExists( RESPONSE_CACHE_TABLE_NAME ) ) {
+                printf("\nCreating %s table\n", RESPONSE_CACHE_TABLE_NAME);
+
+                s = "";
+                s += "create table ";
+                s += RESPONSE_CACHE_TABLE_NAME;
+                s += " (";
+                s += "key text primary key, ";
+                s += "etag char(256), ";
+                s += "lastModified char(256), ";
+                s += "body text, ";
+                s += "storedAt integer ";
+                s += ");";
+
+                printf("SQL: %s\n", s.c_str());
+                r = m_db.execDML( s.c_str() );
+                printf("Created table: %d", r);
+                printf("------------------------------------\n");
+            }
+
             // Display all tables
             displayTable( CONFIG_TABLE_NAME );
             displayTable( MSG_QUEUE_TABLE_NAME );
@@ -1368,6 +2239,18 @@ namespace nsGlasslabSDK {
                 printf("Dropped table: %d", r);
                 printf("------------------------------------\n");
             }
+
+            // Drop the RESPONSE_CACHE table
+            if( m_db.tableExists( RESPONSE_CACHE_TABLE_NAME ) ) {
+                printf("\nDropping %s table\n", RESPONSE_CACHE_TABLE_NAME);
+
+                s = "drop table " RESPONSE_CACHE_TABLE_NAME ";";
+
+                printf("SQL: %s\n", s.c_str());
+                r = m_db.execDML( s.c_str() );
+                printf("Dropped table: %d", r);
+                printf("------------------------------------\n");
+            }
         }
         catch( CppSQLite3Exception e ) {
             m_core->displayError( "DataSync::dropTables()", e.errorMessage() );
@@ -1376,38 +2259,60 @@ namespace nsGlasslabSDK {
     }
 
     /**
-     * Function will perform migration for all tables, calling the migrateTable( table ) function.
+     * Function migrates all tables to the current schemas in one transaction, together
+     * with the SDK and schema versions. If the application stops part way, SQLite rolls
+     * the transaction back and the migration runs again on the next start.
      */
     void DataSync::migrateTables() {
+        int64_t started = m_core->getClock()->monotonicMicros();
+
         try {
+            m_db.execDML( "begin transaction;" );
+
             // Perform migration for the CONFIG table
-            string config_schema = "create table " CONFIG_TABLE_NAME "_backup ("
-                "version char(256) "
-                ");";
-            migrateTable( CONFIG_TABLE_NAME, config_schema );
+            migrateTable( CONFIG_TABLE_NAME,
+                "version char(256), "
+                "uri char(256), "
+                "serverConfig text, "
+                "bootstrapUri char(256), "
+                "gameId char(256), "
+                "messageStore integer" );
 
             // Perform migration for the MSG_QUEUE table
-            string message_schema = "create table " MSG_QUEUE_TABLE_NAME "_backup ("
+            migrateTable( MSG_QUEUE_TABLE_NAME,
                 "id integer primary key autoincrement, "
                 "deviceId char(256), "
                 "path char(256), "
                 "requestType char(256), "
-                "coreCB char(256), "
+                "coreCB integer, "
                 "postdata text, "
                 "contentType char(256), "
-                "status char(256) "
-                ");";
-            migrateTable( MSG_QUEUE_TABLE_NAME, message_schema );
+                "status char(256), "
+                "codec char(32)" );
 
             // Perform migration for the SESSION table
-            string session_schema = "create table " SESSION_TABLE_NAME "_backup ("
+            migrateTable( SESSION_TABLE_NAME,
                 "cookie char(256), "
                 "deviceId char(256), "
                 "gameSessionId char(256), "
                 "gameSessionEventOrder integer, "
-                "totalTimePlayed real "
-                ");";
-            migrateTable( SESSION_TABLE_NAME, session_schema );
+                "totalTimePlayed real" );
+
+            // Perform migration for the RESPONSE_CACHE table
+            migrateTable( RESPONSE_CACHE_TABLE_NAME,
+                "key text primary key, "
+                "etag char(256), "
+                "lastModified char(256), "
+                "body text, "
+                "storedAt integer" );
+
+            // Record the versions the tables now match
+            string s = "update " CONFIG_TABLE_NAME " set version='" SDK_VERSION "';";
+            printf("SQL: %s\n", s.c_str());
+            m_db.execDML( s.c_str() );
+            setSchemaVersion( DB_SCHEMA_VERSION );
+
+            m_db.execDML( "commit transaction;" );
 
             // Display all tables
             displayTable( CONFIG_TABLE_NAME );
@@ -1417,113 +2322,185 @@ namespace nsGlasslabSDK {
         catch( CppSQLite3Exception e ) {
             m_core->displayError( "DataSync::migrateTables()", e.errorMessage() );
             //cout << "Exception in migrateTables() " << e.errorMessage() << " (" << e.errorCode() << ")" << endl;
+            try {
+                m_db.execDML( "rollback transaction;" );
+            }
+            catch( CppSQLite3Exception e ) {}
         }
+
+        printf( "Migration took %.1f ms\n", Clock::secondsBetween( started, m_core->getClock()->monotonicMicros() ) * 1000 );
     }
 
     /**
-     * Function will handle migrating the data from an existing table into a new one sharing
-     * the same name. This is to acount for potential changes in schema, including column add
-     * and removal. The data in the previous schema will be preserved.
-     * 
-     * Migration accounting for column operations can be handled via these operations:
-     * - CREATE TABLE current (a int, b int, c int);
-     * - CREATE TABLE backup (a int, c int, d int);
-     * - INSERT INTO backup SELECT a,c,0 FROM current;
-     * - DROP TABLE current;
-     * - ALTER TABLE backup RENAME TO current;
+     * Function will handle migrating the data from an existing table to the given column
+     * definitions. This is to acount for potential changes in schema, including column add
+     * and removal. The data in the previous schema will be preserved. Must be called inside
+     * a transaction, errors are thrown to the caller so it can roll back.
+     *
+     * - Tables that already match are left alone.
+     * - Columns appended at the end are added with ALTER TABLE ADD COLUMN, without
+     *   touching the rows.
+     * - Anything else is rebuilt in a single statement:
+     *   - CREATE TABLE backup (a int, c int, d int);
+     *   - INSERT INTO backup (a,c) SELECT a,c FROM current;
+     *   - DROP TABLE current;
+     *   - ALTER TABLE backup RENAME TO current;
      */
-    void DataSync::migrateTable( string table, string newSchema ) {
-        int r;
-        string m_sql;
-        
-        try {
-            // Migrate the contents of the parameter table if it exists
-            if( m_db.tableExists( table.c_str() ) ) {
-                cout << endl << "Migrating " << table << " table" << endl;
+    void DataSync::migrateTable( string table, string columns ) {
+        // Migrate the contents of the parameter table if it exists
+        if( !m_db.tableExists( table.c_str() ) ) {
+            return;
+        }
+        int64_t started = m_core->getClock()->monotonicMicros();
+
+        // Split the new column definitions, commas inside parentheses belong to a type
+        vector<string> definitions;
+        vector<string> names;
+        int depth = 0;
+        size_t begin = 0;
+        for( size_t i = 0; i <= columns.size(); i++ ) {
+            if( i < columns.size() && columns[ i ] == '(' ) {
+                depth++;
+            }
+            else if( i < columns.size() && columns[ i ] == ')' ) {
+                depth--;
+            }
+            else if( i == columns.size() || ( columns[ i ] == ',' && depth == 0 ) ) {
+                string definition = columns.substr( begin, i - begin );
+                size_t first = definition.find_first_not_of( " " );
+                size_t last = definition.find_last_not_of( " " );
+                if( first != string::npos ) {
+                    definition = definition.substr( first, last - first + 1 );
+                    definitions.push_back( definition );
+                    names.push_back( definition.substr( 0, definition.find( ' ' ) ) );
+                }
+                begin = i + 1;
+            }
+        }
 
-                // Create the backup table with the desired schema
-                m_sql = newSchema;
-                // Execute.
-                cout << "SQL: " << m_sql << endl;
-                string t2 = m_sql;
-                r = m_db.execDML( t2.c_str() );
-                printf( "result: %i\n", r );
-
-
-                // Get the schema for both the backup and current tables
-                m_sql = "select * from " + table + "_backup;";
-                CppSQLite3Query backup_q = m_db.execQuery( m_sql.c_str() );
-                m_sql = "select * from " + table + ";";
-                CppSQLite3Query current_q = m_db.execQuery( m_sql.c_str() );
-
-                // Now we need to construct the insert string to migrate data from current to backup
-                string insertString = "";
-                int numBackupFields = backup_q.numFields();
-                for( int b = 0; b < numBackupFields; b++ ) {
-                    bool matchFound = false;
-
-                    // We need to check this backup table field for existence in the current table
-                    for( int c = 0; c < current_q.numFields(); c++ ) {
-                        // If we have a match, append the value to the insert string
-                        //printf( "comparing %s with %s\n", backup_q.fieldName( b ), current_q.fieldName( c ) );
-                        if( strcmp( backup_q.fieldName( b ), current_q.fieldName( c ) ) == 0 ) {
-                            //printf( "found!\n" );
-                            insertString += backup_q.fieldName( b );
-                            matchFound = true;
-                            break;
-                        }
-                    }
+        // Get the current columns, in order
+        vector<string> current;
+        string m_sql = "pragma table_info(" + table + ");";
+        CppSQLite3Query q = m_db.execQuery( m_sql.c_str() );
+        while( !q.eof() ) {
+            current.push_back( q.getStringField( "name" ) );
+            q.nextRow();
+        }
+        q.finalize();
 
-                    // If there was no match found, set the default value for that data type
-                    if( !matchFound ) {
-                        insertString += "NULL";
-                    }
+        // Columns can be appended in place if the current ones are an unchanged prefix
+        bool appendOnly = current.size() <= names.size();
+        for( size_t i = 0; appendOnly && i < current.size(); i++ ) {
+            appendOnly = current[ i ] == names[ i ];
+        }
+        for( size_t i = current.size(); appendOnly && i < definitions.size(); i++ ) {
+            appendOnly = definitions[ i ].find( "primary key" ) == string::npos && definitions[ i ].find( "unique" ) == string::npos;
+        }
 
-                    // Append a comma if we haven't yet reached the end of backup fields
-                    if( b + 1 < numBackupFields ) {
-                        insertString += ",";
+        if( appendOnly && current.size() == names.size() ) {
+            return;
+        }
+
+        cout << endl << "Migrating " << table << " table" << endl;
+        if( appendOnly ) {
+            for( size_t i = current.size(); i < definitions.size(); i++ ) {
+                m_sql = "alter table " + table + " add column " + definitions[ i ] + ";";
+                cout << "SQL: " << m_sql << endl;
+                m_db.execDML( m_sql.c_str() );
+            }
+        }
+        else {
+            // Copy the shared columns over, the others keep their defaults
+            string shared = "";
+            for( size_t i = 0; i < names.size(); i++ ) {
+                for( size_t c = 0; c < current.size(); c++ ) {
+                    if( names[ i ] == current[ c ] ) {
+                        shared += ( shared.length() > 0 ? "," : "" ) + names[ i ];
+                        break;
                     }
                 }
+            }
 
-                // Finalize the two select statements
-                backup_q.finalize();
-                current_q.finalize();
+            // A backup table left by an earlier, non-transactional migration is stale
+            m_sql = "drop table if exists " + table + "_backup;";
+            m_db.execDML( m_sql.c_str() );
 
-                // Insert shared values the from current into the backup
-                m_sql = "insert into " + table + "_backup "
-                    "select " + insertString + " from " + table + ";";
-                // Execute.
-                cout << "SQL: " << m_sql << endl;
-                t2 = m_sql;
-                r = m_db.execDML( t2.c_str() );
-                printf( "result: %i\n", r );
+            // Create the backup table with the desired schema
+            m_sql = "create table " + table + "_backup (" + columns + ");";
+            cout << "SQL: " << m_sql << endl;
+            m_db.execDML( m_sql.c_str() );
 
-                // Drop the current table
-                m_sql = "drop table " + table + ";";
-                // Execute.
+            // Insert shared values the from current into the backup
+            if( shared.length() > 0 ) {
+                m_sql = "insert into " + table + "_backup (" + shared + ") "
+                    "select " + shared + " from " + table + ";";
                 cout << "SQL: " << m_sql << endl;
-                t2 = m_sql;
-                r = m_db.execDML( t2.c_str() );
-                printf( "result: %i\n", r );
-
-                // Alter the backup table to rename it as current
-                m_sql = "alter table " + table + "_backup "
-                    "rename to " + table + ";";
-                // Execute.
-                cout << "SQL: " << m_sql << endl;
-                t2 = m_sql;
-                r = m_db.execDML( t2.c_str() );
-                printf( "result: %i\n", r );
+                m_db.execDML( m_sql.c_str() );
+            }
+
+            // Drop the current table and rename the backup table as current
+            m_sql = "drop table " + table + ";";
+            cout << "SQL: " << m_sql << endl;
+            m_db.execDML( m_sql.c_str() );
 
-                // Print final results
-                cout << "Migration results:" << r << endl;
-                cout << "------------------------------------" << endl;
+            m_sql = "alter table " + table + "_backup "
+                "rename to " + table + ";";
+            cout << "SQL: " << m_sql << endl;
+            m_db.execDML( m_sql.c_str() );
+        }
+
+        // Print final results
+        double elapsed = Clock::secondsBetween( started, m_core->getClock()->monotonicMicros() ) * 1000;
+        cout << "Migrated " << table << ( appendOnly ? " in place" : " by copy" ) << " in " << elapsed << " ms" << endl;
+        cout << "------------------------------------" << endl;
+    }
+
+    /**
+     * Functions read and write the schema version, kept in PRAGMA user_version so it is
+     * part of the migration transaction.
+     */
+    int DataSync::getSchemaVersion() {
+        CppSQLite3Query q = m_db.execQuery( "pragma user_version;" );
+        int version = q.eof() ? 0 : q.getIntField( 0 );
+        q.finalize();
+        return version;
+    }
+    void DataSync::setSchemaVersion( int version ) {
+        std::ostringstream s;
+        s << "pragma user_version = " << version << ";";
+        m_db.execDML( s.str().c_str() );
+    }
+
+    /**
+     * CONFIG operation.
+     *
+     * Stores or gets the message queue backend (Const::QueueStore), called on the
+     * storage writer thread.
+     */
+    void DataSync::storeMessageStoreType( int type ) {
+        try {
+            CppSQLite3Statement update = m_db.compileStatement( "update " CONFIG_TABLE_NAME " set messageStore=?;" );
+            update.bind( 1, type );
+            update.execDML();
+            update.finalize();
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "DataSync::storeMessageStoreType()", e.errorMessage() );
+        }
+    }
+    int DataSync::getStoredMessageStoreType() {
+        int type = Const::QueueStore_SQLite;
+        try {
+            CppSQLite3Query q = m_db.execQuery( "select messageStore from " CONFIG_TABLE_NAME ";" );
+            if( !q.eof() ) {
+                type = q.getIntField( 0, Const::QueueStore_SQLite );
             }
+            q.finalize();
         }
         catch( CppSQLite3Exception e ) {
-            m_core->displayError( "DataSync::migrateTable()", e.errorMessage() );
-            //cout << "Exception in migrateTable() " << e.errorMessage() << " (" << e.errorCode() << ")" << endl;
+            m_core->displayError( "DataSync::getStoredMessageStoreType()", e.errorMessage() );
         }
+        return type;
     }
 
     /**
@@ -1564,5 +2541,888 @@ namespace nsGlasslabSDK {
         }
 #endif
     }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * SQLiteMessageStore keeps the message queue in the MSG_QUEUE table of the
+     * DataSync database.
+     */
+    SQLiteMessageStore::SQLiteMessageStore( Core* core, CppSQLite3DB* db ) {
+        m_core = core;
+        m_db = db;
+        m_count = 0;
+        m_bytes = 0;
+    }
+
+    /**
+     * Function loads the row and byte counts of MSG_QUEUE.
+     */
+    bool SQLiteMessageStore::open() {
+        try {
+            CppSQLite3Query q = m_db->execQuery( "select count(*), total(length(cast(postdata as blob))) from " MSG_QUEUE_TABLE_NAME ";" );
+            m_count = q.getIntField( 0 );
+            m_bytes = (int64_t)q.getFloatField( 1 );
+            q.finalize();
+            return true;
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "SQLiteMessageStore::open()", e.errorMessage() );
+            return false;
+        }
+    }
+
+    /**
+     * Function inserts a message, compressed postdata is stored as a BLOB.
+     */
+    bool SQLiteMessageStore::append( glQueuedMessage& message ) {
+        try {
+            // A message already stored under the given id is moved out of the way
+            if( message.id > 0 ) {
+                CppSQLite3Statement renumber = m_db->compileStatement( "UPDATE " MSG_QUEUE_TABLE_NAME
+                    " SET id=(SELECT max(id) + 1 FROM " MSG_QUEUE_TABLE_NAME ") WHERE id=?;" );
+                renumber.bind( 1, message.id );
+                renumber.execDML();
+                renumber.finalize();
+            }
+
+            CppSQLite3Statement insert = m_db->compileStatement( "INSERT INTO " MSG_QUEUE_TABLE_NAME
+                " (id, deviceId, path, requestType, coreCB, postdata, contentType, status, codec) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);" );
+            if( message.id > 0 ) {
+                insert.bind( 1, message.id );
+            }
+            else {
+                insert.bindNull( 1 );
+            }
+            insert.bind( 2, message.deviceId.c_str() );
+            insert.bind( 3, message.path.c_str() );
+            insert.bind( 4, message.requestType.c_str() );
+            insert.bind( 5, message.coreCB );
+            if( message.codec.length() > 0 ) {
+                insert.bind( 6, (const unsigned char*)message.postdata.data(), (int)message.postdata.size() );
+                insert.bind( 9, message.codec.c_str() );
+            }
+            else {
+                insert.bind( 6, message.postdata.c_str() );
+                insert.bindNull( 9 );
+            }
+            insert.bind( 7, message.contentType.c_str() );
+            insert.bind( 8, message.status.length() > 0 ? message.status.c_str() : "ready" );
+            insert.execDML();
+            insert.finalize();
+
+            message.id = (int)m_db->lastRowId();
+            m_count++;
+            m_bytes += message.postdata.size();
+            return true;
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "SQLiteMessageStore::append()", e.errorMessage() );
+            return false;
+        }
+    }
+
+    /**
+     * Function deletes a message, it may already have been evicted.
+     */
+    bool SQLiteMessageStore::remove( int id ) {
+        try {
+            char t[255];
+            sprintf( t, "%d", id );
+
+            // Get the size of the entry for the byte cap
+            string s = "select length(cast(postdata as blob)) from " MSG_QUEUE_TABLE_NAME " where id=";
+            s += t;
+            CppSQLite3Query q = m_db->execQuery( s.c_str() );
+            int64_t bytes = q.eof() ? 0 : q.getInt64Field( 0 );
+            q.finalize();
+
+            s = "delete from " MSG_QUEUE_TABLE_NAME " where id=";
+            s += t;
+            if( m_db->execDML( s.c_str() ) > 0 ) {
+                m_count--;
+                m_bytes -= bytes;
+                return true;
+            }
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "SQLiteMessageStore::remove()", e.errorMessage() );
+        }
+        return false;
+    }
+
+    /**
+     * Function updates the status of a message.
+     */
+    bool SQLiteMessageStore::setStatus( int id, const string& status ) {
+        try {
+            CppSQLite3Statement update = m_db->compileStatement( "UPDATE " MSG_QUEUE_TABLE_NAME " SET status=? WHERE id=?;" );
+            update.bind( 1, status.c_str() );
+            update.bind( 2, id );
+            int r = update.execDML();
+            update.finalize();
+            return r > 0;
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "SQLiteMessageStore::setStatus()", e.errorMessage() );
+            return false;
+        }
+    }
+
+    /**
+     * Function reads the next messages in id order.
+     */
+    bool SQLiteMessageStore::readAfter( int afterId, int limit, vector<glQueuedMessage>& messages ) {
+        messages.clear();
+        try {
+            CppSQLite3Statement select = m_db->compileStatement( "select id, deviceId, path, requestType, coreCB, postdata, contentType, status, codec from "
+                MSG_QUEUE_TABLE_NAME " where id > ? order by id limit ?;" );
+            select.bind( 1, afterId );
+            select.bind( 2, limit );
+            CppSQLite3Query q = select.execQuery();
+            while( !q.eof() ) {
+                glQueuedMessage message;
+                message.id = q.getIntField( 0 );
+                message.deviceId = q.getStringField( 1 );
+                message.path = q.getStringField( 2 );
+                message.requestType = q.getStringField( 3 );
+                // Rows queued before callbacks had ids hold the callback name
+                const char* coreCB = q.getStringField( 4 );
+                if( isdigit( (unsigned char)coreCB[ 0 ] ) || coreCB[ 0 ] == '-' ) {
+                    message.coreCB = atoi( coreCB );
+                }
+                else {
+                    message.coreCB = m_core->getCoreCallbackId( coreCB );
+                }
+                message.contentType = q.getStringField( 6 );
+                message.status = q.getStringField( 7 );
+                message.codec = q.getStringField( 8 );
+                if( message.codec.length() > 0 ) {
+                    int size = 0;
+                    const unsigned char* data = q.getBlobField( 5, size );
+                    message.postdata.assign( (const char*)data, size );
+                }
+                else {
+                    message.postdata = q.getStringField( 5 );
+                }
+                messages.push_back( message );
+                q.nextRow();
+            }
+            q.finalize();
+            return true;
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "SQLiteMessageStore::readAfter()", e.errorMessage() );
+            return false;
+        }
+    }
+
+    /**
+     * Function deletes the oldest telemetry messages that are not pending, if enough
+     * of them free the rows and bytes. Returns the number of messages deleted.
+     */
+    int SQLiteMessageStore::evict( int rows, int64_t bytes, int64_t& evictedBytes ) {
+        int evictedRows = 0;
+        evictedBytes = 0;
+        try {
+            // Collect just enough of the oldest rows, a batch at a time
+            int lastId = 0;
+            int foundRows = 0;
+            int64_t foundBytes = 0;
+            while( rows - foundRows > 0 || bytes - foundBytes > 0 ) {
+                CppSQLite3Statement select = m_db->compileStatement( "select id, length(cast(postdata as blob)) from " MSG_QUEUE_TABLE_NAME
+                    " where status != 'pending' and path='" API_POST_EVENTS "' and id > ? order by id limit 256;" );
+                select.bind( 1, lastId );
+                CppSQLite3Query q = select.execQuery();
+
+                int batchRows = 0;
+                while( !q.eof() && ( rows - foundRows > 0 || bytes - foundBytes > 0 ) ) {
+                    lastId = q.getIntField( 0 );
+                    foundBytes += q.getInt64Field( 1 );
+                    foundRows++;
+                    batchRows++;
+                    q.nextRow();
+                }
+                q.finalize();
+
+                if( batchRows == 0 ) {
+                    break;
+                }
+            }
+
+            // Not enough telemetry to make room, keep it all
+            if( rows - foundRows > 0 || bytes - foundBytes > 0 ) {
+                return 0;
+            }
+
+            CppSQLite3Statement remove = m_db->compileStatement( "delete from " MSG_QUEUE_TABLE_NAME
+                " where status != 'pending' and path='" API_POST_EVENTS "' and id <= ?;" );
+            remove.bind( 1, lastId );
+            remove.execDML();
+            evictedRows = foundRows;
+            evictedBytes = foundBytes;
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "SQLiteMessageStore::evict()", e.errorMessage() );
+        }
+
+        m_count -= evictedRows;
+        m_bytes -= evictedBytes;
+        return evictedRows;
+    }
+
+    /**
+     * Function deletes all messages.
+     */
+    void SQLiteMessageStore::clear() {
+        try {
+            m_db->execDML( "delete from " MSG_QUEUE_TABLE_NAME ";" );
+        }
+        catch( CppSQLite3Exception e ) {
+            m_core->displayError( "SQLiteMessageStore::clear()", e.errorMessage() );
+        }
+        m_count = 0;
+        m_bytes = 0;
+    }
+
+    int SQLiteMessageStore::getCount() {
+        return m_count;
+    }
+    int64_t SQLiteMessageStore::getBytes() {
+        return m_bytes;
+    }
+
+
+    //--------------------------------------
+    //--------------------------------------
+    //--------------------------------------
+    /**
+     * Little endian fields used by the LogMessageStore records.
+     */
+    static void logPutU32( string& out, uint32_t value ) {
+        char b[ 4 ] = { (char)( value & 0xff ), (char)( ( value >> 8 ) & 0xff ), (char)( ( value >> 16 ) & 0xff ), (char)( ( value >> 24 ) & 0xff ) };
+        out.append( b, 4 );
+    }
+    static uint32_t logGetU32( const char* in ) {
+        const unsigned char* b = (const unsigned char*)in;
+        return (uint32_t)b[ 0 ] | ( (uint32_t)b[ 1 ] << 8 ) | ( (uint32_t)b[ 2 ] << 16 ) | ( (uint32_t)b[ 3 ] << 24 );
+    }
+    static void logPutString( string& out, const string& value ) {
+        logPutU32( out, (uint32_t)value.size() );
+        out += value;
+    }
+    static bool logGetString( const string& in, size_t& pos, string& value ) {
+        if( pos + 4 > in.size() ) {
+            return false;
+        }
+        uint32_t size = logGetU32( in.data() + pos );
+        pos += 4;
+        if( size > in.size() - pos ) {
+            return false;
+        }
+        value.assign( in, pos, size );
+        pos += size;
+        return true;
+    }
+
+    /**
+     * LogMessageStore keeps the message queue in segment files named
+     * <basePath>.<segment>.log, with the cursor in <basePath>.cursor.
+     *
+     * Record: payload size (u32), checksum (u32), payload.
+     * Payload: id (u32), coreCB (u32), deviceId, path, requestType, contentType, codec, postdata,
+     * each string prefixed with its size (u32).
+     * Tombstone payload: id (u32) of a record removed ahead of the cursor.
+     */
+    LogMessageStore::LogMessageStore( Core* core, const string& basePath ) {
+        m_core = core;
+        m_basePath = basePath;
+        pthread_mutex_init( &m_mutex, NULL );
+
+        m_bytes = 0;
+        m_nextId = 1;
+        m_cursorSegment = 1;
+        m_cursorOffset = 0;
+        m_writeSegment = 1;
+        m_writeOffset = 0;
+        m_writeFile = NULL;
+    }
+
+    LogMessageStore::~LogMessageStore() {
+        if( m_writeFile != NULL ) {
+            fclose( m_writeFile );
+        }
+        pthread_mutex_destroy( &m_mutex );
+    }
+
+    /**
+     * Function rebuilds the index from the segments at and after the cursor. Only
+     * the last segment is checksummed, a torn record there is left behind and new
+     * records go to the next segment.
+     */
+    bool LogMessageStore::open() {
+        pthread_mutex_lock( &m_mutex );
+
+        if( m_writeFile != NULL ) {
+            fclose( m_writeFile );
+            m_writeFile = NULL;
+        }
+        m_entries.clear();
+        m_positions.clear();
+        m_bytes = 0;
+        if( !readCursor() ) {
+            m_cursorSegment = 1;
+            m_cursorOffset = 0;
+            m_nextId = 1;
+        }
+
+        m_writeSegment = m_cursorSegment;
+        m_writeOffset = m_cursorOffset;
+        for( uint32_t segment = m_cursorSegment; segmentExists( segment ); segment++ ) {
+            bool tail = !segmentExists( segment + 1 );
+            uint32_t validEnd = 0;
+            bool clean = scanSegment( segment, segment == m_cursorSegment ? m_cursorOffset : 0, tail, validEnd );
+
+            m_writeSegment = segment;
+            m_writeOffset = validEnd;
+            if( !clean ) {
+                m_core->displayWarning( "LogMessageStore::open()", "A damaged record was found, the rest of the segment is skipped: " + segmentName( segment ) );
+                if( tail ) {
+                    m_writeSegment = segment + 1;
+                    m_writeOffset = 0;
+                }
+            }
+        }
+
+#ifdef VERBOSE
+        char t[64];
+        sprintf( t, "%d messages, %d bytes", (int)m_entries.size(), (int)m_bytes );
+        m_core->logMessage( "Message log opened:", t );
+#endif
+
+        pthread_mutex_unlock( &m_mutex );
+        return true;
+    }
+
+    /**
+     * Function writes a record at the end of the current segment.
+     */
+    bool LogMessageStore::append( glQueuedMessage& message ) {
+        pthread_mutex_lock( &m_mutex );
+
+        // A message already stored under the given id is moved out of the way
+        if( message.id > 0 && m_entries.count( message.id ) > 0 && !renumber( message.id ) ) {
+            pthread_mutex_unlock( &m_mutex );
+            return false;
+        }
+        if( message.id <= 0 ) {
+            message.id = m_nextId;
+        }
+        if( message.id >= m_nextId ) {
+            m_nextId = message.id + 1;
+        }
+
+        string payload;
+        encode( message, payload );
+        uint32_t segment, offset;
+        bool written = writeRecord( payload, segment, offset );
+        if( written ) {
+            indexEntry( message, segment, offset );
+        }
+
+        pthread_mutex_unlock( &m_mutex );
+        return written;
+    }
+
+    /**
+     * Function drops a message from the index and moves the cursor past it if it
+     * was the first one.
+     */
+    bool LogMessageStore::remove( int id ) {
+        pthread_mutex_lock( &m_mutex );
+
+        bool found = m_entries.count( id ) > 0;
+        if( found ) {
+            removeEntries( vector<int>( 1, id ) );
+        }
+
+        pthread_mutex_unlock( &m_mutex );
+        return found;
+    }
+
+    /**
+     * Function updates the status of a message, statuses are not persisted.
+     */
+    bool LogMessageStore::setStatus( int id, const string& status ) {
+        pthread_mutex_lock( &m_mutex );
+
+        map<int, LogEntry>::iterator it = m_entries.find( id );
+        bool found = it != m_entries.end();
+        if( found ) {
+            it->second.status = status;
+        }
+
+        pthread_mutex_unlock( &m_mutex );
+        return found;
+    }
+
+    /**
+     * Function reads the next messages in id order. Records that fail their
+     * checksum are dropped.
+     */
+    bool LogMessageStore::readAfter( int afterId, int limit, vector<glQueuedMessage>& messages ) {
+        pthread_mutex_lock( &m_mutex );
+
+        messages.clear();
+        vector<int> damaged;
+        FILE* file = NULL;
+        uint32_t fileSegment = 0;
+        string payload;
+
+        for( map<int, LogEntry>::iterator it = m_entries.upper_bound( afterId ); it != m_entries.end() && (int)messages.size() < limit; it++ ) {
+            if( file == NULL || fileSegment != it->second.segment ) {
+                if( file != NULL ) {
+                    fclose( file );
+                }
+                fileSegment = it->second.segment;
+                file = fopen( segmentName( fileSegment ).c_str(), "rb" );
+            }
+
+            glQueuedMessage message;
+            if( file != NULL && fseek( file, it->second.offset, SEEK_SET ) == 0 &&
+                readRecord( file, true, payload ) && decode( payload, message ) && message.id == it->first ) {
+                message.status = it->second.status;
+                messages.push_back( message );
+            }
+            else {
+                damaged.push_back( it->first );
+            }
+        }
+        if( file != NULL ) {
+            fclose( file );
+        }
+
+        if( damaged.size() > 0 ) {
+            m_core->displayWarning( "LogMessageStore::readAfter()", "Damaged records were removed from the message log." );
+            removeEntries( damaged );
+        }
+
+        pthread_mutex_unlock( &m_mutex );
+        return true;
+    }
+
+    /**
+     * Function drops the oldest telemetry messages that are not pending, if enough
+     * of them free the rows and bytes. Returns the number of messages dropped.
+     */
+    int LogMessageStore::evict( int rows, int64_t bytes, int64_t& evictedBytes ) {
+        pthread_mutex_lock( &m_mutex );
+
+        vector<int> evicted;
+        evictedBytes = 0;
+        map<int, LogEntry>::iterator it = m_entries.begin();
+        for( ; it != m_entries.end() && ( rows - (int)evicted.size() > 0 || bytes - evictedBytes > 0 ); it++ ) {
+            if( it->second.status == "pending" || !it->second.telemetry ) {
+                continue;
+            }
+            evictedBytes += it->second.bytes;
+            evicted.push_back( it->first );
+        }
+
+        // Not enough telemetry to make room, keep it all
+        if( rows - (int)evicted.size() > 0 || bytes - evictedBytes > 0 ) {
+            evicted.clear();
+            evictedBytes = 0;
+        }
+        removeEntries( evicted );
+
+        pthread_mutex_unlock( &m_mutex );
+        return (int)evicted.size();
+    }
+
+    /**
+     * Function deletes all segments and starts a new one.
+     */
+    void LogMessageStore::clear() {
+        pthread_mutex_lock( &m_mutex );
+
+        if( m_writeFile != NULL ) {
+            fclose( m_writeFile );
+            m_writeFile = NULL;
+        }
+        for( uint32_t segment = m_cursorSegment; segment <= m_writeSegment; segment++ ) {
+            ::remove( segmentName( segment ).c_str() );
+        }
+        m_entries.clear();
+        m_positions.clear();
+        m_bytes = 0;
+
+        m_writeSegment++;
+        m_writeOffset = 0;
+        m_cursorSegment = m_writeSegment;
+        m_cursorOffset = 0;
+        writeCursor();
+
+        pthread_mutex_unlock( &m_mutex );
+    }
+
+    int LogMessageStore::getCount() {
+        pthread_mutex_lock( &m_mutex );
+        int count = (int)m_entries.size();
+        pthread_mutex_unlock( &m_mutex );
+        return count;
+    }
+    int64_t LogMessageStore::getBytes() {
+        pthread_mutex_lock( &m_mutex );
+        int64_t bytes = m_bytes;
+        pthread_mutex_unlock( &m_mutex );
+        return bytes;
+    }
+
+    /**
+     * Segment and cursor file helpers, called with m_mutex held.
+     */
+    string LogMessageStore::segmentName( uint32_t segment ) {
+        char t[32];
+        sprintf( t, ".%08u.log", segment );
+        return m_basePath + t;
+    }
+
+    bool LogMessageStore::segmentExists( uint32_t segment ) {
+        FILE* file = fopen( segmentName( segment ).c_str(), "rb" );
+        if( file == NULL ) {
+            return false;
+        }
+        fclose( file );
+        return true;
+    }
+
+    /**
+     * Function opens the current segment for appending, rolling over to a new
+     * segment if the record does not fit under DB_LOG_SEGMENT_SIZE.
+     */
+    bool LogMessageStore::openWriteSegment( size_t recordSize ) {
+        for( int attempt = 0; attempt < 2; attempt++ ) {
+            if( m_writeFile == NULL ) {
+                m_writeFile = fopen( segmentName( m_writeSegment ).c_str(), "ab" );
+                if( m_writeFile == NULL ) {
+                    m_core->displayError( "LogMessageStore::openWriteSegment()", "Could not open " + segmentName( m_writeSegment ) );
+                    return false;
+                }
+                fseek( m_writeFile, 0, SEEK_END );
+                m_writeOffset = (uint32_t)ftell( m_writeFile );
+            }
+
+            // Oversized records get a segment of their own
+            if( m_writeOffset == 0 || m_writeOffset + recordSize <= DB_LOG_SEGMENT_SIZE ) {
+                return true;
+            }
+            fclose( m_writeFile );
+            m_writeFile = NULL;
+            m_writeSegment++;
+        }
+        return m_writeFile != NULL;
+    }
+
+    bool LogMessageStore::readCursor() {
+        FILE* file = fopen( ( m_basePath + ".cursor" ).c_str(), "r" );
+        if( file == NULL ) {
+            return false;
+        }
+        unsigned int segment = 0, offset = 0;
+        int nextId = 0;
+        bool valid = fscanf( file, "%u %u %d", &segment, &offset, &nextId ) == 3 && segment > 0;
+        fclose( file );
+        if( valid ) {
+            m_cursorSegment = segment;
+            m_cursorOffset = offset;
+            m_nextId = nextId;
+        }
+        return valid;
+    }
+
+    /**
+     * Function writes the cursor to a temporary file and renames it over the old
+     * one, so a crash leaves either cursor intact.
+     */
+    bool LogMessageStore::writeCursor() {
+        string path = m_basePath + ".cursor";
+        string tmpPath = path + ".tmp";
+        FILE* file = fopen( tmpPath.c_str(), "w" );
+        if( file == NULL ) {
+            return false;
+        }
+        fprintf( file, "%u %u %d\n", m_cursorSegment, m_cursorOffset, m_nextId );
+        bool written = fflush( file ) == 0;
+        fclose( file );
+#if WIN32
+        ::remove( path.c_str() );
+#endif
+        return written && rename( tmpPath.c_str(), path.c_str() ) == 0;
+    }
+
+    /**
+     * Function moves the cursor to the first remaining record, or the end of the
+     * log, and deletes the segments it has passed.
+     */
+    void LogMessageStore::advanceCursor() {
+        uint32_t segment = m_writeSegment;
+        uint32_t offset = m_writeOffset;
+        if( m_positions.size() > 0 ) {
+            segment = (uint32_t)( m_positions.begin()->first >> 32 );
+            offset = (uint32_t)( m_positions.begin()->first & 0xffffffff );
+        }
+        if( segment == m_cursorSegment && offset == m_cursorOffset ) {
+            return;
+        }
+
+        uint32_t oldSegment = m_cursorSegment;
+        m_cursorSegment = segment;
+        m_cursorOffset = offset;
+        if( !writeCursor() ) {
+            m_core->displayWarning( "LogMessageStore::advanceCursor()", "Could not write the message log cursor." );
+            return;
+        }
+
+        for( ; oldSegment < segment; oldSegment++ ) {
+            ::remove( segmentName( oldSegment ).c_str() );
+        }
+    }
+
+    /**
+     * Function writes a record at the end of the current segment and returns where
+     * it was written.
+     */
+    bool LogMessageStore::writeRecord( const string& payload, uint32_t& segment, uint32_t& offset ) {
+        string record;
+        logPutU32( record, (uint32_t)payload.size() );
+        logPutU32( record, checksum( payload ) );
+        record += payload;
+
+        if( !openWriteSegment( record.size() ) ) {
+            return false;
+        }
+
+        // A partial write would leave garbage at the end, so later records start a new segment
+        if( fwrite( record.data(), 1, record.size(), m_writeFile ) != record.size() || fflush( m_writeFile ) != 0 ) {
+            m_core->displayError( "LogMessageStore::writeRecord()", "Could not write to " + segmentName( m_writeSegment ) );
+            fclose( m_writeFile );
+            m_writeFile = NULL;
+            m_writeSegment++;
+            m_writeOffset = 0;
+            return false;
+        }
+
+        segment = m_writeSegment;
+        offset = m_writeOffset;
+        m_writeOffset += (uint32_t)record.size();
+        return true;
+    }
+
+    /**
+     * Function indexes a message record, replacing an older copy under the same id.
+     */
+    void LogMessageStore::indexEntry( const glQueuedMessage& message, uint32_t segment, uint32_t offset ) {
+        map<int, LogEntry>::iterator it = m_entries.find( message.id );
+        if( it != m_entries.end() ) {
+            eraseEntry( it );
+        }
+
+        LogEntry entry;
+        entry.segment = segment;
+        entry.offset = offset;
+        entry.bytes = message.postdata.size();
+        entry.telemetry = message.path == API_POST_EVENTS;
+        entry.status = message.status.length() > 0 ? message.status : "ready";
+        m_entries[ message.id ] = entry;
+        m_positions[ ( (uint64_t)segment << 32 ) | offset ] = message.id;
+        m_bytes += entry.bytes;
+    }
+
+    void LogMessageStore::eraseEntry( map<int, LogEntry>::iterator it ) {
+        m_positions.erase( ( (uint64_t)it->second.segment << 32 ) | it->second.offset );
+        m_bytes -= it->second.bytes;
+        m_entries.erase( it );
+    }
+
+    /**
+     * Function drops messages from the index and moves the cursor past the leading
+     * ones. Records still ahead of the cursor get a tombstone, so they stay removed
+     * after a restart.
+     */
+    void LogMessageStore::removeEntries( const vector<int>& ids ) {
+        vector< pair<int, uint64_t> > removed;
+        for( size_t i = 0; i < ids.size(); i++ ) {
+            map<int, LogEntry>::iterator it = m_entries.find( ids[ i ] );
+            if( it != m_entries.end() ) {
+                removed.push_back( make_pair( it->first, ( (uint64_t)it->second.segment << 32 ) | it->second.offset ) );
+                eraseEntry( it );
+            }
+        }
+        if( removed.size() == 0 ) {
+            return;
+        }
+        advanceCursor();
+
+        uint64_t cursor = ( (uint64_t)m_cursorSegment << 32 ) | m_cursorOffset;
+        string payload;
+        uint32_t segment, offset;
+        for( size_t i = 0; i < removed.size(); i++ ) {
+            if( removed[ i ].second < cursor ) {
+                continue;
+            }
+            payload.clear();
+            logPutU32( payload, (uint32_t)removed[ i ].first );
+            if( !writeRecord( payload, segment, offset ) ) {
+                m_core->displayWarning( "LogMessageStore::removeEntries()", "Could not write a tombstone, removed messages may be sent again after a restart." );
+                return;
+            }
+        }
+    }
+
+    /**
+     * Function gives the message stored under the id the next free one, so a message
+     * moved in from another store can take the id over.
+     */
+    bool LogMessageStore::renumber( int id ) {
+        map<int, LogEntry>::iterator it = m_entries.find( id );
+        string payload;
+        glQueuedMessage message;
+        FILE* file = fopen( segmentName( it->second.segment ).c_str(), "rb" );
+        bool read = file != NULL && fseek( file, it->second.offset, SEEK_SET ) == 0 &&
+            readRecord( file, true, payload ) && decode( payload, message ) && message.id == id;
+        if( file != NULL ) {
+            fclose( file );
+        }
+
+        // The copy is indexed before the old record is removed, so the cursor cannot pass it
+        if( read ) {
+            message.id = m_nextId++;
+            message.status = it->second.status;
+            encode( message, payload );
+            uint32_t segment, offset;
+            if( !writeRecord( payload, segment, offset ) ) {
+                return false;
+            }
+            indexEntry( message, segment, offset );
+        }
+        removeEntries( vector<int>( 1, id ) );
+        return true;
+    }
+
+    /**
+     * Function indexes the records of a segment from the given offset. Returns false
+     * if it stopped at a damaged record, validEnd is the end of the last good one.
+     */
+    bool LogMessageStore::scanSegment( uint32_t segment, uint32_t offset, bool verify, uint32_t& validEnd ) {
+        validEnd = offset;
+        FILE* file = fopen( segmentName( segment ).c_str(), "rb" );
+        if( file == NULL ) {
+            return false;
+        }
+        fseek( file, 0, SEEK_END );
+        long size = ftell( file );
+        fseek( file, offset, SEEK_SET );
+
+        string payload;
+        glQueuedMessage message;
+        while( readRecord( file, verify, payload ) ) {
+            // A tombstone removes the record written before it under the same id
+            if( payload.size() == 4 ) {
+                map<int, LogEntry>::iterator it = m_entries.find( (int)logGetU32( payload.data() ) );
+                if( it != m_entries.end() ) {
+                    eraseEntry( it );
+                }
+            }
+            // A record written again under the same id replaces the older copy
+            else if( decode( payload, message ) ) {
+                indexEntry( message, segment, validEnd );
+                if( message.id >= m_nextId ) {
+                    m_nextId = message.id + 1;
+                }
+            }
+            else {
+                break;
+            }
+            validEnd = (uint32_t)ftell( file );
+        }
+        fclose( file );
+
+        return (long)validEnd == size;
+    }
+
+    /**
+     * Function reads one record at the file position.
+     */
+    bool LogMessageStore::readRecord( FILE* file, bool verify, string& payload ) {
+        char header[ 8 ];
+        if( fread( header, 1, 8, file ) != 8 ) {
+            return false;
+        }
+        uint32_t size = logGetU32( header );
+        if( size < 4 || size > DB_MESSAGE_BYTE_CAP * 4 ) {
+            return false;
+        }
+        payload.resize( size );
+        if( fread( &payload[ 0 ], 1, size, file ) != size ) {
+            return false;
+        }
+        return !verify || checksum( payload ) == logGetU32( header + 4 );
+    }
+
+    /**
+     * Function computes the CRC-32 of a record payload.
+     */
+    uint32_t LogMessageStore::checksum( const string& data ) {
+        static struct Table {
+            uint32_t values[ 256 ];
+            Table() {
+                for( uint32_t i = 0; i < 256; i++ ) {
+                    uint32_t c = i;
+                    for( int k = 0; k < 8; k++ ) {
+                        c = ( c & 1 ) ? 0xedb88320 ^ ( c >> 1 ) : c >> 1;
+                    }
+                    values[ i ] = c;
+                }
+            }
+        } table;
+
+        uint32_t c = 0xffffffff;
+        for( size_t i = 0; i < data.size(); i++ ) {
+            c = table.values[ ( c ^ (unsigned char)data[ i ] ) & 0xff ] ^ ( c >> 8 );
+        }
+        return c ^ 0xffffffff;
+    }
+
+    void LogMessageStore::encode( const glQueuedMessage& message, string& payload ) {
+        payload.clear();
+        logPutU32( payload, (uint32_t)message.id );
+        logPutU32( payload, (uint32_t)message.coreCB );
+        logPutString( payload, message.deviceId );
+        logPutString( payload, message.path );
+        logPutString( payload, message.requestType );
+        logPutString( payload, message.contentType );
+        logPutString( payload, message.codec );
+        logPutString( payload, message.postdata );
+    }
+
+    bool LogMessageStore::decode( const string& payload, glQueuedMessage& message ) {
+        if( payload.size() < 8 ) {
+            return false;
+        }
+        size_t pos = 8;
+        message.id = (int)logGetU32( payload.data() );
+        message.coreCB = (int)logGetU32( payload.data() + 4 );
+        message.status = "ready";
+        return logGetString( payload, pos, message.deviceId ) &&
+               logGetString( payload, pos, message.path ) &&
+               logGetString( payload, pos, message.requestType ) &&
+               logGetString( payload, pos, message.contentType ) &&
+               logGetString( payload, pos, message.codec ) &&
+               logGetString( payload, pos, message.postdata ) &&
+               pos == payload.size();
+    }
     
 }; // end nsGlasslabSDK
\ No newline at end of file